@@ -0,0 +1,206 @@
+/*
+* Copyright (c) 2012 Nusantara Software
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Box2D.h>
+
+#include <cstdio>
+
+// Compares the solver modes on towers of boxes. Each mode steps the same scene
+// and reports the time per step, the towers that fell and how far the top boxes
+// moved sideways. A loaded chain then checks how far the joints stretch.
+
+const int32 e_towerCount = 20;
+const int32 e_boxCount = 30;
+const int32 e_linkCount = 60;
+const int32 e_stepCount = 600;
+
+struct SolverMode
+{
+	const char* name;
+	int32 velocityIterations;
+	int32 positionIterations;
+	int32 softStepCount;
+	bool treeJointSolver;
+};
+
+static void RunTowers(const SolverMode& mode)
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+	world.SetAllowSleeping(false);
+	world.SetSoftStepCount(mode.softStepCount);
+
+	{
+		b2BodyDef bd;
+		b2Body* ground = world.CreateBody(&bd);
+
+		b2PolygonShape shape;
+		shape.SetAsBox(2.0f * e_towerCount, 1.0f, b2Vec2(0.0f, -1.0f), 0.0f);
+		ground->CreateFixture(&shape, 0.0f);
+	}
+
+	b2Body* tops[e_towerCount];
+	float32 startX[e_towerCount];
+	{
+		b2PolygonShape shape;
+		shape.SetAsBox(0.5f, 0.5f);
+
+		b2FixtureDef fd;
+		fd.shape = &shape;
+		fd.density = 1.0f;
+		fd.friction = 0.6f;
+
+		for (int32 i = 0; i < e_towerCount; ++i)
+		{
+			float32 x = 3.0f * (i - 0.5f * e_towerCount);
+			for (int32 j = 0; j < e_boxCount; ++j)
+			{
+				b2BodyDef bd;
+				bd.type = b2_dynamicBody;
+				bd.position.Set(x, 0.5f + j);
+				b2Body* body = world.CreateBody(&bd);
+				body->CreateFixture(&fd);
+				tops[i] = body;
+			}
+
+			startX[i] = x;
+		}
+	}
+
+	b2Timer timer;
+	for (int32 i = 0; i < e_stepCount; ++i)
+	{
+		world.Step(1.0f / 60.0f, mode.velocityIterations, mode.positionIterations);
+	}
+	float32 ms = timer.GetMilliseconds() / e_stepCount;
+
+	// A tower has fallen when its top box is lower than the box below it was.
+	int32 fallenCount = 0;
+	float32 maxDrift = 0.0f;
+	for (int32 i = 0; i < e_towerCount; ++i)
+	{
+		b2Vec2 p = tops[i]->GetPosition();
+		if (p.y < e_boxCount - 1.5f)
+		{
+			++fallenCount;
+			continue;
+		}
+
+		maxDrift = b2Max(maxDrift, b2Abs(p.x - startX[i]));
+	}
+
+	printf("%-20s %6.2f ms/step  %2d/%d fallen  top drift %.3f\n",
+		mode.name, ms, fallenCount, e_towerCount, maxDrift);
+}
+
+// A chain of revolute joints that swings down from a static body, with a last
+// link 50 times as dense as the others. The stretch is the sum of the distances
+// between the anchors of the joints.
+static void RunChain(const SolverMode& mode)
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+	world.SetSoftStepCount(mode.softStepCount);
+	world.SetTreeJointSolver(mode.treeJointSolver);
+
+	b2BodyDef bd;
+	b2Body* ground = world.CreateBody(&bd);
+
+	b2PolygonShape shape;
+	shape.SetAsBox(0.5f, 0.125f);
+
+	b2FixtureDef fd;
+	fd.shape = &shape;
+	fd.density = 20.0f;
+	fd.filter.groupIndex = -1;
+
+	const float32 y = 40.0f;
+	b2Body* prevBody = ground;
+	for (int32 i = 0; i < e_linkCount; ++i)
+	{
+		bd.type = b2_dynamicBody;
+		bd.position.Set(0.5f + i, y);
+		b2Body* body = world.CreateBody(&bd);
+
+		if (i == e_linkCount - 1)
+		{
+			fd.density *= 50.0f;
+		}
+		body->CreateFixture(&fd);
+
+		b2RevoluteJointDef jd;
+		jd.Initialize(prevBody, body, b2Vec2(float32(i), y));
+		world.CreateJoint(&jd);
+
+		prevBody = body;
+	}
+
+	float32 maxStretch = 0.0f;
+	float32 stretch = 0.0f;
+	b2Timer timer;
+	for (int32 i = 0; i < e_stepCount; ++i)
+	{
+		world.Step(1.0f / 60.0f, mode.velocityIterations, mode.positionIterations);
+
+		stretch = 0.0f;
+		for (b2Joint* j = world.GetJointList(); j; j = j->GetNext())
+		{
+			stretch += b2Distance(j->GetAnchorA(), j->GetAnchorB());
+		}
+		maxStretch = b2Max(maxStretch, stretch);
+	}
+	float32 ms = timer.GetMilliseconds() / e_stepCount;
+
+	printf("%-20s %6.2f ms/step  stretch %.3f  max %.3f\n", mode.name, ms, stretch, maxStretch);
+}
+
+int main(int argc, char** argv)
+{
+	B2_NOT_USED(argc);
+	B2_NOT_USED(argv);
+
+	printf("%d towers of %d boxes, %d steps at 60 Hz\n", e_towerCount, e_boxCount, e_stepCount);
+
+	const SolverMode modes[] =
+	{
+		{ "Step(dt, 10, 8)", 10, 8, 0, false },
+		{ "Step(dt, 8, 3)", 8, 3, 0, false },
+		{ "soft, 3 substeps", 8, 3, 3, false },
+		{ "soft, 4 substeps", 8, 3, 4, false }
+	};
+
+	for (int32 i = 0; i < int32(sizeof(modes) / sizeof(modes[0])); ++i)
+	{
+		RunTowers(modes[i]);
+	}
+
+	printf("\n%d link chain with a heavy end, %d steps at 60 Hz\n", e_linkCount, e_stepCount);
+
+	const SolverMode chainModes[] =
+	{
+		{ "Step(dt, 8, 3)", 8, 3, 0, false },
+		{ "Step(dt, 20, 3)", 20, 3, 0, false },
+		{ "tree, Step(dt, 8, 3)", 8, 3, 0, true },
+		{ "tree, soft, 4", 8, 3, 4, true }
+	};
+
+	for (int32 i = 0; i < int32(sizeof(chainModes) / sizeof(chainModes[0])); ++i)
+	{
+		RunChain(chainModes[i]);
+	}
+
+	return 0;
+}
@@ -17,6 +17,7 @@
 */
 
 #include <Box2D/Collision/b2BroadPhase.h>
+#include <Box2D/Common/b2TaskScheduler.h>
 #include <cstring>
 using namespace std;
 
@@ -31,17 +32,56 @@ b2BroadPhase::b2BroadPhase()
 	m_moveCapacity = 16;
 	m_moveCount = 0;
 	m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+
+	m_taskScheduler = NULL;
+	m_threadQueries = NULL;
+	m_threadQueryCount = 0;
+
+	m_treeRebuildFactor = 0.0f;
+	m_treeOptimizeIterations = 0;
 }
 
 b2BroadPhase::~b2BroadPhase()
 {
+	SetTaskScheduler(NULL);
+
 	b2Free(m_moveBuffer);
 	b2Free(m_pairBuffer);
 }
 
-int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
+void b2BroadPhase::SetTaskScheduler(b2TaskScheduler* taskScheduler)
+{
+	for (int32 i = 0; i < m_threadQueryCount; ++i)
+	{
+		b2Free(m_threadQueries[i].pairBuffer);
+	}
+	b2Free(m_threadQueries);
+	m_threadQueries = NULL;
+	m_threadQueryCount = 0;
+
+	m_taskScheduler = taskScheduler;
+	if (m_taskScheduler == NULL)
+	{
+		return;
+	}
+
+	// Each thread gathers pairs into its own buffer.
+	m_threadQueryCount = m_taskScheduler->GetThreadCount();
+	m_threadQueries = (b2PairQuery*)b2Alloc(m_threadQueryCount * sizeof(b2PairQuery));
+	for (int32 i = 0; i < m_threadQueryCount; ++i)
+	{
+		b2PairQuery* query = m_threadQueries + i;
+		query->pairCapacity = 16;
+		query->pairCount = 0;
+		query->pairBuffer = (b2Pair*)b2Alloc(query->pairCapacity * sizeof(b2Pair));
+		query->queryProxyId = e_nullProxy;
+	}
+}
+
+int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData, int32 tree)
 {
-	int32 proxyId = m_tree.CreateProxy(aabb, userData);
+	b2Assert(0 <= tree && tree < e_treeCount);
+	int32 proxyId = b2MakeProxyId(tree, m_trees[tree].CreateProxy(aabb, userData));
 	++m_proxyCount;
 	BufferMove(proxyId);
 	return proxyId;
@@ -51,12 +91,12 @@ void b2BroadPhase::DestroyProxy(int32 proxyId)
 {
 	UnBufferMove(proxyId);
 	--m_proxyCount;
-	m_tree.DestroyProxy(proxyId);
+	m_trees[b2GetProxyTree(proxyId)].DestroyProxy(b2GetProxyNode(proxyId));
 }
 
 void b2BroadPhase::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
 {
-	bool buffer = m_tree.MoveProxy(proxyId, aabb, displacement);
+	bool buffer = m_trees[b2GetProxyTree(proxyId)].MoveProxy(b2GetProxyNode(proxyId), aabb, displacement);
 	if (buffer)
 	{
 		BufferMove(proxyId);
@@ -95,7 +135,8 @@ void b2BroadPhase::UnBufferMove(int32 proxyId)
 	}
 }
 
-// This is called from b2DynamicTree::Query when we are gathering pairs.
+// This is called from b2DynamicTree::Query through b2TreeQueryWrapper when we
+// are gathering pairs.
 bool b2BroadPhase::QueryCallback(int32 proxyId)
 {
 	// A proxy cannot form a pair with itself.
@@ -120,3 +161,152 @@ bool b2BroadPhase::QueryCallback(int32 proxyId)
 
 	return true;
 }
+
+// This is called from b2DynamicTree::Query by each thread in FindPairs.
+bool b2PairQuery::QueryCallback(int32 proxyId)
+{
+	// A proxy cannot form a pair with itself.
+	if (proxyId == queryProxyId)
+	{
+		return true;
+	}
+
+	// Grow the pair buffer as needed.
+	if (pairCount == pairCapacity)
+	{
+		b2Pair* oldBuffer = pairBuffer;
+		pairCapacity *= 2;
+		pairBuffer = (b2Pair*)b2Alloc(pairCapacity * sizeof(b2Pair));
+		memcpy(pairBuffer, oldBuffer, pairCount * sizeof(b2Pair));
+		b2Free(oldBuffer);
+	}
+
+	pairBuffer[pairCount].proxyIdA = b2Min(proxyId, queryProxyId);
+	pairBuffer[pairCount].proxyIdB = b2Max(proxyId, queryProxyId);
+	++pairCount;
+
+	return true;
+}
+
+// The number of moved proxies handed to a thread at a time by FindPairs.
+const int32 b2_pairQueryGrainSize = 16;
+
+// Queries the tree for a range of the move buffer. The pairs go to the buffer of
+// the executing thread, so which buffer holds a pair depends on scheduling.
+struct b2QueryPairsTask : public b2ParallelTask
+{
+	void Execute(int32 begin, int32 end, int32 threadIndex)
+	{
+		b2PairQuery* query = queries + threadIndex;
+		for (int32 i = begin; i < end; ++i)
+		{
+			query->queryProxyId = moveBuffer[i];
+			if (query->queryProxyId == b2BroadPhase::e_nullProxy)
+			{
+				continue;
+			}
+
+			broadPhase->QueryPairs(query, query->queryProxyId);
+		}
+	}
+
+	const b2BroadPhase* broadPhase;
+	const int32* moveBuffer;
+	b2PairQuery* queries;
+};
+
+// Sorts the pair buffer of each thread.
+struct b2SortPairsTask : public b2ParallelTask
+{
+	void Execute(int32 begin, int32 end, int32 threadIndex)
+	{
+		B2_NOT_USED(threadIndex);
+		for (int32 i = begin; i < end; ++i)
+		{
+			b2PairQuery* query = queries + i;
+			std::sort(query->pairBuffer, query->pairBuffer + query->pairCount, b2PairLessThan);
+		}
+	}
+
+	b2PairQuery* queries;
+};
+
+void b2BroadPhase::FindPairs()
+{
+	for (int32 i = 0; i < m_threadQueryCount; ++i)
+	{
+		m_threadQueries[i].pairCount = 0;
+	}
+
+	b2QueryPairsTask queryTask;
+	queryTask.broadPhase = this;
+	queryTask.moveBuffer = m_moveBuffer;
+	queryTask.queries = m_threadQueries;
+	m_taskScheduler->ParallelFor(&queryTask, m_moveCount, b2_pairQueryGrainSize);
+
+	b2SortPairsTask sortTask;
+	sortTask.queries = m_threadQueries;
+	m_taskScheduler->ParallelFor(&sortTask, m_threadQueryCount, 1);
+
+	int32 totalCount = 0;
+	for (int32 i = 0; i < m_threadQueryCount; ++i)
+	{
+		totalCount += m_threadQueries[i].pairCount;
+	}
+
+	if (m_pairCapacity < totalCount)
+	{
+		b2Free(m_pairBuffer);
+		m_pairCapacity = b2Max(totalCount, 2 * m_pairCapacity);
+		m_pairBuffer = (b2Pair*)b2Alloc(m_pairCapacity * sizeof(b2Pair));
+	}
+
+	// Merge the sorted buffers and drop duplicates. The result doesn't depend
+	// on which thread found a pair.
+	int32 heads[b2_maxThreads];
+	for (int32 i = 0; i < m_threadQueryCount; ++i)
+	{
+		heads[i] = 0;
+	}
+
+	m_pairCount = 0;
+	for (;;)
+	{
+		const b2Pair* minPair = NULL;
+		int32 minIndex = -1;
+		for (int32 i = 0; i < m_threadQueryCount; ++i)
+		{
+			const b2PairQuery* query = m_threadQueries + i;
+			if (heads[i] == query->pairCount)
+			{
+				continue;
+			}
+
+			const b2Pair* pair = query->pairBuffer + heads[i];
+			if (minPair == NULL || b2PairLessThan(*pair, *minPair))
+			{
+				minPair = pair;
+				minIndex = i;
+			}
+		}
+
+		if (minPair == NULL)
+		{
+			break;
+		}
+
+		++heads[minIndex];
+
+		if (m_pairCount > 0)
+		{
+			const b2Pair* lastPair = m_pairBuffer + m_pairCount - 1;
+			if (lastPair->proxyIdA == minPair->proxyIdA && lastPair->proxyIdB == minPair->proxyIdB)
+			{
+				continue;
+			}
+		}
+
+		m_pairBuffer[m_pairCount] = *minPair;
+		++m_pairCount;
+	}
+}
@@ -24,6 +24,26 @@
 #include <Box2D/Collision/b2DynamicTree.h>
 #include <algorithm>
 
+class b2TaskScheduler;
+
+/// Get the tree of a broad-phase proxy id.
+inline int32 b2GetProxyTree(int32 proxyId)
+{
+	return proxyId & 3;
+}
+
+/// Get the tree node of a broad-phase proxy id.
+inline int32 b2GetProxyNode(int32 proxyId)
+{
+	return proxyId >> 2;
+}
+
+/// Make a broad-phase proxy id from a tree and a node of that tree.
+inline int32 b2MakeProxyId(int32 tree, int32 nodeId)
+{
+	return (nodeId << 2) | tree;
+}
+
 struct b2Pair
 {
 	int32 proxyIdA;
@@ -31,9 +51,61 @@ struct b2Pair
 	int32 next;
 };
 
+/// Gathers the pairs found by one thread in b2BroadPhase::UpdatePairs.
+/// This is an internal structure.
+struct b2PairQuery
+{
+	bool QueryCallback(int32 proxyId);
+
+	b2Pair* pairBuffer;
+	int32 pairCapacity;
+	int32 pairCount;
+	int32 queryProxyId;
+};
+
+/// Passes the proxy ids of a tree to a query callback and remembers whether
+/// the callback stopped the query. This is an internal structure.
+template <typename T>
+struct b2TreeQueryWrapper
+{
+	bool QueryCallback(int32 nodeId)
+	{
+		proceed = callback->QueryCallback(b2MakeProxyId(tree, nodeId));
+		return proceed;
+	}
+
+	T* callback;
+	int32 tree;
+	bool proceed;
+};
+
+/// Passes the proxy ids of a tree to a ray-cast callback and remembers how far
+/// the callback clipped the ray. This is an internal structure.
+template <typename T>
+struct b2TreeRayCastWrapper
+{
+	float32 RayCastCallback(const b2RayCastInput& input, int32 nodeId)
+	{
+		float32 value = callback->RayCastCallback(input, b2MakeProxyId(tree, nodeId));
+		if (value >= 0.0f)
+		{
+			maxFraction = value;
+		}
+		return value;
+	}
+
+	T* callback;
+	int32 tree;
+	float32 maxFraction;
+};
+
 /// The broad-phase is used for computing pairs and performing volume queries and ray casts.
 /// This broad-phase does not persist pairs. Instead, this reports potentially new pairs.
 /// It is up to the client to consume the new pairs and to track subsequent overlap.
+/// The proxies of static, kinematic and dynamic bodies live in separate trees, so
+/// the static geometry doesn't deepen the queries of moving proxies and pairs that
+/// can't collide are never looked for. The static tree is rebuilt in bulk after
+/// proxies were added to it.
 class b2BroadPhase
 {
 public:
@@ -43,12 +115,22 @@ public:
 		e_nullProxy = -1
 	};
 
+	/// The trees, in the order of b2BodyType.
+	enum
+	{
+		e_staticTree = 0,
+		e_kinematicTree = 1,
+		e_dynamicTree = 2,
+		e_treeCount = 3
+	};
+
 	b2BroadPhase();
 	~b2BroadPhase();
 
-	/// Create a proxy with an initial AABB. Pairs are not reported until
-	/// UpdatePairs is called.
-	int32 CreateProxy(const b2AABB& aabb, void* userData);
+	/// Create a proxy with an initial AABB in one of the trees. Pairs are not
+	/// reported until UpdatePairs is called. Only pairs with a proxy in the
+	/// dynamic tree are reported.
+	int32 CreateProxy(const b2AABB& aabb, void* userData, int32 tree);
 
 	/// Destroy a proxy. It is up to the client to remove any pairs.
 	void DestroyProxy(int32 proxyId);
@@ -91,25 +173,51 @@ public:
 	template <typename T>
 	void RayCast(T* callback, const b2RayCastInput& input) const;
 
-	/// Get the height of the embedded tree.
+	/// Get the height of the tallest tree.
 	int32 GetTreeHeight() const;
 
-	/// Get the balance of the embedded tree.
+	/// Get the balance of the least balanced tree.
 	int32 GetTreeBalance() const;
 
-	/// Get the quality metric of the embedded tree.
+	/// Get the quality metric of the worst tree.
 	float32 GetTreeQuality() const;
 
+	/// Rebuild the kinematic and dynamic trees in UpdatePairs when their quality
+	/// metric grew beyond the factor times the metric after their last rebuild,
+	/// or never if the factor is zero. See b2DynamicTree::RebuildIfDegraded.
+	void SetTreeRebuildFactor(float32 factor);
+
+	/// Set the number of b2DynamicTree::Optimize iterations made on the
+	/// kinematic and dynamic trees in each UpdatePairs, or zero for none.
+	void SetTreeOptimizeIterations(int32 iterations);
+
+	/// Rebuild the trees now. Proxy ids stay the same.
+	void RebuildTree();
+
+	/// Run the tree queries of UpdatePairs on a task scheduler. The pairs are still
+	/// reported in the same order. Pass NULL to query on the calling thread.
+	void SetTaskScheduler(b2TaskScheduler* taskScheduler);
+
 private:
 
-	friend class b2DynamicTree;
+	template <typename T>
+	friend struct b2TreeQueryWrapper;
+	friend struct b2QueryPairsTask;
 
 	void BufferMove(int32 proxyId);
 	void UnBufferMove(int32 proxyId);
 
 	bool QueryCallback(int32 proxyId);
 
-	b2DynamicTree m_tree;
+	// Query the trees that may hold a partner of a moved proxy with its fat AABB.
+	template <typename T>
+	void QueryPairs(T* callback, int32 proxyId) const;
+
+	// Fill the pair buffer with the sorted, unique pairs of the moved proxies
+	// using the task scheduler.
+	void FindPairs();
+
+	b2DynamicTree m_trees[e_treeCount];
 
 	int32 m_proxyCount;
 
@@ -122,6 +230,13 @@ private:
 	int32 m_pairCount;
 
 	int32 m_queryProxyId;
+
+	b2TaskScheduler* m_taskScheduler;
+	b2PairQuery* m_threadQueries;
+	int32 m_threadQueryCount;
+
+	float32 m_treeRebuildFactor;
+	int32 m_treeOptimizeIterations;
 };
 
 /// This is used to sort pairs.
@@ -142,19 +257,19 @@ inline bool b2PairLessThan(const b2Pair& pair1, const b2Pair& pair2)
 
 inline void* b2BroadPhase::GetUserData(int32 proxyId) const
 {
-	return m_tree.GetUserData(proxyId);
+	return m_trees[b2GetProxyTree(proxyId)].GetUserData(b2GetProxyNode(proxyId));
 }
 
 inline bool b2BroadPhase::TestOverlap(int32 proxyIdA, int32 proxyIdB) const
 {
-	const b2AABB& aabbA = m_tree.GetFatAABB(proxyIdA);
-	const b2AABB& aabbB = m_tree.GetFatAABB(proxyIdB);
+	const b2AABB& aabbA = GetFatAABB(proxyIdA);
+	const b2AABB& aabbB = GetFatAABB(proxyIdB);
 	return b2TestOverlap(aabbA, aabbB);
 }
 
 inline const b2AABB& b2BroadPhase::GetFatAABB(int32 proxyId) const
 {
-	return m_tree.GetFatAABB(proxyId);
+	return m_trees[b2GetProxyTree(proxyId)].GetFatAABB(b2GetProxyNode(proxyId));
 }
 
 inline int32 b2BroadPhase::GetProxyCount() const
@@ -164,17 +279,75 @@ inline int32 b2BroadPhase::GetProxyCount() const
 
 inline int32 b2BroadPhase::GetTreeHeight() const
 {
-	return m_tree.GetHeight();
+	int32 height = 0;
+	for (int32 i = 0; i < e_treeCount; ++i)
+	{
+		height = b2Max(height, m_trees[i].GetHeight());
+	}
+	return height;
 }
 
 inline int32 b2BroadPhase::GetTreeBalance() const
 {
-	return m_tree.GetMaxBalance();
+	int32 balance = 0;
+	for (int32 i = 0; i < e_treeCount; ++i)
+	{
+		balance = b2Max(balance, m_trees[i].GetMaxBalance());
+	}
+	return balance;
 }
 
 inline float32 b2BroadPhase::GetTreeQuality() const
 {
-	return m_tree.GetAreaRatio();
+	float32 quality = 0.0f;
+	for (int32 i = 0; i < e_treeCount; ++i)
+	{
+		quality = b2Max(quality, m_trees[i].GetAreaRatio());
+	}
+	return quality;
+}
+
+inline void b2BroadPhase::SetTreeRebuildFactor(float32 factor)
+{
+	b2Assert(factor == 0.0f || factor >= 1.0f);
+	m_treeRebuildFactor = factor;
+}
+
+inline void b2BroadPhase::SetTreeOptimizeIterations(int32 iterations)
+{
+	b2Assert(iterations >= 0);
+	m_treeOptimizeIterations = iterations;
+}
+
+inline void b2BroadPhase::RebuildTree()
+{
+	for (int32 i = 0; i < e_treeCount; ++i)
+	{
+		m_trees[i].Rebuild();
+	}
+}
+
+template <typename T>
+inline void b2BroadPhase::QueryPairs(T* callback, int32 proxyId) const
+{
+	// We have to query the tree with the fat AABB so that
+	// we don't fail to create a pair that may touch later.
+	const b2AABB& fatAABB = GetFatAABB(proxyId);
+
+	// At least one body of a pair must be dynamic.
+	b2TreeQueryWrapper<T> wrapper;
+	wrapper.callback = callback;
+	wrapper.tree = e_dynamicTree;
+	m_trees[e_dynamicTree].Query(&wrapper, fatAABB);
+
+	if (b2GetProxyTree(proxyId) == e_dynamicTree)
+	{
+		wrapper.tree = e_kinematicTree;
+		m_trees[e_kinematicTree].Query(&wrapper, fatAABB);
+
+		wrapper.tree = e_staticTree;
+		m_trees[e_staticTree].Query(&wrapper, fatAABB);
+	}
 }
 
 template <typename T>
@@ -183,36 +356,65 @@ void b2BroadPhase::UpdatePairs(T* callback)
 	// Reset pair buffer
 	m_pairCount = 0;
 
-	// Perform tree queries for all moving proxies.
-	for (int32 i = 0; i < m_moveCount; ++i)
+	// The proxy ids survive a rebuild, so the move buffer stays valid. The
+	// static tree is rebuilt whenever it got worse, which is rare once the
+	// level is loaded.
+	m_trees[e_staticTree].RebuildIfDegraded(1.0f);
+	if (m_treeRebuildFactor > 0.0f)
 	{
-		m_queryProxyId = m_moveBuffer[i];
-		if (m_queryProxyId == e_nullProxy)
+		m_trees[e_kinematicTree].RebuildIfDegraded(m_treeRebuildFactor);
+		m_trees[e_dynamicTree].RebuildIfDegraded(m_treeRebuildFactor);
+	}
+
+	// Spend a little on the trees every step so that they don't degrade.
+	if (m_treeOptimizeIterations > 0)
+	{
+		m_trees[e_kinematicTree].Optimize(m_treeOptimizeIterations);
+		m_trees[e_dynamicTree].Optimize(m_treeOptimizeIterations);
+	}
+
+	// The proxies were moved for this step, so the trees won't change until the
+	// next one. The pair queries and the queries of the client share the wide
+	// nodes.
+	for (int32 i = 0; i < e_treeCount; ++i)
+	{
+		m_trees[i].UpdateWideNodes();
+	}
+
+	if (m_taskScheduler)
+	{
+		// The pairs come back sorted, so they are reported in the same order.
+		FindPairs();
+	}
+	else
+	{
+		// Perform tree queries for all moving proxies.
+		for (int32 i = 0; i < m_moveCount; ++i)
 		{
-			continue;
-		}
+			m_queryProxyId = m_moveBuffer[i];
+			if (m_queryProxyId == e_nullProxy)
+			{
+				continue;
+			}
 
-		// We have to query the tree with the fat AABB so that
-		// we don't fail to create a pair that may touch later.
-		const b2AABB& fatAABB = m_tree.GetFatAABB(m_queryProxyId);
+			// Query the trees, create pairs and add them pair buffer.
+			QueryPairs(this, m_queryProxyId);
+		}
 
-		// Query tree, create pairs and add them pair buffer.
-		m_tree.Query(this, fatAABB);
+		// Sort the pair buffer to expose duplicates.
+		std::sort(m_pairBuffer, m_pairBuffer + m_pairCount, b2PairLessThan);
 	}
 
 	// Reset move buffer
 	m_moveCount = 0;
 
-	// Sort the pair buffer to expose duplicates.
-	std::sort(m_pairBuffer, m_pairBuffer + m_pairCount, b2PairLessThan);
-
 	// Send the pairs back to the client.
 	int32 i = 0;
 	while (i < m_pairCount)
 	{
 		b2Pair* primaryPair = m_pairBuffer + i;
-		void* userDataA = m_tree.GetUserData(primaryPair->proxyIdA);
-		void* userDataB = m_tree.GetUserData(primaryPair->proxyIdB);
+		void* userDataA = GetUserData(primaryPair->proxyIdA);
+		void* userDataB = GetUserData(primaryPair->proxyIdB);
 
 		callback->AddPair(userDataA, userDataB);
 		++i;
@@ -228,21 +430,41 @@ void b2BroadPhase::UpdatePairs(T* callback)
 			++i;
 		}
 	}
-
-	// Try to keep the tree balanced.
-	//m_tree.Rebalance(4);
 }
 
 template <typename T>
 inline void b2BroadPhase::Query(T* callback, const b2AABB& aabb) const
 {
-	m_tree.Query(callback, aabb);
+	b2TreeQueryWrapper<T> wrapper;
+	wrapper.callback = callback;
+	wrapper.proceed = true;
+	for (int32 i = 0; i < e_treeCount && wrapper.proceed; ++i)
+	{
+		wrapper.tree = i;
+		m_trees[i].Query(&wrapper, aabb);
+	}
 }
 
 template <typename T>
 inline void b2BroadPhase::RayCast(T* callback, const b2RayCastInput& input) const
 {
-	m_tree.RayCast(callback, input);
+	// Each tree continues the ray where the previous one clipped it.
+	b2TreeRayCastWrapper<T> wrapper;
+	wrapper.callback = callback;
+	wrapper.maxFraction = input.maxFraction;
+	b2RayCastInput treeInput = input;
+	for (int32 i = 0; i < e_treeCount; ++i)
+	{
+		wrapper.tree = i;
+		treeInput.maxFraction = wrapper.maxFraction;
+		m_trees[i].RayCast(&wrapper, treeInput);
+
+		if (wrapper.maxFraction == 0.0f)
+		{
+			// The client has terminated the ray cast.
+			return;
+		}
+	}
 }
 
 #endif
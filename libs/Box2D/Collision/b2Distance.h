@@ -24,6 +24,10 @@
 
 class b2Shape;
 
+/// GJK statistics. The counters are kept per thread, so they only count the
+/// queries made on the calling thread, not those of the worker threads.
+extern thread_local int32 b2_gjkCalls, b2_gjkIters, b2_gjkMaxIters;
+
 /// A distance proxy is used by the GJK algorithm.
 /// It encapsulates any shape.
 struct b2DistanceProxy
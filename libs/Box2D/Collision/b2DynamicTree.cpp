@@ -44,12 +44,20 @@ b2DynamicTree::b2DynamicTree()
 	m_path = 0;
 
 	m_insertionCount = 0;
+
+	m_rebuildAreaRatio = 0.0f;
+	m_checkInsertionCount = 0;
+
+	m_wideNodeCapacity = 0;
+	m_wideNodeCount = 0;
+	m_wideNodes = NULL;
 }
 
 b2DynamicTree::~b2DynamicTree()
 {
 	// This frees the entire tree in one shot.
 	b2Free(m_nodes);
+	b2Free(m_wideNodes);
 }
 
 // Allocate a node from the pool. Grow the pool if necessary.
@@ -179,6 +187,8 @@ bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& d
 void b2DynamicTree::InsertLeaf(int32 leaf)
 {
 	++m_insertionCount;
+	++m_checkInsertionCount;
+	m_wideNodeCount = 0;
 
 	if (m_root == b2_nullNode)
 	{
@@ -318,6 +328,8 @@ void b2DynamicTree::InsertLeaf(int32 leaf)
 
 void b2DynamicTree::RemoveLeaf(int32 leaf)
 {
+	m_wideNodeCount = 0;
+
 	if (leaf == m_root)
 	{
 		m_root = b2_nullNode;
@@ -766,6 +778,503 @@ void b2DynamicTree::RebuildBottomUp()
 
 	m_root = nodes[0];
 	b2Free(nodes);
+	m_wideNodeCount = 0;
 
 	Validate();
 }
+
+// A range of sorted leaves to split below a parent node, see b2DynamicTree::Rebuild.
+struct b2TreeBuildRange
+{
+	int32 start;
+	int32 count;
+	int32 parent;
+	bool first;
+};
+
+struct b2TreeBuildKey
+{
+	uint32 code;
+	int32 leaf;
+};
+
+// Spread the low 16 bits of x to the even bits.
+inline uint32 b2SpreadTreeBits(uint32 x)
+{
+	x &= 0x0000ffff;
+	x = (x | (x << 8)) & 0x00ff00ff;
+	x = (x | (x << 4)) & 0x0f0f0f0f;
+	x = (x | (x << 2)) & 0x33333333;
+	x = (x | (x << 1)) & 0x55555555;
+	return x;
+}
+
+void b2DynamicTree::Rebuild()
+{
+	m_wideNodeCount = 0;
+
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	// Gather the leaves and free the internal nodes. The leaves keep their ids.
+	b2TreeBuildKey* keys = (b2TreeBuildKey*)b2Alloc(m_nodeCount * sizeof(b2TreeBuildKey));
+	int32 leafCount = 0;
+	b2Vec2 lower(b2_maxFloat, b2_maxFloat);
+	b2Vec2 upper(-b2_maxFloat, -b2_maxFloat);
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		if (m_nodes[i].height < 0)
+		{
+			// free node in pool
+			continue;
+		}
+
+		if (m_nodes[i].IsLeaf())
+		{
+			b2Vec2 center = m_nodes[i].aabb.GetCenter();
+			lower = b2Min(lower, center);
+			upper = b2Max(upper, center);
+			keys[leafCount].leaf = i;
+			++leafCount;
+		}
+		else
+		{
+			FreeNode(i);
+		}
+	}
+
+	// Quantize the centers to a 16 bit grid over their bounds, with square
+	// cells, and interleave the bits of the cell coordinates.
+	float32 extent = b2Max(upper.x - lower.x, upper.y - lower.y);
+	float32 scale = extent > 0.0f ? 65535.0f / extent : 0.0f;
+	for (int32 i = 0; i < leafCount; ++i)
+	{
+		b2Vec2 d = m_nodes[keys[i].leaf].aabb.GetCenter() - lower;
+		uint32 x = uint32(scale * d.x);
+		uint32 y = uint32(scale * d.y);
+		keys[i].code = b2SpreadTreeBits(x) | (b2SpreadTreeBits(y) << 1);
+	}
+
+	// Sort the keys by code, a byte per pass.
+	b2TreeBuildKey* sorted = (b2TreeBuildKey*)b2Alloc(leafCount * sizeof(b2TreeBuildKey));
+	for (uint32 shift = 0; shift < 32; shift += 8)
+	{
+		int32 offsets[256];
+		memset(offsets, 0, sizeof(offsets));
+		for (int32 i = 0; i < leafCount; ++i)
+		{
+			++offsets[(keys[i].code >> shift) & 0xff];
+		}
+
+		int32 offset = 0;
+		for (int32 i = 0; i < 256; ++i)
+		{
+			int32 count = offsets[i];
+			offsets[i] = offset;
+			offset += count;
+		}
+
+		for (int32 i = 0; i < leafCount; ++i)
+		{
+			sorted[offsets[(keys[i].code >> shift) & 0xff]++] = keys[i];
+		}
+
+		b2Swap(keys, sorted);
+	}
+	b2Free(sorted);
+
+	// The internal nodes in the order they were made. Parents come before
+	// their children.
+	int32* internalNodes = (int32*)b2Alloc(b2Max(leafCount - 1, 1) * sizeof(int32));
+	int32 internalCount = 0;
+
+	b2GrowableStack<b2TreeBuildRange, 64> stack;
+	b2TreeBuildRange root;
+	root.start = 0;
+	root.count = leafCount;
+	root.parent = b2_nullNode;
+	root.first = true;
+	stack.Push(root);
+
+	while (stack.GetCount() > 0)
+	{
+		b2TreeBuildRange range = stack.Pop();
+		const b2TreeBuildKey* rangeKeys = keys + range.start;
+
+		int32 nodeId;
+		if (range.count == 1)
+		{
+			nodeId = rangeKeys[0].leaf;
+		}
+		else
+		{
+			nodeId = AllocateNode();
+			internalNodes[internalCount++] = nodeId;
+
+			// Split where the highest bit that differs in the range turns on.
+			// Leaves in the same cell are split in half.
+			int32 leftCount = range.count / 2;
+			uint32 diff = rangeKeys[0].code ^ rangeKeys[range.count - 1].code;
+			if (diff != 0)
+			{
+				uint32 bit = 0x80000000;
+				while ((diff & bit) == 0)
+				{
+					bit >>= 1;
+				}
+
+				int32 low = 1;
+				int32 high = range.count - 1;
+				while (low < high)
+				{
+					int32 mid = (low + high) >> 1;
+					if (rangeKeys[mid].code & bit)
+					{
+						high = mid;
+					}
+					else
+					{
+						low = mid + 1;
+					}
+				}
+				leftCount = low;
+			}
+
+			b2TreeBuildRange right;
+			right.start = range.start + leftCount;
+			right.count = range.count - leftCount;
+			right.parent = nodeId;
+			right.first = false;
+			stack.Push(right);
+
+			b2TreeBuildRange left;
+			left.start = range.start;
+			left.count = leftCount;
+			left.parent = nodeId;
+			left.first = true;
+			stack.Push(left);
+		}
+
+		m_nodes[nodeId].parent = range.parent;
+		if (range.parent == b2_nullNode)
+		{
+			m_root = nodeId;
+		}
+		else if (range.first)
+		{
+			m_nodes[range.parent].child1 = nodeId;
+		}
+		else
+		{
+			m_nodes[range.parent].child2 = nodeId;
+		}
+	}
+
+	// Children were made after their parents.
+	for (int32 i = internalCount - 1; i >= 0; --i)
+	{
+		b2TreeNode* node = m_nodes + internalNodes[i];
+		const b2TreeNode* child1 = m_nodes + node->child1;
+		const b2TreeNode* child2 = m_nodes + node->child2;
+		node->aabb.Combine(child1->aabb, child2->aabb);
+		node->height = 1 + b2Max(child1->height, child2->height);
+	}
+
+	b2Free(internalNodes);
+	b2Free(keys);
+
+	m_rebuildAreaRatio = GetAreaRatio();
+	m_checkInsertionCount = 0;
+}
+
+// Can a child of height heightDown swap places with a grandchild of height
+// heightUp whose sibling has height heightStay? Balance restores the heights
+// on insertion and would undo the rotation, so it must keep every node balanced
+// and the height of A the same.
+static bool b2CanRotate(int32 heightA, int32 heightDown, int32 heightUp, int32 heightStay)
+{
+	int32 heightP = 1 + b2Max(heightDown, heightStay);
+	return b2Abs(heightDown - heightStay) <= 1 && b2Abs(heightUp - heightP) <= 1 && 1 + b2Max(heightUp, heightP) == heightA;
+}
+
+// Swap a child of node A with a grandchild on the other side if that makes the
+// other child smaller. B and C are the children of A, D and E those of B, and F
+// and G those of C. The box and height of A don't change, so the ancestors
+// don't need fixing.
+bool b2DynamicTree::Rotate(int32 iA)
+{
+	b2TreeNode* A = m_nodes + iA;
+	if (A->height < 2)
+	{
+		return false;
+	}
+
+	int32 iB = A->child1;
+	int32 iC = A->child2;
+	b2TreeNode* B = m_nodes + iB;
+	b2TreeNode* C = m_nodes + iC;
+
+	// The best swap as the child of A to move down and the grandchild to move up.
+	float32 bestCost = 0.0f;
+	int32 down = b2_nullNode;
+	int32 up = b2_nullNode;
+
+	if (C->IsLeaf() == false)
+	{
+		const b2TreeNode* F = m_nodes + C->child1;
+		const b2TreeNode* G = m_nodes + C->child2;
+		float32 area = C->aabb.GetPerimeter();
+		b2AABB aabb;
+
+		// Swap B and F
+		if (b2CanRotate(A->height, B->height, F->height, G->height))
+		{
+			aabb.Combine(B->aabb, G->aabb);
+			float32 cost = aabb.GetPerimeter() - area;
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				down = iB;
+				up = C->child1;
+			}
+		}
+
+		// Swap B and G
+		if (b2CanRotate(A->height, B->height, G->height, F->height))
+		{
+			aabb.Combine(B->aabb, F->aabb);
+			float32 cost = aabb.GetPerimeter() - area;
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				down = iB;
+				up = C->child2;
+			}
+		}
+	}
+
+	if (B->IsLeaf() == false)
+	{
+		const b2TreeNode* D = m_nodes + B->child1;
+		const b2TreeNode* E = m_nodes + B->child2;
+		float32 area = B->aabb.GetPerimeter();
+		b2AABB aabb;
+
+		// Swap C and D
+		if (b2CanRotate(A->height, C->height, D->height, E->height))
+		{
+			aabb.Combine(C->aabb, E->aabb);
+			float32 cost = aabb.GetPerimeter() - area;
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				down = iC;
+				up = B->child1;
+			}
+		}
+
+		// Swap C and E
+		if (b2CanRotate(A->height, C->height, E->height, D->height))
+		{
+			aabb.Combine(C->aabb, D->aabb);
+			float32 cost = aabb.GetPerimeter() - area;
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				down = iC;
+				up = B->child2;
+			}
+		}
+	}
+
+	if (down == b2_nullNode)
+	{
+		return false;
+	}
+
+	// The grandchild takes the place of the child in A and the other way around
+	// in its parent.
+	int32 iP = m_nodes[up].parent;
+	b2TreeNode* P = m_nodes + iP;
+	if (A->child1 == down)
+	{
+		A->child1 = up;
+	}
+	else
+	{
+		A->child2 = up;
+	}
+
+	if (P->child1 == up)
+	{
+		P->child1 = down;
+	}
+	else
+	{
+		P->child2 = down;
+	}
+
+	m_nodes[up].parent = iA;
+	m_nodes[down].parent = iP;
+
+	P->aabb.Combine(m_nodes[P->child1].aabb, m_nodes[P->child2].aabb);
+	P->height = 1 + b2Max(m_nodes[P->child1].height, m_nodes[P->child2].height);
+	b2Assert(A->height == 1 + b2Max(m_nodes[A->child1].height, m_nodes[A->child2].height));
+
+	return true;
+}
+
+int32 b2DynamicTree::Optimize(int32 iterations)
+{
+	if (m_root == b2_nullNode)
+	{
+		return 0;
+	}
+
+	int32 rotationCount = 0;
+	for (int32 i = 0; i < iterations; ++i)
+	{
+		// The bits of the path pick the children, so consecutive paths part
+		// at the root and the walks spread over the tree.
+		int32 node = m_root;
+		uint32 bit = 0;
+		while (m_nodes[node].height >= 2)
+		{
+			if (Rotate(node))
+			{
+				++rotationCount;
+			}
+
+			node = (m_path >> bit) & 1 ? m_nodes[node].child2 : m_nodes[node].child1;
+			bit = (bit + 1) & 31;
+		}
+
+		++m_path;
+	}
+
+	if (rotationCount > 0)
+	{
+		m_wideNodeCount = 0;
+	}
+
+	return rotationCount;
+}
+
+bool b2DynamicTree::RebuildIfDegraded(float32 factor)
+{
+	if (m_root == b2_nullNode)
+	{
+		return false;
+	}
+
+	if (m_rebuildAreaRatio > 0.0f)
+	{
+		if (16 * m_checkInsertionCount < m_nodeCount)
+		{
+			return false;
+		}
+
+		m_checkInsertionCount = 0;
+		if (GetAreaRatio() <= factor * m_rebuildAreaRatio)
+		{
+			return false;
+		}
+	}
+
+	Rebuild();
+	return true;
+}
+
+// Set a child slot of a wide node. Internal nodes get a new wide node that is
+// filled later from the stack.
+static void b2SetWideChild(b2TreeNode4* node, int32 slot, const b2AABB& aabb, int32 child)
+{
+	node->lowerX[slot] = aabb.lowerBound.x;
+	node->lowerY[slot] = aabb.lowerBound.y;
+	node->upperX[slot] = aabb.upperBound.x;
+	node->upperY[slot] = aabb.upperBound.y;
+	node->children[slot] = child;
+}
+
+void b2DynamicTree::UpdateWideNodes()
+{
+	if (m_wideNodeCount > 0 || m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	// Each wide node but the root replaces at least one internal node, so the
+	// node count is enough.
+	if (m_wideNodeCapacity < m_nodeCount)
+	{
+		b2Free(m_wideNodes);
+		m_wideNodeCapacity = m_nodeCapacity;
+		m_wideNodes = (b2TreeNode4*)b2Alloc(m_wideNodeCapacity * sizeof(b2TreeNode4));
+	}
+
+	// Pairs of a wide node and the binary node whose grandchildren it holds.
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(m_root);
+	stack.Push(0);
+	int32 wideNodeCount = 1;
+
+	b2AABB empty;
+	empty.lowerBound.Set(b2_maxFloat, b2_maxFloat);
+	empty.upperBound.Set(-b2_maxFloat, -b2_maxFloat);
+
+	while (stack.GetCount() > 0)
+	{
+		b2TreeNode4* wideNode = m_wideNodes + stack.Pop();
+		const b2TreeNode* node = m_nodes + stack.Pop();
+
+		int32 candidates[4];
+		int32 candidateCount = 0;
+		if (node->IsLeaf())
+		{
+			candidates[candidateCount++] = int32(node - m_nodes);
+		}
+		else
+		{
+			int32 children[2] = { node->child1, node->child2 };
+			for (int32 i = 0; i < 2; ++i)
+			{
+				const b2TreeNode* child = m_nodes + children[i];
+				if (child->IsLeaf())
+				{
+					candidates[candidateCount++] = children[i];
+				}
+				else
+				{
+					candidates[candidateCount++] = child->child1;
+					candidates[candidateCount++] = child->child2;
+				}
+			}
+		}
+
+		for (int32 i = 0; i < candidateCount; ++i)
+		{
+			const b2TreeNode* candidate = m_nodes + candidates[i];
+			if (candidate->IsLeaf())
+			{
+				b2SetWideChild(wideNode, i, candidate->aabb, b2EncodeWideLeaf(candidates[i]));
+			}
+			else
+			{
+				b2Assert(wideNodeCount < m_wideNodeCapacity);
+				b2SetWideChild(wideNode, i, candidate->aabb, wideNodeCount);
+				stack.Push(candidates[i]);
+				stack.Push(wideNodeCount);
+				++wideNodeCount;
+			}
+		}
+
+		for (int32 i = candidateCount; i < 4; ++i)
+		{
+			b2SetWideChild(wideNode, i, empty, b2_nullNode);
+		}
+	}
+
+	m_wideNodeCount = wideNodeCount;
+}
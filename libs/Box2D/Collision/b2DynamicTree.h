@@ -22,6 +22,11 @@
 #include <Box2D/Collision/b2Collision.h>
 #include <Box2D/Common/b2GrowableStack.h>
 
+#if !defined(B2_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define B2_TREE_SSE2 1
+#include <emmintrin.h>
+#endif
+
 #define b2_nullNode (-1)
 
 /// A node in the dynamic tree. The client does not interact with this directly.
@@ -50,6 +55,108 @@ struct b2TreeNode
 	int32 height;
 };
 
+/// Up to four nodes of the dynamic tree side by side, with their AABBs stored
+/// component by component so that all of them are tested at once. A child is
+/// the index of another wide node, a proxy encoded by b2EncodeWideLeaf, or
+/// b2_nullNode for an unused slot, whose AABB is empty. The client does not
+/// interact with this directly.
+struct b2TreeNode4
+{
+	float32 lowerX[4];
+	float32 lowerY[4];
+	float32 upperX[4];
+	float32 upperY[4];
+	int32 children[4];
+};
+
+inline int32 b2EncodeWideLeaf(int32 proxyId)
+{
+	return -2 - proxyId;
+}
+
+inline int32 b2DecodeWideLeaf(int32 child)
+{
+	return -2 - child;
+}
+
+inline bool b2IsWideLeaf(int32 child)
+{
+	return child < b2_nullNode;
+}
+
+/// Test the children of a wide node against an AABB. Bit i of the result is
+/// set if child i overlaps.
+inline int32 b2TestOverlap4(const b2TreeNode4* node, const b2AABB& aabb)
+{
+#if defined(B2_TREE_SSE2)
+	__m128 lowerX = _mm_loadu_ps(node->lowerX);
+	__m128 lowerY = _mm_loadu_ps(node->lowerY);
+	__m128 upperX = _mm_loadu_ps(node->upperX);
+	__m128 upperY = _mm_loadu_ps(node->upperY);
+	__m128 x = _mm_and_ps(_mm_cmple_ps(lowerX, _mm_set1_ps(aabb.upperBound.x)), _mm_cmple_ps(_mm_set1_ps(aabb.lowerBound.x), upperX));
+	__m128 y = _mm_and_ps(_mm_cmple_ps(lowerY, _mm_set1_ps(aabb.upperBound.y)), _mm_cmple_ps(_mm_set1_ps(aabb.lowerBound.y), upperY));
+	return _mm_movemask_ps(_mm_and_ps(x, y));
+#else
+	int32 mask = 0;
+	for (int32 i = 0; i < 4; ++i)
+	{
+		if (node->lowerX[i] <= aabb.upperBound.x && aabb.lowerBound.x <= node->upperX[i] &&
+			node->lowerY[i] <= aabb.upperBound.y && aabb.lowerBound.y <= node->upperY[i])
+		{
+			mask |= 1 << i;
+		}
+	}
+	return mask;
+#endif
+}
+
+/// Test the children of a wide node against a segment with the bounding box and
+/// the separating axis of b2DynamicTree::RayCast. Bit i of the result is set if
+/// child i may be hit.
+inline int32 b2TestSegment4(const b2TreeNode4* node, const b2AABB& segmentAABB,
+							const b2Vec2& p1, const b2Vec2& v, const b2Vec2& abs_v)
+{
+#if defined(B2_TREE_SSE2)
+	__m128 lowerX = _mm_loadu_ps(node->lowerX);
+	__m128 lowerY = _mm_loadu_ps(node->lowerY);
+	__m128 upperX = _mm_loadu_ps(node->upperX);
+	__m128 upperY = _mm_loadu_ps(node->upperY);
+	__m128 x = _mm_and_ps(_mm_cmple_ps(lowerX, _mm_set1_ps(segmentAABB.upperBound.x)), _mm_cmple_ps(_mm_set1_ps(segmentAABB.lowerBound.x), upperX));
+	__m128 y = _mm_and_ps(_mm_cmple_ps(lowerY, _mm_set1_ps(segmentAABB.upperBound.y)), _mm_cmple_ps(_mm_set1_ps(segmentAABB.lowerBound.y), upperY));
+
+	// |dot(v, p1 - c)| - dot(|v|, h) <= 0
+	__m128 half = _mm_set1_ps(0.5f);
+	__m128 cx = _mm_mul_ps(half, _mm_add_ps(lowerX, upperX));
+	__m128 cy = _mm_mul_ps(half, _mm_add_ps(lowerY, upperY));
+	__m128 hx = _mm_mul_ps(half, _mm_sub_ps(upperX, lowerX));
+	__m128 hy = _mm_mul_ps(half, _mm_sub_ps(upperY, lowerY));
+	__m128 d = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(v.x), _mm_sub_ps(_mm_set1_ps(p1.x), cx)),
+		_mm_mul_ps(_mm_set1_ps(v.y), _mm_sub_ps(_mm_set1_ps(p1.y), cy)));
+	d = _mm_andnot_ps(_mm_set1_ps(-0.0f), d);
+	__m128 e = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(abs_v.x), hx), _mm_mul_ps(_mm_set1_ps(abs_v.y), hy));
+	__m128 s = _mm_cmple_ps(_mm_sub_ps(d, e), _mm_setzero_ps());
+
+	return _mm_movemask_ps(_mm_and_ps(_mm_and_ps(x, y), s));
+#else
+	int32 mask = 0;
+	for (int32 i = 0; i < 4; ++i)
+	{
+		if (node->lowerX[i] <= segmentAABB.upperBound.x && segmentAABB.lowerBound.x <= node->upperX[i] &&
+			node->lowerY[i] <= segmentAABB.upperBound.y && segmentAABB.lowerBound.y <= node->upperY[i])
+		{
+			b2Vec2 c(0.5f * (node->lowerX[i] + node->upperX[i]), 0.5f * (node->lowerY[i] + node->upperY[i]));
+			b2Vec2 h(0.5f * (node->upperX[i] - node->lowerX[i]), 0.5f * (node->upperY[i] - node->lowerY[i]));
+			float32 separation = b2Abs(b2Dot(v, p1 - c)) - b2Dot(abs_v, h);
+			if (separation <= 0.0f)
+			{
+				mask |= 1 << i;
+			}
+		}
+	}
+	return mask;
+#endif
+}
+
 /// A dynamic AABB tree broad-phase, inspired by Nathanael Presson's btDbvt.
 /// A dynamic tree arranges data in a binary tree to accelerate
 /// queries such as volume queries and ray casts. Leafs are proxies
@@ -58,6 +165,9 @@ struct b2TreeNode
 /// object to move by small amounts without triggering a tree update.
 ///
 /// Nodes are pooled and relocatable, so we use node indices rather than pointers.
+///
+/// Queries and ray casts walk a copy of the tree with four children per node
+/// when it is up to date, see UpdateWideNodes. Otherwise they walk the binary tree.
 class b2DynamicTree
 {
 public:
@@ -118,6 +228,36 @@ public:
 	/// Build an optimal tree. Very expensive. For testing.
 	void RebuildBottomUp();
 
+	/// Build a new tree from the proxies sorted along a Morton curve of their
+	/// centers, splitting each range where the curve crosses the next cell
+	/// boundary. This takes linear time, a few milliseconds for 50k proxies, and
+	/// gives a tree of about the quality of RebuildBottomUp. Proxy ids stay the
+	/// same.
+	void Rebuild();
+
+	/// Rebuild the tree if the area ratio grew beyond the factor times the ratio
+	/// after the last rebuild. The ratio is measured once the proxies were
+	/// inserted or moved a sixteenth of the node count times since the last
+	/// measure. The first call always rebuilds.
+	/// @return true if the tree was rebuilt.
+	bool RebuildIfDegraded(float32 factor);
+
+	/// Improve the tree a little. Each iteration walks from the root to a
+	/// different leaf and rotates the nodes on the way where that shrinks the
+	/// perimeter of a child most, which is the surface area heuristic cost.
+	/// Successive calls cover the whole tree, so a few iterations per step keep
+	/// the quality from degrading without a rebuild.
+	/// @return the number of rotations made.
+	int32 Optimize(int32 iterations);
+
+	/// Build the wide nodes from the binary tree if it changed since they were
+	/// last built. This collapses every other level of the tree, so there are
+	/// half as many levels to walk and the four children of a node are tested
+	/// together. Any change to the tree drops the wide nodes until this is
+	/// called again. The broad-phase calls this when it updates the pairs, so the
+	/// world's queries and ray casts between two steps use the wide nodes.
+	void UpdateWideNodes();
+
 private:
 
 	int32 AllocateNode();
@@ -127,6 +267,7 @@ private:
 	void RemoveLeaf(int32 node);
 
 	int32 Balance(int32 index);
+	bool Rotate(int32 index);
 
 	int32 ComputeHeight() const;
 	int32 ComputeHeight(int32 nodeId) const;
@@ -142,10 +283,21 @@ private:
 
 	int32 m_freeList;
 
-	/// This is used to incrementally traverse the tree for re-balancing.
+	/// This picks the paths of Optimize, so that they cover the tree.
 	uint32 m_path;
 
 	int32 m_insertionCount;
+
+	/// The area ratio after the last rebuild, or zero if there was none, and the
+	/// insertions since the ratio was last measured.
+	float32 m_rebuildAreaRatio;
+	int32 m_checkInsertionCount;
+
+	/// The wide nodes, with the root at index 0. The count is zero while they
+	/// are out of date.
+	b2TreeNode4* m_wideNodes;
+	int32 m_wideNodeCount;
+	int32 m_wideNodeCapacity;
 };
 
 inline void* b2DynamicTree::GetUserData(int32 proxyId) const
@@ -163,6 +315,41 @@ inline const b2AABB& b2DynamicTree::GetFatAABB(int32 proxyId) const
 template <typename T>
 inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb) const
 {
+	if (m_wideNodeCount > 0)
+	{
+		b2GrowableStack<int32, 256> stack;
+		stack.Push(0);
+
+		while (stack.GetCount() > 0)
+		{
+			const b2TreeNode4* node = m_wideNodes + stack.Pop();
+			int32 mask = b2TestOverlap4(node, aabb);
+			for (int32 i = 0; i < 4; ++i)
+			{
+				if ((mask & (1 << i)) == 0)
+				{
+					continue;
+				}
+
+				int32 child = node->children[i];
+				if (b2IsWideLeaf(child))
+				{
+					bool proceed = callback->QueryCallback(b2DecodeWideLeaf(child));
+					if (proceed == false)
+					{
+						return;
+					}
+				}
+				else
+				{
+					stack.Push(child);
+				}
+			}
+		}
+
+		return;
+	}
+
 	b2GrowableStack<int32, 256> stack;
 	stack.Push(m_root);
 
@@ -221,6 +408,57 @@ inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) con
 		segmentAABB.upperBound = b2Max(p1, t);
 	}
 
+	if (m_wideNodeCount > 0)
+	{
+		b2GrowableStack<int32, 256> stack;
+		stack.Push(0);
+
+		while (stack.GetCount() > 0)
+		{
+			const b2TreeNode4* node = m_wideNodes + stack.Pop();
+			int32 mask = b2TestSegment4(node, segmentAABB, p1, v, abs_v);
+			for (int32 i = 0; i < 4; ++i)
+			{
+				if ((mask & (1 << i)) == 0)
+				{
+					continue;
+				}
+
+				int32 child = node->children[i];
+				if (b2IsWideLeaf(child) == false)
+				{
+					stack.Push(child);
+					continue;
+				}
+
+				b2RayCastInput subInput;
+				subInput.p1 = input.p1;
+				subInput.p2 = input.p2;
+				subInput.maxFraction = maxFraction;
+
+				float32 value = callback->RayCastCallback(subInput, b2DecodeWideLeaf(child));
+
+				if (value == 0.0f)
+				{
+					// The client has terminated the ray cast.
+					return;
+				}
+
+				if (value > 0.0f)
+				{
+					// Update segment bounding box. The remaining children of
+					// this node were tested against the old one.
+					maxFraction = value;
+					b2Vec2 t = p1 + maxFraction * (p2 - p1);
+					segmentAABB.lowerBound = b2Min(p1, t);
+					segmentAABB.upperBound = b2Max(p1, t);
+				}
+			}
+		}
+
+		return;
+	}
+
 	b2GrowableStack<int32, 256> stack;
 	stack.Push(m_root);
 
@@ -22,6 +22,11 @@
 #include <Box2D/Common/b2Math.h>
 #include <Box2D/Collision/b2Distance.h>
 
+/// Time of impact statistics. The counters are kept per thread, so they only
+/// count the queries made on the calling thread, not those of the worker threads.
+extern thread_local int32 b2_toiCalls, b2_toiIters, b2_toiMaxIters;
+extern thread_local int32 b2_toiRootIters, b2_toiMaxRootIters;
+
 /// Input parameters for b2TimeOfImpact
 struct b2TOIInput
 {
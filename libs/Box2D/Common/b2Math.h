@@ -60,6 +60,49 @@ inline float32 b2InvSqrt(float32 x)
 #define	b2Sqrt(x)	std::sqrt(x)
 #define	b2Atan2(y, x)	std::atan2(y, x)
 
+/// Compute the sine and cosine of an angle in radians together. The angle is
+/// reduced once for both, without libm calls for angles in [-8192, 8192], and
+/// the error there is within a few ulps of sinf and cosf. Larger angles fall
+/// back to sinf and cosf, because the reduction loses precision beyond that.
+inline void b2SinCos(float32 angle, float32* sine, float32* cosine)
+{
+	// This also catches NaN and infinity.
+	if ((angle >= -8192.0f && angle <= 8192.0f) == false)
+	{
+		*sine = sinf(angle);
+		*cosine = cosf(angle);
+		return;
+	}
+
+	// Reduce to x in [-pi/4, pi/4] with angle = x + k * pi/2. The multiple of
+	// pi/2 is subtracted in three parts that are exact in single precision.
+	float32 t = angle * 0.636619772f;
+	int32 quadrant = int32(t + (t >= 0.0f ? 0.5f : -0.5f));
+	float32 k = float32(quadrant);
+	float32 x = angle - k * 1.5703125f;
+	x -= k * 4.837512969970703125e-4f;
+	x -= k * 7.54978995489188216e-8f;
+
+	// Minimax polynomials on [-pi/4, pi/4] from the Cephes library.
+	float32 x2 = x * x;
+	union
+	{
+		float32 x;
+		uint32 i;
+	} s, c;
+	s.x = x + x * x2 * (-1.6666654611e-1f + x2 * (8.3321608736e-3f - x2 * 1.9515295891e-4f));
+	c.x = 1.0f - 0.5f * x2 + x2 * x2 * (4.166664568298827e-2f + x2 * (-1.388731625493765e-3f + x2 * 2.443315711809948e-5f));
+
+	// Swap and negate for the quadrant with bit masks.
+	uint32 swap = 0u - uint32(quadrant & 1);
+	uint32 sineBits = (s.i & ~swap) | (c.i & swap);
+	uint32 cosineBits = (c.i & ~swap) | (s.i & swap);
+	s.i = sineBits ^ (uint32(quadrant & 2) << 30);
+	c.i = cosineBits ^ (uint32((quadrant + 1) & 2) << 30);
+	*sine = s.x;
+	*cosine = c.x;
+}
+
 /// A 2D column vector.
 struct b2Vec2
 {
@@ -314,17 +357,13 @@ struct b2Rot
 	/// Initialize from an angle in radians
 	explicit b2Rot(float32 angle)
 	{
-		/// TODO_ERIN optimize
-		s = sinf(angle);
-		c = cosf(angle);
+		b2SinCos(angle, &s, &c);
 	}
 
 	/// Set using an angle in radians.
 	void Set(float32 angle)
 	{
-		/// TODO_ERIN optimize
-		s = sinf(angle);
-		c = cosf(angle);
+		b2SinCos(angle, &s, &c);
 	}
 
 	/// Set to the identity rotation
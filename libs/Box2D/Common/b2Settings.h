@@ -112,6 +112,28 @@ typedef double float64;
 #define b2_baumgarte				0.2f
 #define b2_toiBaugarte				0.75f
 
+/// The stiffness of contacts in the soft step solver, in cycles per second. It is
+/// limited to a quarter of the substep rate.
+#define b2_contactHertz				30.0f
+
+/// The damping ratio of contacts in the soft step solver. Contacts are heavily
+/// damped so that overlap is pushed out without bouncing.
+#define b2_contactDampingRatio		10.0f
+
+/// The maximum velocity used by the soft step solver to push out overlap.
+#define b2_contactPushoutVelocity	3.0f
+
+/// Islands with at least this many contacts and joints are solved with graph coloring
+/// when it is enabled on the world. Smaller islands use the sequential solver.
+#define b2_minColoredConstraints	256
+
+/// The number of colors used by graph coloring. Constraints that don't fit in a color
+/// are solved sequentially.
+#define b2_graphColorCount			24
+
+/// The most substeps taken by a fast moving island. See b2World::SetIslandSubStepRatio.
+#define b2_maxIslandSubSteps		8
+
 
 // Sleep
 
@@ -23,6 +23,7 @@
 
 const int32 b2_stackSize = 100 * 1024;	// 100k
 const int32 b2_maxStackEntries = 32;
+const int32 b2_stackAlignment = 8;
 
 struct b2StackEntry
 {
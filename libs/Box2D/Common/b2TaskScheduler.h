@@ -0,0 +1,83 @@
+/*
+* Copyright (c) 2012 Nusantara Software
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_TASK_SCHEDULER_H
+#define B2_TASK_SCHEDULER_H
+
+#include <Box2D/Common/b2Settings.h>
+
+/// The maximum number of threads the solver will use, including the calling thread.
+#define b2_maxThreads	32
+
+/// Implement this to run work over an index range with b2TaskScheduler::ParallelFor.
+class b2ParallelTask
+{
+public:
+	virtual ~b2ParallelTask() {}
+
+	/// Process the items [begin, end). This is called concurrently from several
+	/// threads, each with a distinct threadIndex in [0, thread count).
+	virtual void Execute(int32 begin, int32 end, int32 threadIndex) = 0;
+};
+
+/// Implement this to run the parallel phases of a time step on your own job
+/// system. See b2World::SetTaskScheduler. b2ThreadPool is the default.
+class b2TaskScheduler
+{
+public:
+	virtual ~b2TaskScheduler() {}
+
+	/// Get the number of threads that may execute ranges, including the thread
+	/// that calls Wait. This must not be more than b2_maxThreads and must not
+	/// change while the scheduler is in use.
+	virtual int32 GetThreadCount() const = 0;
+
+	/// Start executing [0, count) in ranges of at most grainSize items. Ranges
+	/// that run at the same time must be given distinct thread indices in
+	/// [0, thread count). Only one job is enqueued at a time.
+	/// @return a handle that is passed to Wait.
+	virtual void* Enqueue(b2ParallelTask* task, int32 count, int32 grainSize) = 0;
+
+	/// Return when every range of the enqueued job has been executed. The calling
+	/// thread may execute ranges as thread 0 while it waits.
+	virtual void Wait(void* job) = 0;
+
+	/// Enqueue a job and wait for it. Small jobs are executed on the calling thread.
+	void ParallelFor(b2ParallelTask* task, int32 count, int32 grainSize);
+};
+
+inline void b2TaskScheduler::ParallelFor(b2ParallelTask* task, int32 count, int32 grainSize)
+{
+	b2Assert(grainSize > 0);
+
+	if (count <= 0)
+	{
+		return;
+	}
+
+	// Not worth waking the other threads.
+	if (count <= grainSize || GetThreadCount() == 1)
+	{
+		task->Execute(0, count, 0);
+		return;
+	}
+
+	Wait(Enqueue(task, count, grainSize));
+}
+
+#endif
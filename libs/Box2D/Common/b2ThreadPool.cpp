@@ -0,0 +1,230 @@
+/*
+* Copyright (c) 2012 Nusantara Software
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Common/b2ThreadPool.h>
+#include <Box2D/Common/b2Math.h>
+#include <new>
+
+b2ThreadPool::b2ThreadPool(int32 threadCount)
+{
+	b2Assert(1 <= threadCount && threadCount <= b2_maxThreads);
+
+	m_threadCount = b2Clamp(threadCount, 1, b2_maxThreads);
+	m_task = NULL;
+	m_grainSize = 1;
+	for (int32 i = 0; i < b2_maxThreads; ++i)
+	{
+		m_ranges[i].next = 0;
+		m_ranges[i].end = 0;
+	}
+	m_busyCount = 0;
+	m_generation = 0;
+	m_exit = false;
+
+	// Thread 0 is the caller of Wait, so it has no std::thread.
+	int32 workerCount = m_threadCount - 1;
+	m_threads = (std::thread*)b2Alloc(b2Max(workerCount, 1) * sizeof(std::thread));
+	for (int32 i = 0; i < workerCount; ++i)
+	{
+		new (m_threads + i) std::thread(&b2ThreadPool::WorkerMain, this, i + 1);
+	}
+}
+
+int32 b2ThreadPool::GetHardwareThreadCount()
+{
+	// hardware_concurrency returns zero if it can't tell.
+	int32 count = int32(std::thread::hardware_concurrency());
+	return b2Clamp(count, 1, b2_maxThreads);
+}
+
+b2ThreadPool::~b2ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_exit = true;
+	}
+	m_wakeCondition.notify_all();
+
+	int32 workerCount = m_threadCount - 1;
+	for (int32 i = 0; i < workerCount; ++i)
+	{
+		m_threads[i].join();
+		m_threads[i].~thread();
+	}
+
+	b2Free(m_threads);
+}
+
+void* b2ThreadPool::Enqueue(b2ParallelTask* task, int32 count, int32 grainSize)
+{
+	b2Assert(grainSize > 0);
+	b2Assert(m_task == NULL);
+
+	// Give each thread an equal part of the range.
+	int32 partSize = (count + m_threadCount - 1) / m_threadCount;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = task;
+		m_grainSize = grainSize;
+		for (int32 i = 0; i < m_threadCount; ++i)
+		{
+			m_ranges[i].next = b2Min(i * partSize, count);
+			m_ranges[i].end = b2Min((i + 1) * partSize, count);
+		}
+		m_busyCount = m_threadCount - 1;
+		++m_generation;
+	}
+	m_wakeCondition.notify_all();
+
+	return this;
+}
+
+void b2ThreadPool::Wait(void* job)
+{
+	b2Assert(job == this);
+	B2_NOT_USED(job);
+
+	ExecuteRanges(0);
+
+	// Every worker must leave this job before the next one can be posted.
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_busyCount > 0)
+	{
+		m_doneCondition.wait(lock);
+	}
+	m_task = NULL;
+}
+
+void b2ThreadPool::ExecuteRanges(int32 threadIndex)
+{
+	// Finish our own part first, then steal from the parts of the others.
+	for (int32 i = 0; i < m_threadCount; ++i)
+	{
+		b2WorkRange* range = m_ranges + (threadIndex + i) % m_threadCount;
+		for (;;)
+		{
+			int32 begin = range->next.fetch_add(m_grainSize);
+			if (begin >= range->end)
+			{
+				break;
+			}
+
+			int32 end = b2Min(begin + m_grainSize, range->end);
+			m_task->Execute(begin, end, threadIndex);
+		}
+	}
+}
+
+void b2ThreadPool::WorkerMain(b2ThreadPool* pool, int32 threadIndex)
+{
+	uint32 generation = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(pool->m_mutex);
+			while (pool->m_exit == false && pool->m_generation == generation)
+			{
+				pool->m_wakeCondition.wait(lock);
+			}
+
+			if (pool->m_exit)
+			{
+				return;
+			}
+
+			generation = pool->m_generation;
+		}
+
+		pool->ExecuteRanges(threadIndex);
+
+		std::lock_guard<std::mutex> lock(pool->m_mutex);
+		--pool->m_busyCount;
+		if (pool->m_busyCount == 0)
+		{
+			pool->m_doneCondition.notify_one();
+		}
+	}
+}
+
+b2WorkerThread::b2WorkerThread()
+{
+	m_task = NULL;
+	m_exit = false;
+	m_thread = std::thread(&b2WorkerThread::WorkerMain, this);
+}
+
+b2WorkerThread::~b2WorkerThread()
+{
+	Wait();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_exit = true;
+	}
+	m_wakeCondition.notify_one();
+
+	m_thread.join();
+}
+
+void b2WorkerThread::Submit(b2Task* task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		b2Assert(m_task == NULL);
+		m_task = task;
+	}
+	m_wakeCondition.notify_one();
+}
+
+void b2WorkerThread::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_task != NULL)
+	{
+		m_doneCondition.wait(lock);
+	}
+}
+
+void b2WorkerThread::WorkerMain(b2WorkerThread* worker)
+{
+	for (;;)
+	{
+		b2Task* task;
+		{
+			std::unique_lock<std::mutex> lock(worker->m_mutex);
+			while (worker->m_exit == false && worker->m_task == NULL)
+			{
+				worker->m_wakeCondition.wait(lock);
+			}
+
+			if (worker->m_exit)
+			{
+				return;
+			}
+
+			task = worker->m_task;
+		}
+
+		task->Run();
+
+		// The task stays posted while it runs, so Wait can't return early.
+		std::lock_guard<std::mutex> lock(worker->m_mutex);
+		worker->m_task = NULL;
+		worker->m_doneCondition.notify_all();
+	}
+}
@@ -0,0 +1,131 @@
+/*
+* Copyright (c) 2012 Nusantara Software
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_THREAD_POOL_H
+#define B2_THREAD_POOL_H
+
+#include <Box2D/Common/b2TaskScheduler.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/// A fixed set of worker threads used to run the parallel phases of a time step.
+/// The thread that calls Wait takes part in the work as thread 0. Each thread
+/// starts on its own part of the range and then steals from the other parts.
+class b2ThreadPool : public b2TaskScheduler
+{
+public:
+	/// Construct a pool that runs work on threadCount threads, including the caller.
+	b2ThreadPool(int32 threadCount);
+
+	/// Stop and join all worker threads.
+	~b2ThreadPool();
+
+	/// @see b2TaskScheduler::GetThreadCount
+	int32 GetThreadCount() const;
+
+	/// Get the number of threads the hardware runs concurrently, clamped to
+	/// [1, b2_maxThreads]. This is the default size of the pool of a world.
+	static int32 GetHardwareThreadCount();
+
+	/// @see b2TaskScheduler::Enqueue
+	void* Enqueue(b2ParallelTask* task, int32 count, int32 grainSize);
+
+	/// @see b2TaskScheduler::Wait
+	void Wait(void* job);
+
+private:
+
+	// The part of the range that a thread starts on. Padded so that the
+	// threads don't share cache lines.
+	struct b2WorkRange
+	{
+		std::atomic<int32> next;
+		int32 end;
+		char padding[64 - sizeof(std::atomic<int32>) - sizeof(int32)];
+	};
+
+	static void WorkerMain(b2ThreadPool* pool, int32 threadIndex);
+	void ExecuteRanges(int32 threadIndex);
+
+	std::thread* m_threads;
+	int32 m_threadCount;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCondition;
+	std::condition_variable m_doneCondition;
+
+	b2ParallelTask* m_task;
+	int32 m_grainSize;
+	b2WorkRange m_ranges[b2_maxThreads];
+
+	int32 m_busyCount;
+	uint32 m_generation;
+	bool m_exit;
+};
+
+/// Implement this to run work in the background with b2WorkerThread::Submit.
+class b2Task
+{
+public:
+	virtual ~b2Task() {}
+
+	/// Do the work. This is called on the worker thread.
+	virtual void Run() = 0;
+};
+
+/// A single thread that runs one task at a time in the background.
+class b2WorkerThread
+{
+public:
+	/// Start the thread. It sleeps until a task is submitted.
+	b2WorkerThread();
+
+	/// Wait for the current task and join the thread.
+	~b2WorkerThread();
+
+	/// Run the task on the worker thread and return immediately. The previous
+	/// task must have been waited for.
+	void Submit(b2Task* task);
+
+	/// Block until the submitted task has finished. Returns immediately if
+	/// there is no task.
+	void Wait();
+
+private:
+
+	static void WorkerMain(b2WorkerThread* worker);
+
+	std::thread m_thread;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCondition;
+	std::condition_variable m_doneCondition;
+
+	b2Task* m_task;
+	bool m_exit;
+};
+
+inline int32 b2ThreadPool::GetThreadCount() const
+{
+	return m_threadCount;
+}
+
+#endif
@@ -23,21 +23,26 @@
 float64 b2Timer::s_invFrequency = 0.0f;
 
 #include <windows.h>
+#include <mutex>
 
-b2Timer::b2Timer()
+static void b2InitializeFrequency(float64* invFrequency)
 {
 	LARGE_INTEGER largeInteger;
-
-	if (s_invFrequency == 0.0f)
+	QueryPerformanceFrequency(&largeInteger);
+	*invFrequency = float64(largeInteger.QuadPart);
+	if (*invFrequency > 0.0f)
 	{
-		QueryPerformanceFrequency(&largeInteger);
-		s_invFrequency = float64(largeInteger.QuadPart);
-		if (s_invFrequency > 0.0f)
-		{
-			s_invFrequency = 1000.0f / s_invFrequency;
-		}
+		*invFrequency = 1000.0f / *invFrequency;
 	}
+}
 
+b2Timer::b2Timer()
+{
+	// Timers are created concurrently by worlds on different threads.
+	static std::once_flag s_frequencyFlag;
+	std::call_once(s_frequencyFlag, b2InitializeFrequency, &s_invFrequency);
+
+	LARGE_INTEGER largeInteger;
 	QueryPerformanceCounter(&largeInteger);
 	m_start = float64(largeInteger.QuadPart);
 }
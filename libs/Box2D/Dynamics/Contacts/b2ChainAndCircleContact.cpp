@@ -44,11 +44,11 @@ b2ChainAndCircleContact::b2ChainAndCircleContact(b2Fixture* fixtureA, int32 inde
 	b2Assert(m_fixtureB->GetType() == b2Shape::e_circle);
 }
 
-void b2ChainAndCircleContact::Evaluate(b2Manifold* manifold, const b2Transform& xfA, const b2Transform& xfB)
+void b2ChainAndCircleContact::Evaluate(b2Manifold* manifold, const b2Transform& xfA, const b2Transform& xfB, float32 speculativeDistance)
 {
 	b2ChainShape* chain = (b2ChainShape*)m_fixtureA->GetShape();
 	b2EdgeShape edge;
 	chain->GetChildEdge(&edge, m_indexA);
 	b2CollideEdgeAndCircle(	manifold, &edge, xfA,
-							(b2CircleShape*)m_fixtureB->GetShape(), xfB);
+							(b2CircleShape*)m_fixtureB->GetShape(), xfB, speculativeDistance);
 }
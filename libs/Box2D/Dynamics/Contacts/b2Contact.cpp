@@ -34,6 +34,8 @@
 #include <Box2D/Dynamics/b2Fixture.h>
 #include <Box2D/Dynamics/b2World.h>
 
+#include <mutex>
+
 b2ContactRegister b2Contact::s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
 bool b2Contact::s_initialized = false;
 
@@ -46,6 +48,8 @@ void b2Contact::InitializeRegisters()
 	AddType(b2EdgeAndPolygonContact::Create, b2EdgeAndPolygonContact::Destroy, b2Shape::e_edge, b2Shape::e_polygon);
 	AddType(b2ChainAndCircleContact::Create, b2ChainAndCircleContact::Destroy, b2Shape::e_chain, b2Shape::e_circle);
 	AddType(b2ChainAndPolygonContact::Create, b2ChainAndPolygonContact::Destroy, b2Shape::e_chain, b2Shape::e_polygon);
+
+	s_initialized = true;
 }
 
 void b2Contact::AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* destoryFcn,
@@ -68,11 +72,9 @@ void b2Contact::AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* dest
 
 b2Contact* b2Contact::Create(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB, b2BlockAllocator* allocator)
 {
-	if (s_initialized == false)
-	{
-		InitializeRegisters();
-		s_initialized = true;
-	}
+	// Contacts may be created concurrently by worlds on different threads.
+	static std::once_flag s_registerFlag;
+	std::call_once(s_registerFlag, &b2Contact::InitializeRegisters);
 
 	b2Shape::Type type1 = fixtureA->GetType();
 	b2Shape::Type type2 = fixtureB->GetType();
@@ -133,6 +135,10 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 	m_prev = NULL;
 	m_next = NULL;
 
+	m_islandPrev = NULL;
+	m_islandNext = NULL;
+	m_awakeIndex = -1;
+
 	m_nodeA.contact = NULL;
 	m_nodeA.prev = NULL;
 	m_nodeA.next = NULL;
@@ -153,22 +159,68 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 // Note: do not assume the fixture AABBs are overlapping or are valid.
 void b2Contact::Update(b2ContactListener* listener)
 {
-	b2Manifold oldManifold = m_manifold;
+	// This is used by the time of impact events, which don't use speculative
+	// points.
+	b2Manifold manifold;
+	bool touching = ComputeManifold(&manifold, 0.0f);
+	Update(manifold, touching, listener);
+}
 
-	// Re-enable this contact.
-	m_flags |= e_enabledFlag;
+float32 b2Contact::ComputeSpeculativeDistance(float32 time) const
+{
+	const b2Body* bodyA = m_fixtureA->GetBody();
+	const b2Body* bodyB = m_fixtureB->GetBody();
+
+	// Like b2World::SolveTOI, only bullets and contacts with static or kinematic
+	// bodies are continuous.
+	bool collideA = bodyA->IsBullet() || bodyA->GetType() != b2_dynamicBody;
+	bool collideB = bodyB->IsBullet() || bodyB->GetType() != b2_dynamicBody;
+	if (collideA == false && collideB == false)
+	{
+		return 0.0f;
+	}
+
+	// Bound the relative speed of the shapes by their extent from the centers
+	// of mass.
+	float32 speed = b2Distance(bodyA->GetLinearVelocity(), bodyB->GetLinearVelocity());
+
+	float32 wA = bodyA->GetAngularVelocity();
+	if (wA != 0.0f)
+	{
+		b2AABB aabb;
+		m_fixtureA->GetShape()->ComputeAABB(&aabb, bodyA->GetTransform(), m_indexA);
+		b2Vec2 c = bodyA->GetWorldCenter();
+		b2Vec2 extent = b2Max(b2Abs(aabb.lowerBound - c), b2Abs(aabb.upperBound - c));
+		speed += b2Abs(wA) * extent.Length();
+	}
+
+	float32 wB = bodyB->GetAngularVelocity();
+	if (wB != 0.0f)
+	{
+		b2AABB aabb;
+		m_fixtureB->GetShape()->ComputeAABB(&aabb, bodyB->GetTransform(), m_indexB);
+		b2Vec2 c = bodyB->GetWorldCenter();
+		b2Vec2 extent = b2Max(b2Abs(aabb.lowerBound - c), b2Abs(aabb.upperBound - c));
+		speed += b2Abs(wB) * extent.Length();
+	}
+
+	return time * speed;
+}
+
+bool b2Contact::ComputeManifold(b2Manifold* manifold, float32 speculativeTime)
+{
+	// Start from the old manifold. Fields the collision routines don't
+	// write keep their previous values.
+	*manifold = m_manifold;
 
 	bool touching = false;
-	bool wasTouching = (m_flags & e_touchingFlag) == e_touchingFlag;
 
 	bool sensorA = m_fixtureA->IsSensor();
 	bool sensorB = m_fixtureB->IsSensor();
 	bool sensor = sensorA || sensorB;
 
-	b2Body* bodyA = m_fixtureA->GetBody();
-	b2Body* bodyB = m_fixtureB->GetBody();
-	const b2Transform& xfA = bodyA->GetTransform();
-	const b2Transform& xfB = bodyB->GetTransform();
+	b2Transform xfA = m_fixtureA->GetBody()->GetTransform();
+	b2Transform xfB = m_fixtureB->GetBody()->GetTransform();
 
 	// Is this contact a sensor?
 	if (sensor)
@@ -178,25 +230,48 @@ void b2Contact::Update(b2ContactListener* listener)
 		touching = b2TestOverlap(shapeA, m_indexA, shapeB, m_indexB, xfA, xfB);
 
 		// Sensors don't generate manifolds.
-		m_manifold.pointCount = 0;
+		manifold->pointCount = 0;
 	}
 	else
 	{
-		Evaluate(&m_manifold, xfA, xfB);
-		touching = m_manifold.pointCount > 0;
+		float32 speculativeDistance = 0.0f;
+		if (speculativeTime > 0.0f)
+		{
+			speculativeDistance = ComputeSpeculativeDistance(speculativeTime);
+		}
+
+		Evaluate(manifold, xfA, xfB, speculativeDistance);
+		touching = manifold->pointCount > 0;
+
+		if (touching && speculativeDistance > 0.0f)
+		{
+			// The shapes touch if one of the points is within the slop.
+			b2WorldManifold worldManifold;
+			worldManifold.Initialize(manifold, xfA, m_fixtureA->GetShape()->m_radius, xfB, m_fixtureB->GetShape()->m_radius);
+
+			touching = false;
+			for (int32 i = 0; i < manifold->pointCount; ++i)
+			{
+				if (worldManifold.separations[i] <= b2_linearSlop)
+				{
+					touching = true;
+					break;
+				}
+			}
+		}
 
 		// Match old contact ids to new contact ids and copy the
 		// stored impulses to warm start the solver.
-		for (int32 i = 0; i < m_manifold.pointCount; ++i)
+		for (int32 i = 0; i < manifold->pointCount; ++i)
 		{
-			b2ManifoldPoint* mp2 = m_manifold.points + i;
+			b2ManifoldPoint* mp2 = manifold->points + i;
 			mp2->normalImpulse = 0.0f;
 			mp2->tangentImpulse = 0.0f;
 			b2ContactID id2 = mp2->id;
 
-			for (int32 j = 0; j < oldManifold.pointCount; ++j)
+			for (int32 j = 0; j < m_manifold.pointCount; ++j)
 			{
-				b2ManifoldPoint* mp1 = oldManifold.points + j;
+				const b2ManifoldPoint* mp1 = m_manifold.points + j;
 
 				if (mp1->id.key == id2.key)
 				{
@@ -206,12 +281,42 @@ void b2Contact::Update(b2ContactListener* listener)
 				}
 			}
 		}
+	}
 
-		if (touching != wasTouching)
-		{
-			bodyA->SetAwake(true);
-			bodyB->SetAwake(true);
-		}
+	return touching;
+}
+
+void b2Contact::FlagForFiltering()
+{
+	m_flags |= e_filterFlag;
+
+	// Contacts are filtered by b2ContactManager::Collide, which only visits
+	// awake contacts.
+	m_fixtureA->GetBody()->GetWorld()->m_contactManager.UpdateAwakeSet(this);
+}
+
+void b2Contact::Update(const b2Manifold& manifold, bool touching, b2ContactListener* listener)
+{
+	b2Manifold oldManifold = m_manifold;
+	m_manifold = manifold;
+
+	// Re-enable this contact.
+	m_flags |= e_enabledFlag;
+
+	bool wasTouching = (m_flags & e_touchingFlag) == e_touchingFlag;
+	bool wasSpeculative = (m_flags & e_speculativeFlag) == e_speculativeFlag;
+
+	// Sensors have no manifold points.
+	bool speculative = touching == false && manifold.pointCount > 0;
+
+	bool sensorA = m_fixtureA->IsSensor();
+	bool sensorB = m_fixtureB->IsSensor();
+	bool sensor = sensorA || sensorB;
+
+	if (sensor == false && (touching != wasTouching || speculative != wasSpeculative))
+	{
+		m_fixtureA->GetBody()->SetAwake(true);
+		m_fixtureB->GetBody()->SetAwake(true);
 	}
 
 	if (touching)
@@ -223,6 +328,31 @@ void b2Contact::Update(b2ContactListener* listener)
 		m_flags &= ~e_touchingFlag;
 	}
 
+	if (speculative)
+	{
+		m_flags |= e_speculativeFlag;
+	}
+	else
+	{
+		m_flags &= ~e_speculativeFlag;
+	}
+
+	// Solid touching and speculative contacts connect the islands of their bodies.
+	bool solid = (touching || speculative) && sensor == false;
+	bool linked = (m_flags & e_islandLinkedFlag) == e_islandLinkedFlag;
+	if (linked != solid)
+	{
+		b2World* world = m_fixtureA->GetBody()->GetWorld();
+		if (linked)
+		{
+			world->UnlinkContact(this);
+		}
+		else
+		{
+			world->LinkContact(this);
+		}
+	}
+
 	if (wasTouching == false && touching == true && listener)
 	{
 		listener->BeginContact(this);
@@ -233,7 +363,9 @@ void b2Contact::Update(b2ContactListener* listener)
 		listener->EndContact(this);
 	}
 
-	if (sensor == false && touching && listener)
+	// Speculative contacts are presolved as well, so they can be disabled
+	// before the shapes touch.
+	if (solid && listener)
 	{
 		listener->PreSolve(this, &oldManifold);
 	}
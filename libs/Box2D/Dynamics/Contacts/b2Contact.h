@@ -135,8 +135,9 @@ public:
 	/// Reset the restitution to the default value.
 	void ResetRestitution();
 
-	/// Evaluate this contact with your own manifold and transforms.
-	virtual void Evaluate(b2Manifold* manifold, const b2Transform& xfA, const b2Transform& xfB) = 0;
+	/// Evaluate this contact with your own manifold and transforms. Points that are
+	/// separated by up to speculativeDistance are kept as well.
+	virtual void Evaluate(b2Manifold* manifold, const b2Transform& xfA, const b2Transform& xfB, float32 speculativeDistance) = 0;
 
 protected:
 	friend class b2ContactManager;
@@ -144,6 +145,9 @@ protected:
 	friend class b2ContactSolver;
 	friend class b2Body;
 	friend class b2Fixture;
+	friend class b2PersistentIsland;
+	friend struct b2FindTOIsTask;
+	friend struct b2ContactListOrder;
 
 	// Flags stored in m_flags
 	enum
@@ -164,7 +168,14 @@ protected:
 		e_bulletHitFlag		= 0x0010,
 
 		// This contact has a valid TOI in m_toi
-		e_toiFlag			= 0x0020
+		e_toiFlag			= 0x0020,
+
+		// This contact is in the contact list of a persistent island.
+		e_islandLinkedFlag	= 0x0040,
+
+		// The shapes are not touching, but the manifold has speculative points.
+		// The contact is solved, but it doesn't begin.
+		e_speculativeFlag	= 0x0080
 	};
 
 	/// Flag this contact for filtering. Filtering will occur the next time step.
@@ -183,6 +194,19 @@ protected:
 
 	void Update(b2ContactListener* listener);
 
+	// Compute the manifold and touching state for Update. This doesn't modify
+	// the contact, so different contacts can be computed concurrently. If the
+	// speculative time is positive, the manifold keeps the points that can be
+	// reached within that time, see b2World::SetSpeculativeContacts.
+	bool ComputeManifold(b2Manifold* manifold, float32 speculativeTime);
+
+	// The distance the shapes can close in the given time, or zero if the
+	// contact doesn't need continuous collision.
+	float32 ComputeSpeculativeDistance(float32 time) const;
+
+	// Update the contact with the results of ComputeManifold.
+	void Update(const b2Manifold& manifold, bool touching, b2ContactListener* listener);
+
 	static b2ContactRegister s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
 	static bool s_initialized;
 
@@ -192,6 +216,17 @@ protected:
 	b2Contact* m_prev;
 	b2Contact* m_next;
 
+	// Island list pointers.
+	b2Contact* m_islandPrev;
+	b2Contact* m_islandNext;
+
+	// Index in the awake contact array or -1. See b2ContactManager::UpdateAwakeSet.
+	int32 m_awakeIndex;
+
+	// Taken from a counter when the contact is created. New contacts go to the head
+	// of the world contact list, so the list is in order of decreasing sequence.
+	uint32 m_sequence;
+
 	// Nodes for connecting bodies.
 	b2ContactEdge m_nodeA;
 	b2ContactEdge m_nodeB;
@@ -293,11 +328,6 @@ inline int32 b2Contact::GetChildIndexB() const
 	return m_indexB;
 }
 
-inline void b2Contact::FlagForFiltering()
-{
-	m_flags |= e_filterFlag;
-}
-
 inline void b2Contact::SetFriction(float32 friction)
 {
 	m_friction = friction;
@@ -27,6 +27,8 @@ class b2Contact;
 class b2Body;
 class b2StackAllocator;
 struct b2ContactPositionConstraint;
+struct b2SoftContactConstraint;
+struct b2ContactBatch;
 
 struct b2VelocityConstraintPoint
 {
@@ -37,6 +39,7 @@ struct b2VelocityConstraintPoint
 	float32 normalMass;
 	float32 tangentMass;
 	float32 velocityBias;
+	float32 relativeVelocity;	// the normal velocity at the start of the step, for restitution
 };
 
 struct b2ContactVelocityConstraint
@@ -62,7 +65,12 @@ struct b2ContactSolverDef
 	int32 count;
 	b2Position* positions;
 	b2Velocity* velocities;
+	int32 bodyCount;	// the number of solver slots in positions and velocities
 	b2StackAllocator* allocator;
+
+	// Solve the velocity constraints in batches with vector instructions. This
+	// changes the solver order, so the results differ from the scalar solver.
+	bool simd;
 };
 
 class b2ContactSolver
@@ -74,12 +82,44 @@ public:
 	void InitializeVelocityConstraints();
 
 	void WarmStart();
-	void SolveVelocityConstraints();
+
+	// This returns the largest change of an impulse in this pass.
+	float32 SolveVelocityConstraints();
 	void StoreImpulses();
 
 	bool SolvePositionConstraints();
 	bool SolveTOIPositionConstraints(int32 toiIndexA, int32 toiIndexB);
 
+	// Solve a subset of the constraints. Contacts that share no dynamic body
+	// may be solved concurrently.
+	float32 SolveVelocityConstraints(const int32* indices, int32 count);
+	bool SolvePositionConstraints(const int32* indices, int32 count);
+
+	float32 SolveVelocityConstraint(b2ContactVelocityConstraint* vc);
+
+	// Returns the minimum separation of the contact points.
+	float32 SolvePositionConstraint(b2ContactPositionConstraint* pc);
+
+	// The batched solver, see b2ContactSolverSimd.cpp. WarmStart, SolveVelocityConstraints,
+	// and StoreImpulses use it when the batches are prepared.
+	void PrepareBatches();
+	void WarmStartBatches();
+	float32 SolveBatches();
+	void UnpackBatches();
+
+	// The soft step solver, see b2Island::SolveSoft. InitializeSoftConstraints
+	// records the separations at the start of the step and must follow
+	// InitializeVelocityConstraints. Each substep solves the contacts with a soft
+	// bias towards the separation and then relaxes them without it. Restitution
+	// is applied once after the last substep. It is applied the same way after
+	// the iterations of Solve if there are speculative points, which can't bounce
+	// while they only close their gap.
+	void InitializeSoftConstraints(float32 h);
+	void SolveSoftConstraints(bool useBias);
+	void SolveSoftConstraints(const int32* indices, int32 count, bool useBias);
+	void SolveSoftConstraint(int32 index, bool useBias);
+	void ApplyRestitution();
+
 	b2TimeStep m_step;
 	b2Position* m_positions;
 	b2Velocity* m_velocities;
@@ -88,6 +128,23 @@ public:
 	b2ContactVelocityConstraint* m_velocityConstraints;
 	b2Contact** m_contacts;
 	int m_count;
+	int32 m_bodyCount;
+
+	// Set by InitializeVelocityConstraints if a step with speculative contacts has
+	// a point separated by more than the slop. Such a point may close the gap in
+	// this step, but not more.
+	bool m_speculative;
+
+	bool m_simd;
+	b2ContactBatch* m_batches;
+	int32 m_batchCount;
+	int32* m_batchLanes;	// batch * b2_contactBatchWidth + lane of each constraint
+
+	b2SoftContactConstraint* m_softConstraints;
+	float32 m_inv_h;
+	float32 m_biasRate;
+	float32 m_massScale;
+	float32 m_impulseScale;
 };
 
 #endif
@@ -0,0 +1,83 @@
+/*
+* Copyright (c) 2012 Nusantara Software
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Common/b2Settings.h>
+#include <Box2D/Dynamics/b2TimeStep.h>
+
+#if !defined(B2_NO_SIMD) && !defined(B2_NO_AVX2) && (defined(__x86_64__) || defined(_M_X64))
+
+// Everything below is compiled for AVX2 and only runs when the CPU has it.
+// See b2ContactSolverSimd.cpp. The headers above are included first so that
+// their inline functions are compiled for the default target.
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#include <immintrin.h>
+#include <Box2D/Dynamics/Contacts/b2ContactSolverSimd.h>
+
+// Eight lanes in an AVX register.
+struct b2FloatW8
+{
+	struct Mask
+	{
+		Mask operator&(Mask b) const { Mask r; r.m = _mm256_and_ps(m, b.m); return r; }
+		Mask operator|(Mask b) const { Mask r; r.m = _mm256_or_ps(m, b.m); return r; }
+		__m256 m;
+	};
+	enum { width = 8 };
+
+	static b2FloatW8 Load(const float32* p) { b2FloatW8 r; r.v = _mm256_loadu_ps(p); return r; }
+	void Store(float32* p) const { _mm256_storeu_ps(p, v); }
+	static b2FloatW8 Zero() { b2FloatW8 r; r.v = _mm256_setzero_ps(); return r; }
+	static b2FloatW8 One() { b2FloatW8 r; r.v = _mm256_set1_ps(1.0f); return r; }
+
+	b2FloatW8 operator-() const { b2FloatW8 r; r.v = _mm256_xor_ps(v, _mm256_set1_ps(-0.0f)); return r; }
+	b2FloatW8 operator+(b2FloatW8 b) const { b2FloatW8 r; r.v = _mm256_add_ps(v, b.v); return r; }
+	b2FloatW8 operator-(b2FloatW8 b) const { b2FloatW8 r; r.v = _mm256_sub_ps(v, b.v); return r; }
+	b2FloatW8 operator*(b2FloatW8 b) const { b2FloatW8 r; r.v = _mm256_mul_ps(v, b.v); return r; }
+
+	// These match b2Min and b2Max, including the argument returned for equal values.
+	static b2FloatW8 Min(b2FloatW8 a, b2FloatW8 b) { b2FloatW8 r; r.v = _mm256_min_ps(a.v, b.v); return r; }
+	static b2FloatW8 Max(b2FloatW8 a, b2FloatW8 b) { b2FloatW8 r; r.v = _mm256_max_ps(a.v, b.v); return r; }
+	static Mask GreaterEqual(b2FloatW8 a, b2FloatW8 b) { Mask r; r.m = _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); return r; }
+	static b2FloatW8 Select(Mask m, b2FloatW8 a, b2FloatW8 b) { b2FloatW8 r; r.v = _mm256_blendv_ps(b.v, a.v, m.m); return r; }
+
+	__m256 v;
+};
+
+void b2WarmStartContactBatchesAVX2(b2ContactBatch* batches, int32 count, b2Velocity* velocities)
+{
+	b2WarmStartContactBatches<b2FloatW8>(batches, count, velocities);
+}
+
+float32 b2SolveContactBatchesAVX2(b2ContactBatch* batches, int32 count, b2Velocity* velocities)
+{
+	return b2SolveContactBatches<b2FloatW8>(batches, count, velocities);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,302 @@
+/*
+* Copyright (c) 2012 Nusantara Software
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Dynamics/Contacts/b2ContactSolver.h>
+#include <Box2D/Dynamics/Contacts/b2ContactSolverSimd.h>
+#include <Box2D/Common/b2StackAllocator.h>
+#include <cstring>
+
+#if !defined(B2_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define B2_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(B2_SSE2) && !defined(B2_NO_AVX2) && (defined(__x86_64__) || defined(_M_X64))
+#define B2_AVX2 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// One lane. This is used where no vector instructions are available.
+struct b2FloatW1
+{
+	typedef bool Mask;
+	enum { width = 1 };
+
+	static b2FloatW1 Load(const float32* p) { b2FloatW1 r; r.v = *p; return r; }
+	void Store(float32* p) const { *p = v; }
+	static b2FloatW1 Zero() { b2FloatW1 r; r.v = 0.0f; return r; }
+	static b2FloatW1 One() { b2FloatW1 r; r.v = 1.0f; return r; }
+
+	b2FloatW1 operator-() const { b2FloatW1 r; r.v = -v; return r; }
+	b2FloatW1 operator+(b2FloatW1 b) const { b2FloatW1 r; r.v = v + b.v; return r; }
+	b2FloatW1 operator-(b2FloatW1 b) const { b2FloatW1 r; r.v = v - b.v; return r; }
+	b2FloatW1 operator*(b2FloatW1 b) const { b2FloatW1 r; r.v = v * b.v; return r; }
+
+	static b2FloatW1 Min(b2FloatW1 a, b2FloatW1 b) { return a.v < b.v ? a : b; }
+	static b2FloatW1 Max(b2FloatW1 a, b2FloatW1 b) { return a.v > b.v ? a : b; }
+	static Mask GreaterEqual(b2FloatW1 a, b2FloatW1 b) { return a.v >= b.v; }
+	static b2FloatW1 Select(Mask m, b2FloatW1 a, b2FloatW1 b) { return m ? a : b; }
+
+	float32 v;
+};
+
+#if defined(B2_SSE2)
+
+// Four lanes in an SSE2 register.
+struct b2FloatW4
+{
+	struct Mask
+	{
+		Mask operator&(Mask b) const { Mask r; r.m = _mm_and_ps(m, b.m); return r; }
+		Mask operator|(Mask b) const { Mask r; r.m = _mm_or_ps(m, b.m); return r; }
+		__m128 m;
+	};
+	enum { width = 4 };
+
+	static b2FloatW4 Load(const float32* p) { b2FloatW4 r; r.v = _mm_loadu_ps(p); return r; }
+	void Store(float32* p) const { _mm_storeu_ps(p, v); }
+	static b2FloatW4 Zero() { b2FloatW4 r; r.v = _mm_setzero_ps(); return r; }
+	static b2FloatW4 One() { b2FloatW4 r; r.v = _mm_set1_ps(1.0f); return r; }
+
+	b2FloatW4 operator-() const { b2FloatW4 r; r.v = _mm_xor_ps(v, _mm_set1_ps(-0.0f)); return r; }
+	b2FloatW4 operator+(b2FloatW4 b) const { b2FloatW4 r; r.v = _mm_add_ps(v, b.v); return r; }
+	b2FloatW4 operator-(b2FloatW4 b) const { b2FloatW4 r; r.v = _mm_sub_ps(v, b.v); return r; }
+	b2FloatW4 operator*(b2FloatW4 b) const { b2FloatW4 r; r.v = _mm_mul_ps(v, b.v); return r; }
+
+	// These match b2Min and b2Max, including the argument returned for equal values.
+	static b2FloatW4 Min(b2FloatW4 a, b2FloatW4 b) { b2FloatW4 r; r.v = _mm_min_ps(a.v, b.v); return r; }
+	static b2FloatW4 Max(b2FloatW4 a, b2FloatW4 b) { b2FloatW4 r; r.v = _mm_max_ps(a.v, b.v); return r; }
+	static Mask GreaterEqual(b2FloatW4 a, b2FloatW4 b) { Mask r; r.m = _mm_cmpge_ps(a.v, b.v); return r; }
+	static b2FloatW4 Select(Mask m, b2FloatW4 a, b2FloatW4 b)
+	{
+		b2FloatW4 r;
+		r.v = _mm_or_ps(_mm_and_ps(m.m, a.v), _mm_andnot_ps(m.m, b.v));
+		return r;
+	}
+
+	__m128 v;
+};
+
+#endif
+
+#if defined(B2_AVX2)
+
+static bool b2HasAVX2()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+
+	// The OS must save the YMM registers.
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (osxsave == false || avx == false || (_xgetbv(0) & 6) != 6)
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif
+
+struct b2ContactBatchFunctions
+{
+	b2WarmStartContactBatchesFcn* warmStart;
+	b2SolveContactBatchesFcn* solve;
+};
+
+static b2ContactBatchFunctions b2SelectContactBatchFunctions()
+{
+	b2ContactBatchFunctions functions;
+#if defined(B2_AVX2)
+	if (b2HasAVX2())
+	{
+		functions.warmStart = b2WarmStartContactBatchesAVX2;
+		functions.solve = b2SolveContactBatchesAVX2;
+		return functions;
+	}
+#endif
+
+#if defined(B2_SSE2)
+	functions.warmStart = b2WarmStartContactBatches<b2FloatW4>;
+	functions.solve = b2SolveContactBatches<b2FloatW4>;
+#else
+	functions.warmStart = b2WarmStartContactBatches<b2FloatW1>;
+	functions.solve = b2SolveContactBatches<b2FloatW1>;
+#endif
+	return functions;
+}
+
+// The instruction set is detected once.
+static const b2ContactBatchFunctions& b2GetContactBatchFunctions()
+{
+	static b2ContactBatchFunctions s_functions = b2SelectContactBatchFunctions();
+	return s_functions;
+}
+
+// Group the velocity constraints into batches of contacts that share no body
+// with mass. A contact goes into the first open batch after every batch that
+// holds one of its bodies, so each body still sees its contacts in order.
+void b2ContactSolver::PrepareBatches()
+{
+	m_batchLanes = (int32*)m_allocator->Allocate(m_count * sizeof(int32));
+	int32* lastBatch = (int32*)m_allocator->Allocate(m_bodyCount * sizeof(int32));
+	int32* batchCounts = (int32*)m_allocator->Allocate(m_count * sizeof(int32));
+
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		lastBatch[i] = -1;
+	}
+
+	int32 batchCount = 0;
+	int32 firstOpen = 0;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+
+		int32 batch = firstOpen;
+		if (vc->invMassA > 0.0f)
+		{
+			batch = b2Max(batch, lastBatch[vc->indexA] + 1);
+		}
+		if (vc->invMassB > 0.0f)
+		{
+			batch = b2Max(batch, lastBatch[vc->indexB] + 1);
+		}
+
+		while (batch < batchCount && batchCounts[batch] == b2_contactBatchWidth)
+		{
+			++batch;
+		}
+
+		if (batch == batchCount)
+		{
+			batchCounts[batchCount++] = 0;
+		}
+
+		m_batchLanes[i] = batch * b2_contactBatchWidth + batchCounts[batch];
+		++batchCounts[batch];
+
+		if (vc->invMassA > 0.0f)
+		{
+			lastBatch[vc->indexA] = batch;
+		}
+		if (vc->invMassB > 0.0f)
+		{
+			lastBatch[vc->indexB] = batch;
+		}
+
+		while (firstOpen < batchCount && batchCounts[firstOpen] == b2_contactBatchWidth)
+		{
+			++firstOpen;
+		}
+	}
+
+	m_allocator->Free(batchCounts);
+	m_allocator->Free(lastBatch);
+
+	m_batchCount = batchCount;
+	m_batches = (b2ContactBatch*)m_allocator->Allocate(m_batchCount * sizeof(b2ContactBatch));
+	memset(m_batches, 0, m_batchCount * sizeof(b2ContactBatch));
+
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		b2ContactBatch* batch = m_batches + m_batchLanes[i] / b2_contactBatchWidth;
+		int32 lane = m_batchLanes[i] % b2_contactBatchWidth;
+
+		batch->normalX[lane] = vc->normal.x;
+		batch->normalY[lane] = vc->normal.y;
+		batch->friction[lane] = vc->friction;
+		batch->invMassA[lane] = vc->invMassA;
+		batch->invIA[lane] = vc->invIA;
+		batch->invMassB[lane] = vc->invMassB;
+		batch->invIB[lane] = vc->invIB;
+		batch->indexA[lane] = vc->indexA;
+		batch->indexB[lane] = vc->indexB;
+		batch->count = b2Max(batch->count, lane + 1);
+
+		for (int32 j = 0; j < vc->pointCount; ++j)
+		{
+			b2VelocityConstraintPoint* vcp = vc->points + j;
+			b2ContactBatchPoint* cp = batch->points + j;
+			cp->rAx[lane] = vcp->rA.x;
+			cp->rAy[lane] = vcp->rA.y;
+			cp->rBx[lane] = vcp->rB.x;
+			cp->rBy[lane] = vcp->rB.y;
+			cp->normalImpulse[lane] = vcp->normalImpulse;
+			cp->tangentImpulse[lane] = vcp->tangentImpulse;
+			cp->normalMass[lane] = vcp->normalMass;
+			cp->tangentMass[lane] = vcp->tangentMass;
+			cp->velocityBias[lane] = vcp->velocityBias;
+		}
+
+		if (vc->pointCount == 2)
+		{
+			batch->blockSolve[lane] = 1.0f;
+			batch->k11[lane] = vc->K.ex.x;
+			batch->k12[lane] = vc->K.ex.y;
+			batch->k22[lane] = vc->K.ey.y;
+			batch->normalMass11[lane] = vc->normalMass.ex.x;
+			batch->normalMass21[lane] = vc->normalMass.ex.y;
+			batch->normalMass12[lane] = vc->normalMass.ey.x;
+			batch->normalMass22[lane] = vc->normalMass.ey.y;
+		}
+	}
+}
+
+void b2ContactSolver::WarmStartBatches()
+{
+	b2GetContactBatchFunctions().warmStart(m_batches, m_batchCount, m_velocities);
+}
+
+float32 b2ContactSolver::SolveBatches()
+{
+	return b2GetContactBatchFunctions().solve(m_batches, m_batchCount, m_velocities);
+}
+
+// Copy the accumulated impulses back to the velocity constraints, so they are
+// stored and reported as usual.
+void b2ContactSolver::UnpackBatches()
+{
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		const b2ContactBatch* batch = m_batches + m_batchLanes[i] / b2_contactBatchWidth;
+		int32 lane = m_batchLanes[i] % b2_contactBatchWidth;
+
+		for (int32 j = 0; j < vc->pointCount; ++j)
+		{
+			vc->points[j].normalImpulse = batch->points[j].normalImpulse[lane];
+			vc->points[j].tangentImpulse = batch->points[j].tangentImpulse[lane];
+		}
+	}
+}
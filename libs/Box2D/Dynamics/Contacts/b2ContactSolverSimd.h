@@ -0,0 +1,343 @@
+/*
+* Copyright (c) 2012 Nusantara Software
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_CONTACT_SOLVER_SIMD_H
+#define B2_CONTACT_SOLVER_SIMD_H
+
+#include <Box2D/Common/b2Settings.h>
+#include <Box2D/Dynamics/b2TimeStep.h>
+
+// This is an internal header of the batched contact solver. The kernels are
+// templates over a vector type V that holds V::width lanes of floats, so the
+// same code is compiled for scalar, SSE2, and AVX2 registers. Every lane uses
+// the same operations in the same order, so the results don't depend on the
+// vector width.
+
+/// The number of contacts in a batch.
+#define b2_contactBatchWidth	8
+
+struct b2ContactBatchPoint
+{
+	float32 rAx[b2_contactBatchWidth], rAy[b2_contactBatchWidth];
+	float32 rBx[b2_contactBatchWidth], rBy[b2_contactBatchWidth];
+	float32 normalImpulse[b2_contactBatchWidth];
+	float32 tangentImpulse[b2_contactBatchWidth];
+	float32 normalMass[b2_contactBatchWidth];
+	float32 tangentMass[b2_contactBatchWidth];
+	float32 velocityBias[b2_contactBatchWidth];
+};
+
+// Up to b2_contactBatchWidth contact velocity constraints in structure of
+// arrays form. The contacts of a batch share no body with mass, so they can be
+// solved at the same time. Unused lanes are zero: they have no mass, read the
+// velocity in slot 0, and are never written back.
+struct b2ContactBatch
+{
+	b2ContactBatchPoint points[2];
+	float32 normalX[b2_contactBatchWidth], normalY[b2_contactBatchWidth];
+	float32 friction[b2_contactBatchWidth];
+	float32 invMassA[b2_contactBatchWidth], invIA[b2_contactBatchWidth];
+	float32 invMassB[b2_contactBatchWidth], invIB[b2_contactBatchWidth];
+
+	// The block solver of two point manifolds. blockSolve is 1 for these and
+	// 0 for one point manifolds, whose second point is zero.
+	float32 blockSolve[b2_contactBatchWidth];
+	float32 k11[b2_contactBatchWidth], k12[b2_contactBatchWidth], k22[b2_contactBatchWidth];
+	float32 normalMass11[b2_contactBatchWidth], normalMass12[b2_contactBatchWidth];
+	float32 normalMass21[b2_contactBatchWidth], normalMass22[b2_contactBatchWidth];
+
+	int32 indexA[b2_contactBatchWidth];
+	int32 indexB[b2_contactBatchWidth];
+	int32 count;
+};
+
+// The velocities of the bodies of a batch, gathered from the solver slots.
+struct b2ContactBatchVelocities
+{
+	float32 vAx[b2_contactBatchWidth], vAy[b2_contactBatchWidth], wA[b2_contactBatchWidth];
+	float32 vBx[b2_contactBatchWidth], vBy[b2_contactBatchWidth], wB[b2_contactBatchWidth];
+};
+
+typedef void b2WarmStartContactBatchesFcn(b2ContactBatch* batches, int32 count, b2Velocity* velocities);
+typedef float32 b2SolveContactBatchesFcn(b2ContactBatch* batches, int32 count, b2Velocity* velocities);
+
+void b2WarmStartContactBatchesAVX2(b2ContactBatch* batches, int32 count, b2Velocity* velocities);
+float32 b2SolveContactBatchesAVX2(b2ContactBatch* batches, int32 count, b2Velocity* velocities);
+
+template <typename V>
+inline void b2GatherBatchVelocities(const b2ContactBatch* batch, const b2Velocity* velocities, b2ContactBatchVelocities* s)
+{
+	for (int32 i = 0; i < b2_contactBatchWidth; ++i)
+	{
+		const b2Velocity& velocityA = velocities[batch->indexA[i]];
+		const b2Velocity& velocityB = velocities[batch->indexB[i]];
+		s->vAx[i] = velocityA.v.x;
+		s->vAy[i] = velocityA.v.y;
+		s->wA[i] = velocityA.w;
+		s->vBx[i] = velocityB.v.x;
+		s->vBy[i] = velocityB.v.y;
+		s->wB[i] = velocityB.w;
+	}
+}
+
+template <typename V>
+inline void b2ScatterBatchVelocities(const b2ContactBatch* batch, const b2ContactBatchVelocities* s, b2Velocity* velocities)
+{
+	// Static and kinematic bodies are not changed by the solver.
+	for (int32 i = 0; i < batch->count; ++i)
+	{
+		if (batch->invMassA[i] > 0.0f)
+		{
+			b2Velocity& velocityA = velocities[batch->indexA[i]];
+			velocityA.v.x = s->vAx[i];
+			velocityA.v.y = s->vAy[i];
+			velocityA.w = s->wA[i];
+		}
+
+		if (batch->invMassB[i] > 0.0f)
+		{
+			b2Velocity& velocityB = velocities[batch->indexB[i]];
+			velocityB.v.x = s->vBx[i];
+			velocityB.v.y = s->vBy[i];
+			velocityB.w = s->wB[i];
+		}
+	}
+}
+
+// Mirrors b2ContactSolver::WarmStart.
+template <typename V>
+inline void b2WarmStartContactLanes(const b2ContactBatch* c, int32 lane, b2ContactBatchVelocities* s)
+{
+	V mA = V::Load(c->invMassA + lane), iA = V::Load(c->invIA + lane);
+	V mB = V::Load(c->invMassB + lane), iB = V::Load(c->invIB + lane);
+
+	V vAx = V::Load(s->vAx + lane), vAy = V::Load(s->vAy + lane), wA = V::Load(s->wA + lane);
+	V vBx = V::Load(s->vBx + lane), vBy = V::Load(s->vBy + lane), wB = V::Load(s->wB + lane);
+
+	V nx = V::Load(c->normalX + lane), ny = V::Load(c->normalY + lane);
+	V tx = ny, ty = -nx;
+
+	for (int32 j = 0; j < 2; ++j)
+	{
+		const b2ContactBatchPoint* cp = c->points + j;
+		V rAx = V::Load(cp->rAx + lane), rAy = V::Load(cp->rAy + lane);
+		V rBx = V::Load(cp->rBx + lane), rBy = V::Load(cp->rBy + lane);
+		V normalImpulse = V::Load(cp->normalImpulse + lane);
+		V tangentImpulse = V::Load(cp->tangentImpulse + lane);
+
+		V Px = normalImpulse * nx + tangentImpulse * tx;
+		V Py = normalImpulse * ny + tangentImpulse * ty;
+		wA = wA - iA * (rAx * Py - rAy * Px);
+		vAx = vAx - mA * Px;
+		vAy = vAy - mA * Py;
+		wB = wB + iB * (rBx * Py - rBy * Px);
+		vBx = vBx + mB * Px;
+		vBy = vBy + mB * Py;
+	}
+
+	vAx.Store(s->vAx + lane); vAy.Store(s->vAy + lane); wA.Store(s->wA + lane);
+	vBx.Store(s->vBx + lane); vBy.Store(s->vBy + lane); wB.Store(s->wB + lane);
+}
+
+// Mirrors b2ContactSolver::SolveVelocityConstraint. The cases of the block
+// solver are evaluated for every lane and the first valid one is selected.
+// This returns the largest change of an impulse in each lane.
+template <typename V>
+inline V b2SolveContactLanes(b2ContactBatch* c, int32 lane, b2ContactBatchVelocities* s)
+{
+	typedef typename V::Mask M;
+
+	V zero = V::Zero();
+
+	V mA = V::Load(c->invMassA + lane), iA = V::Load(c->invIA + lane);
+	V mB = V::Load(c->invMassB + lane), iB = V::Load(c->invIB + lane);
+
+	V vAx = V::Load(s->vAx + lane), vAy = V::Load(s->vAy + lane), wA = V::Load(s->wA + lane);
+	V vBx = V::Load(s->vBx + lane), vBy = V::Load(s->vBy + lane), wB = V::Load(s->wB + lane);
+
+	V nx = V::Load(c->normalX + lane), ny = V::Load(c->normalY + lane);
+	V tx = ny, ty = -nx;
+	V friction = V::Load(c->friction + lane);
+	V maxDelta = zero;
+
+	// Solve tangent constraints first because non-penetration is more important
+	// than friction.
+	for (int32 j = 0; j < 2; ++j)
+	{
+		b2ContactBatchPoint* cp = c->points + j;
+		V rAx = V::Load(cp->rAx + lane), rAy = V::Load(cp->rAy + lane);
+		V rBx = V::Load(cp->rBx + lane), rBy = V::Load(cp->rBy + lane);
+
+		// Relative velocity at contact
+		V dvx = vBx + (-wB) * rBy - vAx - (-wA) * rAy;
+		V dvy = vBy + wB * rBx - vAy - wA * rAx;
+
+		// Compute tangent force
+		V vt = dvx * tx + dvy * ty;
+		V lambda = V::Load(cp->tangentMass + lane) * (-vt);
+
+		// Clamp the accumulated force
+		V tangentImpulse = V::Load(cp->tangentImpulse + lane);
+		V maxFriction = friction * V::Load(cp->normalImpulse + lane);
+		V newImpulse = V::Max(-maxFriction, V::Min(tangentImpulse + lambda, maxFriction));
+		lambda = newImpulse - tangentImpulse;
+		newImpulse.Store(cp->tangentImpulse + lane);
+		maxDelta = V::Max(maxDelta, V::Max(lambda, -lambda));
+
+		// Apply contact impulse
+		V Px = lambda * tx;
+		V Py = lambda * ty;
+
+		vAx = vAx - mA * Px;
+		vAy = vAy - mA * Py;
+		wA = wA - iA * (rAx * Py - rAy * Px);
+
+		vBx = vBx + mB * Px;
+		vBy = vBy + mB * Py;
+		wB = wB + iB * (rBx * Py - rBy * Px);
+	}
+
+	// Solve normal constraints
+	b2ContactBatchPoint* cp1 = c->points + 0;
+	b2ContactBatchPoint* cp2 = c->points + 1;
+
+	V r1Ax = V::Load(cp1->rAx + lane), r1Ay = V::Load(cp1->rAy + lane);
+	V r1Bx = V::Load(cp1->rBx + lane), r1By = V::Load(cp1->rBy + lane);
+	V r2Ax = V::Load(cp2->rAx + lane), r2Ay = V::Load(cp2->rAy + lane);
+	V r2Bx = V::Load(cp2->rBx + lane), r2By = V::Load(cp2->rBy + lane);
+
+	V a1 = V::Load(cp1->normalImpulse + lane);
+	V a2 = V::Load(cp2->normalImpulse + lane);
+	V normalMass1 = V::Load(cp1->normalMass + lane);
+	V normalMass2 = V::Load(cp2->normalMass + lane);
+
+	// Relative velocity at contact
+	V dv1x = vBx + (-wB) * r1By - vAx - (-wA) * r1Ay;
+	V dv1y = vBy + wB * r1Bx - vAy - wA * r1Ax;
+	V dv2x = vBx + (-wB) * r2By - vAx - (-wA) * r2Ay;
+	V dv2y = vBy + wB * r2Bx - vAy - wA * r2Ax;
+
+	// Compute normal velocity
+	V vn1 = dv1x * nx + dv1y * ny;
+	V vn2 = dv2x * nx + dv2y * ny;
+
+	// One point: clamp the accumulated impulse.
+	V lambda = (-normalMass1) * (vn1 - V::Load(cp1->velocityBias + lane));
+	V single = V::Max(a1 + lambda, zero);
+
+	// Two points: compute b' = b - K * a.
+	V k11 = V::Load(c->k11 + lane), k12 = V::Load(c->k12 + lane), k22 = V::Load(c->k22 + lane);
+	V bx = vn1 - V::Load(cp1->velocityBias + lane);
+	V by = vn2 - V::Load(cp2->velocityBias + lane);
+	bx = bx - (k11 * a1 + k12 * a2);
+	by = by - (k12 * a1 + k22 * a2);
+
+	// Case 1: vn = 0
+	V x1Case1 = -(V::Load(c->normalMass11 + lane) * bx + V::Load(c->normalMass12 + lane) * by);
+	V x2Case1 = -(V::Load(c->normalMass21 + lane) * bx + V::Load(c->normalMass22 + lane) * by);
+	M case1 = V::GreaterEqual(x1Case1, zero) & V::GreaterEqual(x2Case1, zero);
+
+	// Case 2: vn1 = 0 and x2 = 0
+	V x1Case2 = (-normalMass1) * bx;
+	M case2 = V::GreaterEqual(x1Case2, zero) & V::GreaterEqual(k12 * x1Case2 + by, zero);
+
+	// Case 3: vn2 = 0 and x1 = 0
+	V x2Case3 = (-normalMass2) * by;
+	M case3 = V::GreaterEqual(x2Case3, zero) & V::GreaterEqual(k12 * x2Case3 + bx, zero);
+
+	// Case 4: x1 = 0 and x2 = 0
+	M case4 = V::GreaterEqual(bx, zero) & V::GreaterEqual(by, zero);
+
+	// With no solution the impulse stays the same.
+	V x1 = V::Select(case1, x1Case1, V::Select(case2, x1Case2, V::Select(case3 | case4, zero, a1)));
+	V x2 = V::Select(case1, x2Case1, V::Select(case2 | case3, V::Select(case2, zero, x2Case3), V::Select(case4, zero, a2)));
+
+	M block = V::GreaterEqual(V::Load(c->blockSolve + lane), V::One());
+	x1 = V::Select(block, x1, single);
+	x2 = V::Select(block, x2, a2);
+
+	// Apply incremental impulse
+	V d1 = x1 - a1;
+	V d2 = x2 - a2;
+	maxDelta = V::Max(maxDelta, V::Max(V::Max(d1, -d1), V::Max(d2, -d2)));
+	V P1x = d1 * nx, P1y = d1 * ny;
+	V P2x = d2 * nx, P2y = d2 * ny;
+
+	vAx = vAx - mA * (P1x + P2x);
+	vAy = vAy - mA * (P1y + P2y);
+	wA = wA - iA * ((r1Ax * P1y - r1Ay * P1x) + (r2Ax * P2y - r2Ay * P2x));
+
+	vBx = vBx + mB * (P1x + P2x);
+	vBy = vBy + mB * (P1y + P2y);
+	wB = wB + iB * ((r1Bx * P1y - r1By * P1x) + (r2Bx * P2y - r2By * P2x));
+
+	// Accumulate
+	x1.Store(cp1->normalImpulse + lane);
+	x2.Store(cp2->normalImpulse + lane);
+
+	vAx.Store(s->vAx + lane); vAy.Store(s->vAy + lane); wA.Store(s->wA + lane);
+	vBx.Store(s->vBx + lane); vBy.Store(s->vBy + lane); wB.Store(s->wB + lane);
+
+	return maxDelta;
+}
+
+template <typename V>
+inline void b2WarmStartContactBatches(b2ContactBatch* batches, int32 count, b2Velocity* velocities)
+{
+	b2ContactBatchVelocities s;
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2ContactBatch* batch = batches + i;
+		b2GatherBatchVelocities<V>(batch, velocities, &s);
+		for (int32 lane = 0; lane < batch->count; lane += V::width)
+		{
+			b2WarmStartContactLanes<V>(batch, lane, &s);
+		}
+		b2ScatterBatchVelocities<V>(batch, &s, velocities);
+	}
+}
+
+// The maximum over the lanes is exact, so it doesn't depend on the vector width
+// either. Unused lanes have no mass and don't change.
+template <typename V>
+inline float32 b2SolveContactBatches(b2ContactBatch* batches, int32 count, b2Velocity* velocities)
+{
+	V maxDelta = V::Zero();
+	b2ContactBatchVelocities s;
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2ContactBatch* batch = batches + i;
+		b2GatherBatchVelocities<V>(batch, velocities, &s);
+		for (int32 lane = 0; lane < batch->count; lane += V::width)
+		{
+			maxDelta = V::Max(maxDelta, b2SolveContactLanes<V>(batch, lane, &s));
+		}
+		b2ScatterBatchVelocities<V>(batch, &s, velocities);
+	}
+
+	float32 lanes[V::width];
+	maxDelta.Store(lanes);
+	float32 result = 0.0f;
+	for (int32 i = 0; i < V::width; ++i)
+	{
+		result = b2Max(result, lanes[i]);
+	}
+	return result;
+}
+
+#endif
@@ -104,10 +104,11 @@ public:
 protected:
 
 	friend class b2Joint;
+	friend class b2TreeJointSolver;
 	b2DistanceJoint(const b2DistanceJointDef* data);
 
 	void InitVelocityConstraints(const b2SolverData& data);
-	void SolveVelocityConstraints(const b2SolverData& data);
+	float32 SolveVelocityConstraints(const b2SolverData& data);
 	bool SolvePositionConstraints(const b2SolverData& data);
 
 	float32 m_frequencyHz;
@@ -57,12 +57,12 @@ void b2FrictionJoint::InitVelocityConstraints(const b2SolverData& data)
 {
 	m_indexA = m_bodyA->m_islandIndex;
 	m_indexB = m_bodyB->m_islandIndex;
-	m_localCenterA = m_bodyA->m_sweep.localCenter;
-	m_localCenterB = m_bodyB->m_sweep.localCenter;
-	m_invMassA = m_bodyA->m_invMass;
-	m_invMassB = m_bodyB->m_invMass;
-	m_invIA = m_bodyA->m_invI;
-	m_invIB = m_bodyB->m_invI;
+	m_localCenterA = m_bodyA->Sweep().localCenter;
+	m_localCenterB = m_bodyB->Sweep().localCenter;
+	m_invMassA = m_bodyA->InvMass();
+	m_invMassB = m_bodyB->InvMass();
+	m_invIA = m_bodyA->InvI();
+	m_invIB = m_bodyB->InvI();
 
 	float32 aA = data.positions[m_indexA].a;
 	b2Vec2 vA = data.velocities[m_indexA].v;
@@ -128,8 +128,10 @@ void b2FrictionJoint::InitVelocityConstraints(const b2SolverData& data)
 	data.velocities[m_indexB].w = wB;
 }
 
-void b2FrictionJoint::SolveVelocityConstraints(const b2SolverData& data)
+float32 b2FrictionJoint::SolveVelocityConstraints(const b2SolverData& data)
 {
+	float32 maxDelta = 0.0f;
+
 	b2Vec2 vA = data.velocities[m_indexA].v;
 	float32 wA = data.velocities[m_indexA].w;
 	b2Vec2 vB = data.velocities[m_indexB].v;
@@ -149,6 +151,7 @@ void b2FrictionJoint::SolveVelocityConstraints(const b2SolverData& data)
 		float32 maxImpulse = h * m_maxTorque;
 		m_angularImpulse = b2Clamp(m_angularImpulse + impulse, -maxImpulse, maxImpulse);
 		impulse = m_angularImpulse - oldImpulse;
+		maxDelta = b2Max(maxDelta, b2Abs(impulse));
 
 		wA -= iA * impulse;
 		wB += iB * impulse;
@@ -171,6 +174,7 @@ void b2FrictionJoint::SolveVelocityConstraints(const b2SolverData& data)
 		}
 
 		impulse = m_linearImpulse - oldImpulse;
+		maxDelta = b2Max(maxDelta, b2Max(b2Abs(impulse.x), b2Abs(impulse.y)));
 
 		vA -= mA * impulse;
 		wA -= iA * b2Cross(m_rA, impulse);
@@ -183,6 +187,8 @@ void b2FrictionJoint::SolveVelocityConstraints(const b2SolverData& data)
 	data.velocities[m_indexA].w = wA;
 	data.velocities[m_indexB].v = vB;
 	data.velocities[m_indexB].w = wB;
+
+	return maxDelta;
 }
 
 bool b2FrictionJoint::SolvePositionConstraints(const b2SolverData& data)
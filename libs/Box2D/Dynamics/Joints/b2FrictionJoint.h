@@ -89,7 +89,7 @@ protected:
 	b2FrictionJoint(const b2FrictionJointDef* def);
 
 	void InitVelocityConstraints(const b2SolverData& data);
-	void SolveVelocityConstraints(const b2SolverData& data);
+	float32 SolveVelocityConstraints(const b2SolverData& data);
 	bool SolvePositionConstraints(const b2SolverData& data);
 
 	b2Vec2 m_localAnchorA;
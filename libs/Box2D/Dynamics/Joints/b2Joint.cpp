@@ -168,6 +168,236 @@ void b2Joint::Destroy(b2Joint* joint, b2BlockAllocator* allocator)
 	}
 }
 
+// The number of joints at the start of the array that have the type of the first.
+static int32 b2GetRunCount(b2Joint** joints, int32 count)
+{
+	b2JointType type = joints[0]->GetType();
+	int32 runCount = 1;
+	while (runCount < count && joints[runCount]->GetType() == type)
+	{
+		++runCount;
+	}
+	return runCount;
+}
+
+template <typename T>
+void b2Joint::InitVelocityRun(b2Joint** joints, int32 count, const b2SolverData& data)
+{
+	for (int32 i = 0; i < count; ++i)
+	{
+		T* joint = (T*)joints[i];
+		joint->T::InitVelocityConstraints(data);
+	}
+}
+
+template <typename T>
+float32 b2Joint::SolveVelocityRun(b2Joint** joints, int32 count, const b2SolverData& data)
+{
+	float32 maxDelta = 0.0f;
+	for (int32 i = 0; i < count; ++i)
+	{
+		T* joint = (T*)joints[i];
+		float32 delta = joint->T::SolveVelocityConstraints(data);
+		maxDelta = b2Max(maxDelta, delta);
+	}
+	return maxDelta;
+}
+
+template <typename T>
+bool b2Joint::SolvePositionRun(b2Joint** joints, int32 count, const b2SolverData& data)
+{
+	bool solved = true;
+	for (int32 i = 0; i < count; ++i)
+	{
+		T* joint = (T*)joints[i];
+		bool jointOkay = joint->T::SolvePositionConstraints(data);
+		solved = solved && jointOkay;
+	}
+	return solved;
+}
+
+void b2Joint::InitVelocityConstraints(b2Joint** joints, int32 count, const b2SolverData& data)
+{
+	for (int32 i = 0; i < count;)
+	{
+		b2JointType type = joints[i]->m_type;
+		int32 runCount = b2GetRunCount(joints + i, count - i);
+
+		switch (type)
+		{
+		case e_distanceJoint:
+			InitVelocityRun<b2DistanceJoint>(joints + i, runCount, data);
+			break;
+
+		case e_mouseJoint:
+			InitVelocityRun<b2MouseJoint>(joints + i, runCount, data);
+			break;
+
+		case e_prismaticJoint:
+			InitVelocityRun<b2PrismaticJoint>(joints + i, runCount, data);
+			break;
+
+		case e_revoluteJoint:
+			InitVelocityRun<b2RevoluteJoint>(joints + i, runCount, data);
+			break;
+
+		case e_pulleyJoint:
+			InitVelocityRun<b2PulleyJoint>(joints + i, runCount, data);
+			break;
+
+		case e_gearJoint:
+			InitVelocityRun<b2GearJoint>(joints + i, runCount, data);
+			break;
+
+		case e_wheelJoint:
+			InitVelocityRun<b2WheelJoint>(joints + i, runCount, data);
+			break;
+
+		case e_weldJoint:
+			InitVelocityRun<b2WeldJoint>(joints + i, runCount, data);
+			break;
+
+		case e_frictionJoint:
+			InitVelocityRun<b2FrictionJoint>(joints + i, runCount, data);
+			break;
+
+		case e_ropeJoint:
+			InitVelocityRun<b2RopeJoint>(joints + i, runCount, data);
+			break;
+
+		default:
+			b2Assert(false);
+			break;
+		}
+
+		i += runCount;
+	}
+}
+
+float32 b2Joint::SolveVelocityConstraints(b2Joint** joints, int32 count, const b2SolverData& data)
+{
+	float32 maxDelta = 0.0f;
+	for (int32 i = 0; i < count;)
+	{
+		b2JointType type = joints[i]->m_type;
+		int32 runCount = b2GetRunCount(joints + i, count - i);
+		float32 delta = 0.0f;
+
+		switch (type)
+		{
+		case e_distanceJoint:
+			delta = SolveVelocityRun<b2DistanceJoint>(joints + i, runCount, data);
+			break;
+
+		case e_mouseJoint:
+			delta = SolveVelocityRun<b2MouseJoint>(joints + i, runCount, data);
+			break;
+
+		case e_prismaticJoint:
+			delta = SolveVelocityRun<b2PrismaticJoint>(joints + i, runCount, data);
+			break;
+
+		case e_revoluteJoint:
+			delta = SolveVelocityRun<b2RevoluteJoint>(joints + i, runCount, data);
+			break;
+
+		case e_pulleyJoint:
+			delta = SolveVelocityRun<b2PulleyJoint>(joints + i, runCount, data);
+			break;
+
+		case e_gearJoint:
+			delta = SolveVelocityRun<b2GearJoint>(joints + i, runCount, data);
+			break;
+
+		case e_wheelJoint:
+			delta = SolveVelocityRun<b2WheelJoint>(joints + i, runCount, data);
+			break;
+
+		case e_weldJoint:
+			delta = SolveVelocityRun<b2WeldJoint>(joints + i, runCount, data);
+			break;
+
+		case e_frictionJoint:
+			delta = SolveVelocityRun<b2FrictionJoint>(joints + i, runCount, data);
+			break;
+
+		case e_ropeJoint:
+			delta = SolveVelocityRun<b2RopeJoint>(joints + i, runCount, data);
+			break;
+
+		default:
+			b2Assert(false);
+			break;
+		}
+
+		maxDelta = b2Max(maxDelta, delta);
+		i += runCount;
+	}
+	return maxDelta;
+}
+
+bool b2Joint::SolvePositionConstraints(b2Joint** joints, int32 count, const b2SolverData& data)
+{
+	bool solved = true;
+	for (int32 i = 0; i < count;)
+	{
+		b2JointType type = joints[i]->m_type;
+		int32 runCount = b2GetRunCount(joints + i, count - i);
+		bool runOkay = true;
+
+		switch (type)
+		{
+		case e_distanceJoint:
+			runOkay = SolvePositionRun<b2DistanceJoint>(joints + i, runCount, data);
+			break;
+
+		case e_mouseJoint:
+			runOkay = SolvePositionRun<b2MouseJoint>(joints + i, runCount, data);
+			break;
+
+		case e_prismaticJoint:
+			runOkay = SolvePositionRun<b2PrismaticJoint>(joints + i, runCount, data);
+			break;
+
+		case e_revoluteJoint:
+			runOkay = SolvePositionRun<b2RevoluteJoint>(joints + i, runCount, data);
+			break;
+
+		case e_pulleyJoint:
+			runOkay = SolvePositionRun<b2PulleyJoint>(joints + i, runCount, data);
+			break;
+
+		case e_gearJoint:
+			runOkay = SolvePositionRun<b2GearJoint>(joints + i, runCount, data);
+			break;
+
+		case e_wheelJoint:
+			runOkay = SolvePositionRun<b2WheelJoint>(joints + i, runCount, data);
+			break;
+
+		case e_weldJoint:
+			runOkay = SolvePositionRun<b2WeldJoint>(joints + i, runCount, data);
+			break;
+
+		case e_frictionJoint:
+			runOkay = SolvePositionRun<b2FrictionJoint>(joints + i, runCount, data);
+			break;
+
+		case e_ropeJoint:
+			runOkay = SolvePositionRun<b2RopeJoint>(joints + i, runCount, data);
+			break;
+
+		default:
+			b2Assert(false);
+			break;
+		}
+
+		solved = solved && runOkay;
+		i += runCount;
+	}
+	return solved;
+}
+
 b2Joint::b2Joint(const b2JointDef* def)
 {
 	b2Assert(def->bodyA != def->bodyB);
@@ -179,7 +409,9 @@ b2Joint::b2Joint(const b2JointDef* def)
 	m_bodyB = def->bodyB;
 	m_index = 0;
 	m_collideConnected = def->collideConnected;
-	m_islandFlag = false;
+	m_islandPrev = NULL;
+	m_islandNext = NULL;
+	m_islandLinked = false;
 	m_userData = def->userData;
 
 	m_edgeA.joint = NULL;
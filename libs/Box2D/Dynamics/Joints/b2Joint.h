@@ -149,16 +149,34 @@ protected:
 	friend class b2World;
 	friend class b2Body;
 	friend class b2Island;
+	friend class b2PersistentIsland;
 	friend class b2GearJoint;
+	friend class b2TreeJointSolver;
 
 	static b2Joint* Create(const b2JointDef* def, b2BlockAllocator* allocator);
 	static void Destroy(b2Joint* joint, b2BlockAllocator* allocator);
 
+	// Solve an array of joints in order with direct calls instead of virtual
+	// calls. Each run of consecutive joints of the same type is solved by one
+	// loop, so a chain of one joint type takes a single dispatch.
+	static void InitVelocityConstraints(b2Joint** joints, int32 count, const b2SolverData& data);
+	static float32 SolveVelocityConstraints(b2Joint** joints, int32 count, const b2SolverData& data);
+	static bool SolvePositionConstraints(b2Joint** joints, int32 count, const b2SolverData& data);
+
+	template <typename T>
+	static void InitVelocityRun(b2Joint** joints, int32 count, const b2SolverData& data);
+	template <typename T>
+	static float32 SolveVelocityRun(b2Joint** joints, int32 count, const b2SolverData& data);
+	template <typename T>
+	static bool SolvePositionRun(b2Joint** joints, int32 count, const b2SolverData& data);
+
 	b2Joint(const b2JointDef* def);
 	virtual ~b2Joint() {}
 
 	virtual void InitVelocityConstraints(const b2SolverData& data) = 0;
-	virtual void SolveVelocityConstraints(const b2SolverData& data) = 0;
+
+	// This returns the largest change of an impulse in this pass.
+	virtual float32 SolveVelocityConstraints(const b2SolverData& data) = 0;
 
 	// This returns true if the position errors are within tolerance.
 	virtual bool SolvePositionConstraints(const b2SolverData& data) = 0;
@@ -171,9 +189,14 @@ protected:
 	b2Body* m_bodyA;
 	b2Body* m_bodyB;
 
+	// Island list pointers. The joint is in the joint list of a persistent
+	// island when m_islandLinked is set.
+	b2Joint* m_islandPrev;
+	b2Joint* m_islandNext;
+
 	int32 m_index;
 
-	bool m_islandFlag;
+	bool m_islandLinked;
 	bool m_collideConnected;
 
 	void* m_userData;
@@ -96,9 +96,9 @@ float32 b2MouseJoint::GetDampingRatio() const
 void b2MouseJoint::InitVelocityConstraints(const b2SolverData& data)
 {
 	m_indexB = m_bodyB->m_islandIndex;
-	m_localCenterB = m_bodyB->m_sweep.localCenter;
-	m_invMassB = m_bodyB->m_invMass;
-	m_invIB = m_bodyB->m_invI;
+	m_localCenterB = m_bodyB->Sweep().localCenter;
+	m_invMassB = m_bodyB->InvMass();
+	m_invIB = m_bodyB->InvI();
 
 	b2Vec2 cB = data.positions[m_indexB].c;
 	float32 aB = data.positions[m_indexB].a;
@@ -165,7 +165,7 @@ void b2MouseJoint::InitVelocityConstraints(const b2SolverData& data)
 	data.velocities[m_indexB].w = wB;
 }
 
-void b2MouseJoint::SolveVelocityConstraints(const b2SolverData& data)
+float32 b2MouseJoint::SolveVelocityConstraints(const b2SolverData& data)
 {
 	b2Vec2 vB = data.velocities[m_indexB].v;
 	float32 wB = data.velocities[m_indexB].w;
@@ -188,6 +188,8 @@ void b2MouseJoint::SolveVelocityConstraints(const b2SolverData& data)
 
 	data.velocities[m_indexB].v = vB;
 	data.velocities[m_indexB].w = wB;
+
+	return b2Max(b2Abs(impulse.x), b2Abs(impulse.y));
 }
 
 bool b2MouseJoint::SolvePositionConstraints(const b2SolverData& data)
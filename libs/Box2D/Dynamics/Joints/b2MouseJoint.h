@@ -98,7 +98,7 @@ protected:
 	b2MouseJoint(const b2MouseJointDef* def);
 
 	void InitVelocityConstraints(const b2SolverData& data);
-	void SolveVelocityConstraints(const b2SolverData& data);
+	float32 SolveVelocityConstraints(const b2SolverData& data);
 	bool SolvePositionConstraints(const b2SolverData& data);
 
 	b2Vec2 m_localAnchorB;
@@ -65,12 +65,12 @@ void b2RevoluteJoint::InitVelocityConstraints(const b2SolverData& data)
 {
 	m_indexA = m_bodyA->m_islandIndex;
 	m_indexB = m_bodyB->m_islandIndex;
-	m_localCenterA = m_bodyA->m_sweep.localCenter;
-	m_localCenterB = m_bodyB->m_sweep.localCenter;
-	m_invMassA = m_bodyA->m_invMass;
-	m_invMassB = m_bodyB->m_invMass;
-	m_invIA = m_bodyA->m_invI;
-	m_invIB = m_bodyB->m_invI;
+	m_localCenterA = m_bodyA->Sweep().localCenter;
+	m_localCenterB = m_bodyB->Sweep().localCenter;
+	m_invMassA = m_bodyA->InvMass();
+	m_invMassB = m_bodyB->InvMass();
+	m_invIA = m_bodyA->InvI();
+	m_invIB = m_bodyB->InvI();
 
 	b2Vec2 cA = data.positions[m_indexA].c;
 	float32 aA = data.positions[m_indexA].a;
@@ -182,8 +182,10 @@ void b2RevoluteJoint::InitVelocityConstraints(const b2SolverData& data)
 	data.velocities[m_indexB].w = wB;
 }
 
-void b2RevoluteJoint::SolveVelocityConstraints(const b2SolverData& data)
+float32 b2RevoluteJoint::SolveVelocityConstraints(const b2SolverData& data)
 {
+	float32 maxDelta = 0.0f;
+
 	b2Vec2 vA = data.velocities[m_indexA].v;
 	float32 wA = data.velocities[m_indexA].w;
 	b2Vec2 vB = data.velocities[m_indexB].v;
@@ -203,6 +205,7 @@ void b2RevoluteJoint::SolveVelocityConstraints(const b2SolverData& data)
 		float32 maxImpulse = data.step.dt * m_maxMotorTorque;
 		m_motorImpulse = b2Clamp(m_motorImpulse + impulse, -maxImpulse, maxImpulse);
 		impulse = m_motorImpulse - oldImpulse;
+		maxDelta = b2Max(maxDelta, b2Abs(impulse));
 
 		wA -= iA * impulse;
 		wB += iB * impulse;
@@ -261,6 +264,7 @@ void b2RevoluteJoint::SolveVelocityConstraints(const b2SolverData& data)
 		}
 
 		b2Vec2 P(impulse.x, impulse.y);
+		maxDelta = b2Max(maxDelta, b2Max(b2Abs(impulse.x), b2Max(b2Abs(impulse.y), b2Abs(impulse.z))));
 
 		vA -= mA * P;
 		wA -= iA * (b2Cross(m_rA, P) + impulse.z);
@@ -276,6 +280,7 @@ void b2RevoluteJoint::SolveVelocityConstraints(const b2SolverData& data)
 
 		m_impulse.x += impulse.x;
 		m_impulse.y += impulse.y;
+		maxDelta = b2Max(maxDelta, b2Max(b2Abs(impulse.x), b2Abs(impulse.y)));
 
 		vA -= mA * impulse;
 		wA -= iA * b2Cross(m_rA, impulse);
@@ -288,6 +293,8 @@ void b2RevoluteJoint::SolveVelocityConstraints(const b2SolverData& data)
 	data.velocities[m_indexA].w = wA;
 	data.velocities[m_indexB].v = vB;
 	data.velocities[m_indexB].w = wB;
+
+	return maxDelta;
 }
 
 bool b2RevoluteJoint::SolvePositionConstraints(const b2SolverData& data)
@@ -401,14 +408,14 @@ float32 b2RevoluteJoint::GetJointAngle() const
 {
 	b2Body* bA = m_bodyA;
 	b2Body* bB = m_bodyB;
-	return bB->m_sweep.a - bA->m_sweep.a - m_referenceAngle;
+	return bB->Sweep().a - bA->Sweep().a - m_referenceAngle;
 }
 
 float32 b2RevoluteJoint::GetJointSpeed() const
 {
 	b2Body* bA = m_bodyA;
 	b2Body* bB = m_bodyB;
-	return bB->m_angularVelocity - bA->m_angularVelocity;
+	return bB->AngularVelocity() - bA->AngularVelocity();
 }
 
 bool b2RevoluteJoint::IsMotorEnabled() const
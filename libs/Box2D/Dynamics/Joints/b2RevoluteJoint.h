@@ -158,11 +158,12 @@ protected:
 
 	friend class b2Joint;
 	friend class b2GearJoint;
+	friend class b2TreeJointSolver;
 
 	b2RevoluteJoint(const b2RevoluteJointDef* def);
 
 	void InitVelocityConstraints(const b2SolverData& data);
-	void SolveVelocityConstraints(const b2SolverData& data);
+	float32 SolveVelocityConstraints(const b2SolverData& data);
 	bool SolvePositionConstraints(const b2SolverData& data);
 
 	// Solver shared
@@ -0,0 +1,738 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Dynamics/Joints/b2TreeJointSolver.h>
+#include <Box2D/Dynamics/Joints/b2DistanceJoint.h>
+#include <Box2D/Dynamics/Joints/b2RevoluteJoint.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Common/b2StackAllocator.h>
+
+#include <cstring>
+
+/*
+Tree Joint Solver Notes
+=======================
+The velocity change dv of the bodies and the joint impulses P solve
+
+	[M  J^T] [ dv] = [0]
+	[J   0 ] [-P ]   [c]
+
+where c = -J * v makes the joints rigid. The graph of this matrix has a node
+for each body and for each joint, and it is a tree when the joints form no
+loop. Eliminating the nodes from the leaves up creates no fill, so the matrix
+is factored in linear time.
+
+Exact velocities still leave the position errors that come from integrating
+rotations, and these add up along a loaded chain. A Newton step on the position
+errors would use the same factorization, but on long chains it asks for large
+rotations of the light bodies to fix small errors and then it diverges. Instead
+c = -J * v - beta / h * C, so the velocity solve removes the fraction beta of
+the position errors C in each step (Baumgarte stabilization). The bias is left
+out of the relax pass of the soft step. The joints then correct what is left
+by themselves like the other joints.
+
+A joint node has a zero block, so it can't be eliminated before its bodies.
+That is a problem for a joint to a static or kinematic body, which would be a
+leaf. Such a joint is kept in the node of its dynamic body instead, which has
+the invertible block [M, J^T; J, 0]. The block of a joint is also singular when
+the bodies below it are held in place, so the static and kinematic bodies count
+as a single body when looking for loops. A tree is then attached once at most
+and it is rooted at the attached body. A bridge anchored at both ends is a loop
+and one of its end joints is left to the iterative solver. Bodies with fixed
+rotation have no inverse of M and are left to the iterative solver too, like
+joints with motors, limits or springs.
+*/
+
+int32 b2TreeJointSolver::GetTreeBody(const b2Body* body, int32 staticSlotCount)
+{
+	if (body->m_type != b2_dynamicBody)
+	{
+		return -1;
+	}
+
+	if (body->InvI() == 0.0f)
+	{
+		return -2;
+	}
+
+	return body->m_islandIndex - staticSlotCount;
+}
+
+bool b2TreeJointSolver::IsTreeJoint(const b2Joint* joint)
+{
+	switch (joint->m_type)
+	{
+	case e_revoluteJoint:
+		{
+			const b2RevoluteJoint* revolute = (const b2RevoluteJoint*)joint;
+			return revolute->m_enableMotor == false && revolute->m_enableLimit == false;
+		}
+
+	case e_distanceJoint:
+		{
+			const b2DistanceJoint* distance = (const b2DistanceJoint*)joint;
+			return distance->m_frequencyHz == 0.0f && distance->m_length > b2_linearSlop;
+		}
+
+	default:
+		return false;
+	}
+}
+
+static int32 b2FindSet(int32* sets, int32 i)
+{
+	while (sets[i] != i)
+	{
+		sets[i] = sets[sets[i]];
+		i = sets[i];
+	}
+	return i;
+}
+
+// Invert a block with Gauss-Jordan elimination. The blocks of joint nodes are
+// negative definite and those of bodies with an attached joint are indefinite,
+// so the rows are pivoted.
+static void b2InvertBlock(float32 A[b2_maxTreeNodeSize][b2_maxTreeNodeSize],
+						  float32 invA[b2_maxTreeNodeSize][b2_maxTreeNodeSize], int32 size)
+{
+	for (int32 i = 0; i < size; ++i)
+	{
+		for (int32 j = 0; j < size; ++j)
+		{
+			invA[i][j] = i == j ? 1.0f : 0.0f;
+		}
+	}
+
+	for (int32 k = 0; k < size; ++k)
+	{
+		int32 pivot = k;
+		for (int32 i = k + 1; i < size; ++i)
+		{
+			if (b2Abs(A[i][k]) > b2Abs(A[pivot][k]))
+			{
+				pivot = i;
+			}
+		}
+
+		if (A[pivot][k] == 0.0f)
+		{
+			// Only a degenerate distance joint gets here. Leave it unsolved.
+			continue;
+		}
+
+		if (pivot != k)
+		{
+			for (int32 j = 0; j < size; ++j)
+			{
+				b2Swap(A[k][j], A[pivot][j]);
+				b2Swap(invA[k][j], invA[pivot][j]);
+			}
+		}
+
+		float32 s = 1.0f / A[k][k];
+		for (int32 j = 0; j < size; ++j)
+		{
+			A[k][j] *= s;
+			invA[k][j] *= s;
+		}
+
+		for (int32 i = 0; i < size; ++i)
+		{
+			float32 f = A[i][k];
+			if (i == k || f == 0.0f)
+			{
+				continue;
+			}
+
+			for (int32 j = 0; j < size; ++j)
+			{
+				A[i][j] -= f * A[k][j];
+				invA[i][j] -= f * invA[k][j];
+			}
+		}
+	}
+}
+
+b2TreeJointSolver::b2TreeJointSolver(b2TreeJointSolverDef* def)
+{
+	m_allocator = def->allocator;
+	m_joints = NULL;
+	m_nodes = NULL;
+	m_count = 0;
+	m_nodeCount = 0;
+
+	b2Joint** joints = def->joints;
+	int32 count = def->count;
+	b2Body** bodies = def->bodies;
+	int32 bodyCount = def->bodyCount;
+	int32 staticSlotCount = def->staticSlotCount;
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	// Take the joints in order as long as they form trees. The static and
+	// kinematic bodies count as a single body, see the notes above. A joint that
+	// closes a loop stays with the iterative solver.
+	int32 world = bodyCount;
+	int32* sets = (int32*)m_allocator->Allocate((bodyCount + 1) * sizeof(int32));
+	bool* treeBodies = (bool*)m_allocator->Allocate(bodyCount * sizeof(bool));
+	bool* inTree = (bool*)m_allocator->Allocate(count * sizeof(bool));
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		sets[i] = i;
+		treeBodies[i] = false;
+	}
+	sets[world] = world;
+
+	int32 treeBodyCount = 0;
+	int32 innerCount = 0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Joint* joint = joints[i];
+		inTree[i] = false;
+
+		if (IsTreeJoint(joint) == false)
+		{
+			continue;
+		}
+
+		int32 indexA = GetTreeBody(joint->m_bodyA, staticSlotCount);
+		int32 indexB = GetTreeBody(joint->m_bodyB, staticSlotCount);
+		if (indexA == -2 || indexB == -2 || (indexA == -1 && indexB == -1))
+		{
+			continue;
+		}
+
+		int32 setA = b2FindSet(sets, indexA >= 0 ? indexA : world);
+		int32 setB = b2FindSet(sets, indexB >= 0 ? indexB : world);
+		if (setA == setB)
+		{
+			continue;
+		}
+		sets[setA] = setB;
+
+		if (indexA >= 0 && indexB >= 0)
+		{
+			++innerCount;
+		}
+
+		if (indexA >= 0 && treeBodies[indexA] == false)
+		{
+			treeBodies[indexA] = true;
+			++treeBodyCount;
+		}
+
+		if (indexB >= 0 && treeBodies[indexB] == false)
+		{
+			treeBodies[indexB] = true;
+			++treeBodyCount;
+		}
+
+		inTree[i] = true;
+		++m_count;
+	}
+
+	if (m_count > 0)
+	{
+		b2Joint** order = (b2Joint**)m_allocator->Allocate(count * sizeof(b2Joint*));
+		int32 otherIndex = 0;
+		int32 treeIndex = count - m_count;
+		for (int32 i = 0; i < count; ++i)
+		{
+			if (inTree[i])
+			{
+				order[treeIndex++] = joints[i];
+			}
+			else
+			{
+				order[otherIndex++] = joints[i];
+			}
+		}
+		memcpy(joints, order, count * sizeof(b2Joint*));
+		m_allocator->Free(order);
+	}
+
+	m_allocator->Free(inTree);
+	m_allocator->Free(treeBodies);
+	m_allocator->Free(sets);
+
+	if (m_count == 0)
+	{
+		return;
+	}
+
+	m_joints = (b2TreeJoint*)m_allocator->Allocate(m_count * sizeof(b2TreeJoint));
+	m_nodes = (b2TreeJointNode*)m_allocator->Allocate((treeBodyCount + innerCount) * sizeof(b2TreeJointNode));
+
+	int32* bodyNodes = (int32*)m_allocator->Allocate(bodyCount * sizeof(int32));
+	int32* attachedJoints = (int32*)m_allocator->Allocate(bodyCount * sizeof(int32));
+	int32* edgeStart = (int32*)m_allocator->Allocate((bodyCount + 1) * sizeof(int32));
+	int32* edges = (int32*)m_allocator->Allocate(2 * innerCount * sizeof(int32));
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		bodyNodes[i] = -1;
+		attachedJoints[i] = -1;
+		edgeStart[i] = 0;
+	}
+	edgeStart[bodyCount] = 0;
+
+	b2Joint** treeJoints = joints + count - m_count;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2Joint* joint = treeJoints[i];
+		b2TreeJoint* tj = m_joints + i;
+		tj->joint = joint;
+		tj->indexA = joint->m_bodyA->m_islandIndex;
+		tj->indexB = joint->m_bodyB->m_islandIndex;
+		tj->nodeA = -1;
+		tj->nodeB = -1;
+		tj->rowCount = joint->m_type == e_revoluteJoint ? 2 : 1;
+
+		int32 indexA = GetTreeBody(joint->m_bodyA, staticSlotCount);
+		int32 indexB = GetTreeBody(joint->m_bodyB, staticSlotCount);
+		if (indexA >= 0 && indexB >= 0)
+		{
+			++edgeStart[indexA + 1];
+			++edgeStart[indexB + 1];
+		}
+		else
+		{
+			attachedJoints[indexA >= 0 ? indexA : indexB] = i;
+		}
+	}
+
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		edgeStart[i + 1] += edgeStart[i];
+	}
+
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2Joint* joint = treeJoints[i];
+		int32 indexA = GetTreeBody(joint->m_bodyA, staticSlotCount);
+		int32 indexB = GetTreeBody(joint->m_bodyB, staticSlotCount);
+		if (indexA >= 0 && indexB >= 0)
+		{
+			edges[edgeStart[indexA]++] = i;
+			edges[edgeStart[indexB]++] = i;
+		}
+	}
+
+	// Restore the starts.
+	for (int32 i = bodyCount; i > 0; --i)
+	{
+		edgeStart[i] = edgeStart[i - 1];
+	}
+	edgeStart[0] = 0;
+
+	// Walk each tree breadth first, so a parent comes before its children. The
+	// trees attached to a static or kinematic body are walked first, starting from
+	// the attached body.
+	for (int32 i = 0; i < 2 * bodyCount; ++i)
+	{
+		bool attachedRoot = i < bodyCount;
+		int32 root = attachedRoot ? i : i - bodyCount;
+		if (bodyNodes[root] != -1)
+		{
+			continue;
+		}
+
+		if (attachedRoot ? attachedJoints[root] == -1 : edgeStart[root] == edgeStart[root + 1])
+		{
+			continue;
+		}
+
+		int32 first = m_nodeCount;
+		bodyNodes[root] = AddBodyNode(bodies[root], -1, attachedJoints[root]);
+
+		for (int32 k = first; k < m_nodeCount; ++k)
+		{
+			const b2TreeJointNode* node = m_nodes + k;
+			if (node->index == -1)
+			{
+				// Add the other body of the joint.
+				const b2TreeJoint* tj = m_joints + node->joint;
+				int32 body = tj->indexA - staticSlotCount;
+				if (bodyNodes[body] != -1)
+				{
+					body = tj->indexB - staticSlotCount;
+				}
+				bodyNodes[body] = AddBodyNode(bodies[body], k, attachedJoints[body]);
+				continue;
+			}
+
+			// Add the joints of the body that lead away from its parent.
+			int32 index = node->index - staticSlotCount;
+			for (int32 e = edgeStart[index]; e < edgeStart[index + 1]; ++e)
+			{
+				b2TreeJoint* tj = m_joints + edges[e];
+				int32 other = tj->indexA == node->index ? tj->indexB : tj->indexA;
+				if (bodyNodes[other - staticSlotCount] != -1)
+				{
+					continue;
+				}
+
+				b2TreeJointNode* child = m_nodes + m_nodeCount;
+				child->parent = k;
+				child->size = tj->rowCount;
+				child->index = -1;
+				child->joint = edges[e];
+				tj->node = m_nodeCount;
+				tj->row = 0;
+				++m_nodeCount;
+			}
+		}
+	}
+
+	b2Assert(m_nodeCount == treeBodyCount + innerCount);
+
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2TreeJoint* tj = m_joints + i;
+		int32 indexA = GetTreeBody(tj->joint->m_bodyA, staticSlotCount);
+		int32 indexB = GetTreeBody(tj->joint->m_bodyB, staticSlotCount);
+		tj->nodeA = indexA >= 0 ? bodyNodes[indexA] : -1;
+		tj->nodeB = indexB >= 0 ? bodyNodes[indexB] : -1;
+	}
+
+	m_allocator->Free(edges);
+	m_allocator->Free(edgeStart);
+	m_allocator->Free(attachedJoints);
+	m_allocator->Free(bodyNodes);
+}
+
+int32 b2TreeJointSolver::AddBodyNode(b2Body* body, int32 parent, int32 attachedJoint)
+{
+	b2TreeJointNode* node = m_nodes + m_nodeCount;
+	node->parent = parent;
+	node->size = 3;
+	node->index = body->m_islandIndex;
+	node->joint = attachedJoint;
+	node->invMass = body->InvMass();
+	node->invI = body->InvI();
+
+	if (attachedJoint != -1)
+	{
+		b2TreeJoint* tj = m_joints + attachedJoint;
+		tj->node = m_nodeCount;
+		tj->row = 3;
+		node->size += tj->rowCount;
+	}
+
+	return m_nodeCount++;
+}
+
+b2TreeJointSolver::~b2TreeJointSolver()
+{
+	if (m_count > 0)
+	{
+		m_allocator->Free(m_nodes);
+		m_allocator->Free(m_joints);
+	}
+}
+
+void b2TreeJointSolver::ComputeJacobians()
+{
+	// The joints have computed their anchors and axis in InitVelocityConstraints.
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2TreeJoint* tj = m_joints + i;
+
+		if (tj->joint->m_type == e_revoluteJoint)
+		{
+			b2RevoluteJoint* joint = (b2RevoluteJoint*)tj->joint;
+			b2Vec2 rA = joint->m_rA;
+			b2Vec2 rB = joint->m_rB;
+			tj->JA[0].Set(-1.0f, 0.0f, rA.y);
+			tj->JA[1].Set(0.0f, -1.0f, -rA.x);
+			tj->JB[0].Set(1.0f, 0.0f, -rB.y);
+			tj->JB[1].Set(0.0f, 1.0f, rB.x);
+		}
+		else
+		{
+			b2DistanceJoint* joint = (b2DistanceJoint*)tj->joint;
+			b2Vec2 u = joint->m_u;
+			float32 crA = b2Cross(joint->m_rA, u);
+			float32 crB = b2Cross(joint->m_rB, u);
+			tj->JA[0].Set(-u.x, -u.y, -crA);
+			tj->JB[0].Set(u.x, u.y, crB);
+		}
+	}
+}
+
+void b2TreeJointSolver::ComputeBias(const b2SolverData& data)
+{
+	// The bias removes a fraction of the position error of each joint per step.
+	float32 beta = b2_baumgarte * data.step.inv_dt;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2TreeJoint* tj = m_joints + i;
+		b2Vec2 cA = data.positions[tj->indexA].c;
+		b2Vec2 cB = data.positions[tj->indexB].c;
+
+		if (tj->joint->m_type == e_revoluteJoint)
+		{
+			const b2RevoluteJoint* joint = (const b2RevoluteJoint*)tj->joint;
+			b2Vec2 C = cB + joint->m_rB - cA - joint->m_rA;
+			tj->bias[0] = beta * C.x;
+			tj->bias[1] = beta * C.y;
+		}
+		else
+		{
+			const b2DistanceJoint* joint = (const b2DistanceJoint*)tj->joint;
+			float32 C = b2Dot(joint->m_u, cB + joint->m_rB - cA - joint->m_rA) - joint->m_length;
+			tj->bias[0] = beta * C;
+		}
+	}
+}
+
+void b2TreeJointSolver::Factor()
+{
+	// Fill in the blocks of the nodes. L holds them until they are inverted.
+	for (int32 k = 0; k < m_nodeCount; ++k)
+	{
+		b2TreeJointNode* node = m_nodes + k;
+		memset(node->L, 0, sizeof(node->L));
+
+		if (node->index == -1)
+		{
+			continue;
+		}
+
+		node->L[0][0] = 1.0f / node->invMass;
+		node->L[1][1] = 1.0f / node->invMass;
+		node->L[2][2] = 1.0f / node->invI;
+
+		if (node->joint != -1)
+		{
+			const b2TreeJoint* tj = m_joints + node->joint;
+			const b2Vec3* J = tj->nodeA == k ? tj->JA : tj->JB;
+			for (int32 r = 0; r < tj->rowCount; ++r)
+			{
+				node->L[3 + r][0] = node->L[0][3 + r] = J[r].x;
+				node->L[3 + r][1] = node->L[1][3 + r] = J[r].y;
+				node->L[3 + r][2] = node->L[2][3 + r] = J[r].z;
+			}
+		}
+	}
+
+	// Eliminate the nodes from the leaves up. Each node subtracts its part from
+	// the block of its parent.
+	for (int32 k = m_nodeCount - 1; k >= 0; --k)
+	{
+		b2TreeJointNode* node = m_nodes + k;
+		int32 size = node->size;
+
+		b2InvertBlock(node->L, node->invD, size);
+
+		if (node->parent == -1)
+		{
+			continue;
+		}
+
+		b2TreeJointNode* parent = m_nodes + node->parent;
+		int32 parentSize = parent->size;
+
+		// The block E between the node and its parent holds the Jacobian of the
+		// joint for the body.
+		float32 E[b2_maxTreeNodeSize][b2_maxTreeNodeSize];
+		memset(E, 0, sizeof(E));
+		if (node->index == -1)
+		{
+			const b2TreeJoint* tj = m_joints + node->joint;
+			const b2Vec3* J = tj->nodeA == node->parent ? tj->JA : tj->JB;
+			for (int32 r = 0; r < tj->rowCount; ++r)
+			{
+				E[r][0] = J[r].x;
+				E[r][1] = J[r].y;
+				E[r][2] = J[r].z;
+			}
+		}
+		else
+		{
+			const b2TreeJoint* tj = m_joints + parent->joint;
+			const b2Vec3* J = tj->nodeA == k ? tj->JA : tj->JB;
+			for (int32 r = 0; r < tj->rowCount; ++r)
+			{
+				E[0][r] = J[r].x;
+				E[1][r] = J[r].y;
+				E[2][r] = J[r].z;
+			}
+		}
+
+		for (int32 i = 0; i < size; ++i)
+		{
+			for (int32 j = 0; j < parentSize; ++j)
+			{
+				float32 sum = 0.0f;
+				for (int32 m = 0; m < size; ++m)
+				{
+					sum += node->invD[i][m] * E[m][j];
+				}
+				node->L[i][j] = sum;
+			}
+		}
+
+		for (int32 i = 0; i < parentSize; ++i)
+		{
+			for (int32 j = 0; j < parentSize; ++j)
+			{
+				float32 sum = 0.0f;
+				for (int32 m = 0; m < size; ++m)
+				{
+					sum += E[m][i] * node->L[m][j];
+				}
+				parent->L[i][j] -= sum;
+			}
+		}
+	}
+}
+
+void b2TreeJointSolver::Solve()
+{
+	// Forward substitution from the leaves up.
+	for (int32 k = m_nodeCount - 1; k > 0; --k)
+	{
+		b2TreeJointNode* node = m_nodes + k;
+		if (node->parent == -1)
+		{
+			continue;
+		}
+
+		b2TreeJointNode* parent = m_nodes + node->parent;
+		for (int32 j = 0; j < parent->size; ++j)
+		{
+			float32 sum = 0.0f;
+			for (int32 i = 0; i < node->size; ++i)
+			{
+				sum += node->L[i][j] * node->x[i];
+			}
+			parent->x[j] -= sum;
+		}
+	}
+
+	// Back substitution from the roots down.
+	for (int32 k = 0; k < m_nodeCount; ++k)
+	{
+		b2TreeJointNode* node = m_nodes + k;
+		const b2TreeJointNode* parent = node->parent != -1 ? m_nodes + node->parent : NULL;
+
+		float32 x[b2_maxTreeNodeSize];
+		for (int32 i = 0; i < node->size; ++i)
+		{
+			float32 sum = 0.0f;
+			for (int32 j = 0; j < node->size; ++j)
+			{
+				sum += node->invD[i][j] * node->x[j];
+			}
+
+			if (parent)
+			{
+				for (int32 j = 0; j < parent->size; ++j)
+				{
+					sum -= node->L[i][j] * parent->x[j];
+				}
+			}
+
+			x[i] = sum;
+		}
+
+		for (int32 i = 0; i < node->size; ++i)
+		{
+			node->x[i] = x[i];
+		}
+	}
+}
+
+void b2TreeJointSolver::InitVelocityConstraints(const b2SolverData& data)
+{
+	if (m_count == 0)
+	{
+		return;
+	}
+
+	ComputeJacobians();
+	ComputeBias(data);
+	Factor();
+}
+
+float32 b2TreeJointSolver::SolveVelocityConstraints(const b2SolverData& data, bool useBias)
+{
+	if (m_count == 0)
+	{
+		return 0.0f;
+	}
+
+	for (int32 k = 0; k < m_nodeCount; ++k)
+	{
+		memset(m_nodes[k].x, 0, sizeof(m_nodes[k].x));
+	}
+
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		const b2TreeJoint* tj = m_joints + i;
+		b2Vec2 vA = data.velocities[tj->indexA].v;
+		float32 wA = data.velocities[tj->indexA].w;
+		b2Vec2 vB = data.velocities[tj->indexB].v;
+		float32 wB = data.velocities[tj->indexB].w;
+
+		b2TreeJointNode* node = m_nodes + tj->node;
+		for (int32 r = 0; r < tj->rowCount; ++r)
+		{
+			float32 Cdot = b2Dot(tj->JA[r], b2Vec3(vA.x, vA.y, wA)) + b2Dot(tj->JB[r], b2Vec3(vB.x, vB.y, wB));
+			node->x[tj->row + r] = useBias ? -(Cdot + tj->bias[r]) : -Cdot;
+		}
+	}
+
+	Solve();
+
+	for (int32 k = 0; k < m_nodeCount; ++k)
+	{
+		const b2TreeJointNode* node = m_nodes + k;
+		if (node->index != -1)
+		{
+			data.velocities[node->index].v += b2Vec2(node->x[0], node->x[1]);
+			data.velocities[node->index].w += node->x[2];
+		}
+	}
+
+	float32 maxDelta = 0.0f;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		const b2TreeJoint* tj = m_joints + i;
+		const float32* x = m_nodes[tj->node].x + tj->row;
+
+		if (tj->joint->m_type == e_revoluteJoint)
+		{
+			b2RevoluteJoint* joint = (b2RevoluteJoint*)tj->joint;
+			joint->m_impulse.x -= x[0];
+			joint->m_impulse.y -= x[1];
+			maxDelta = b2Max(maxDelta, b2Max(b2Abs(x[0]), b2Abs(x[1])));
+		}
+		else
+		{
+			b2DistanceJoint* joint = (b2DistanceJoint*)tj->joint;
+			joint->m_impulse -= x[0];
+			maxDelta = b2Max(maxDelta, b2Abs(x[0]));
+		}
+	}
+
+	return maxDelta;
+}
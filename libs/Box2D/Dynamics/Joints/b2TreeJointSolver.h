@@ -0,0 +1,118 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_TREE_JOINT_SOLVER_H
+#define B2_TREE_JOINT_SOLVER_H
+
+#include <Box2D/Common/b2Math.h>
+#include <Box2D/Dynamics/b2TimeStep.h>
+
+class b2Body;
+class b2Joint;
+class b2StackAllocator;
+
+// The largest block of a tree node: the velocity of a body and the two rows of
+// a revolute joint that attaches it to a static or kinematic body.
+const int32 b2_maxTreeNodeSize = 5;
+
+// A joint solved by the tree solver. The Jacobian rows are those of the joint
+// for the velocities (v.x, v.y, w) of each body.
+struct b2TreeJoint
+{
+	b2Joint* joint;
+	int32 indexA;
+	int32 indexB;
+	int32 nodeA;	// the body node, or -1 for a static or kinematic body
+	int32 nodeB;
+	int32 node;		// the node that holds the rows of the joint
+	int32 row;		// the first row of the joint in the node
+	int32 rowCount;
+	b2Vec3 JA[2];
+	b2Vec3 JB[2];
+	float32 bias[2];	// the velocity that corrects the position error
+};
+
+// A body or a joint in the tree. A body node also holds the joint that attaches
+// it to a static or kinematic body, if any, so that it is never a leaf with a
+// zero block. The nodes are ordered from the roots down, so a parent always
+// comes before its children.
+struct b2TreeJointNode
+{
+	int32 parent;
+	int32 size;
+	int32 index;	// the solver slot of a body node
+	int32 joint;	// the tree joint of a joint node or the attached joint of a body node, or -1
+	float32 invMass;
+	float32 invI;
+	float32 invD[b2_maxTreeNodeSize][b2_maxTreeNodeSize];
+	float32 L[b2_maxTreeNodeSize][b2_maxTreeNodeSize];	// invD times the block of the parent
+	float32 x[b2_maxTreeNodeSize];
+};
+
+struct b2TreeJointSolverDef
+{
+	b2Joint** joints;
+	int32 count;
+	b2Body** bodies;	// the island bodies, body i has the solver slot staticSlotCount + i
+	int32 bodyCount;
+	int32 staticSlotCount;
+	b2StackAllocator* allocator;
+};
+
+/// Solve the rigid revolute and distance joints that form trees, such as chains,
+/// bridges and ragdolls, exactly with a linear time factorization of the joint
+/// equations instead of iterations. See D. Baraff, Linear-Time Dynamics using
+/// Lagrange Multipliers, SIGGRAPH 1996. Joints that would close a loop are left
+/// to the iterative solver, and so are the contacts.
+class b2TreeJointSolver
+{
+public:
+	// Find the tree joints and move them behind the other joints, keeping the
+	// order of both.
+	b2TreeJointSolver(b2TreeJointSolverDef* def);
+	~b2TreeJointSolver();
+
+	// Factor the joint equations at the current positions. The joints must have
+	// been initialized by b2Joint::InitVelocityConstraints.
+	void InitVelocityConstraints(const b2SolverData& data);
+
+	// Solve the joints exactly at the current velocities. With the bias, the
+	// solution also removes a fraction of the position errors, see the notes in
+	// the source. This returns the largest change of an impulse.
+	float32 SolveVelocityConstraints(const b2SolverData& data, bool useBias);
+
+	b2StackAllocator* m_allocator;
+	b2TreeJoint* m_joints;
+	b2TreeJointNode* m_nodes;
+	int32 m_count;
+	int32 m_nodeCount;
+
+private:
+	// Return the island index of a body that can be a tree node, -1 for a static
+	// or kinematic body, or -2 for a body that can't be in a tree.
+	static int32 GetTreeBody(const b2Body* body, int32 staticSlotCount);
+	static bool IsTreeJoint(const b2Joint* joint);
+
+	int32 AddBodyNode(b2Body* body, int32 parent, int32 attachedJoint);
+	void ComputeJacobians();
+	void ComputeBias(const b2SolverData& data);
+	void Factor();
+	void Solve();
+};
+
+#endif
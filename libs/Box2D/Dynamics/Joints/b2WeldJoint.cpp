@@ -59,12 +59,12 @@ void b2WeldJoint::InitVelocityConstraints(const b2SolverData& data)
 {
 	m_indexA = m_bodyA->m_islandIndex;
 	m_indexB = m_bodyB->m_islandIndex;
-	m_localCenterA = m_bodyA->m_sweep.localCenter;
-	m_localCenterB = m_bodyB->m_sweep.localCenter;
-	m_invMassA = m_bodyA->m_invMass;
-	m_invMassB = m_bodyB->m_invMass;
-	m_invIA = m_bodyA->m_invI;
-	m_invIB = m_bodyB->m_invI;
+	m_localCenterA = m_bodyA->Sweep().localCenter;
+	m_localCenterB = m_bodyB->Sweep().localCenter;
+	m_invMassA = m_bodyA->InvMass();
+	m_invMassB = m_bodyB->InvMass();
+	m_invIA = m_bodyA->InvI();
+	m_invIB = m_bodyB->InvI();
 
 	b2Vec2 cA = data.positions[m_indexA].c;
 	float32 aA = data.positions[m_indexA].a;
@@ -162,8 +162,10 @@ void b2WeldJoint::InitVelocityConstraints(const b2SolverData& data)
 	data.velocities[m_indexB].w = wB;
 }
 
-void b2WeldJoint::SolveVelocityConstraints(const b2SolverData& data)
+float32 b2WeldJoint::SolveVelocityConstraints(const b2SolverData& data)
 {
+	float32 maxDelta = 0.0f;
+
 	b2Vec2 vA = data.velocities[m_indexA].v;
 	float32 wA = data.velocities[m_indexA].w;
 	b2Vec2 vB = data.velocities[m_indexB].v;
@@ -178,6 +180,7 @@ void b2WeldJoint::SolveVelocityConstraints(const b2SolverData& data)
 
 		float32 impulse2 = -m_mass.ez.z * (Cdot2 + m_bias + m_gamma * m_impulse.z);
 		m_impulse.z += impulse2;
+		maxDelta = b2Max(maxDelta, b2Abs(impulse2));
 
 		wA -= iA * impulse2;
 		wB += iB * impulse2;
@@ -187,6 +190,7 @@ void b2WeldJoint::SolveVelocityConstraints(const b2SolverData& data)
 		b2Vec2 impulse1 = -b2Mul22(m_mass, Cdot1);
 		m_impulse.x += impulse1.x;
 		m_impulse.y += impulse1.y;
+		maxDelta = b2Max(maxDelta, b2Max(b2Abs(impulse1.x), b2Abs(impulse1.y)));
 
 		b2Vec2 P = impulse1;
 
@@ -204,6 +208,7 @@ void b2WeldJoint::SolveVelocityConstraints(const b2SolverData& data)
 
 		b2Vec3 impulse = -b2Mul(m_mass, Cdot);
 		m_impulse += impulse;
+		maxDelta = b2Max(maxDelta, b2Max(b2Abs(impulse.x), b2Max(b2Abs(impulse.y), b2Abs(impulse.z))));
 
 		b2Vec2 P(impulse.x, impulse.y);
 
@@ -218,6 +223,8 @@ void b2WeldJoint::SolveVelocityConstraints(const b2SolverData& data)
 	data.velocities[m_indexA].w = wA;
 	data.velocities[m_indexB].v = vB;
 	data.velocities[m_indexB].w = wB;
+
+	return maxDelta;
 }
 
 bool b2WeldJoint::SolvePositionConstraints(const b2SolverData& data)
@@ -95,7 +95,7 @@ protected:
 	b2WeldJoint(const b2WeldJointDef* def);
 
 	void InitVelocityConstraints(const b2SolverData& data);
-	void SolveVelocityConstraints(const b2SolverData& data);
+	float32 SolveVelocityConstraints(const b2SolverData& data);
 	bool SolvePositionConstraints(const b2SolverData& data);
 
 	float32 m_frequencyHz;
@@ -78,12 +78,12 @@ void b2WheelJoint::InitVelocityConstraints(const b2SolverData& data)
 {
 	m_indexA = m_bodyA->m_islandIndex;
 	m_indexB = m_bodyB->m_islandIndex;
-	m_localCenterA = m_bodyA->m_sweep.localCenter;
-	m_localCenterB = m_bodyB->m_sweep.localCenter;
-	m_invMassA = m_bodyA->m_invMass;
-	m_invMassB = m_bodyB->m_invMass;
-	m_invIA = m_bodyA->m_invI;
-	m_invIB = m_bodyB->m_invI;
+	m_localCenterA = m_bodyA->Sweep().localCenter;
+	m_localCenterB = m_bodyB->Sweep().localCenter;
+	m_invMassA = m_bodyA->InvMass();
+	m_invMassB = m_bodyB->InvMass();
+	m_invIA = m_bodyA->InvI();
+	m_invIB = m_bodyB->InvI();
 
 	float32 mA = m_invMassA, mB = m_invMassB;
 	float32 iA = m_invIA, iB = m_invIB;
@@ -213,8 +213,10 @@ void b2WheelJoint::InitVelocityConstraints(const b2SolverData& data)
 	data.velocities[m_indexB].w = wB;
 }
 
-void b2WheelJoint::SolveVelocityConstraints(const b2SolverData& data)
+float32 b2WheelJoint::SolveVelocityConstraints(const b2SolverData& data)
 {
+	float32 maxDelta = 0.0f;
+
 	float32 mA = m_invMassA, mB = m_invMassB;
 	float32 iA = m_invIA, iB = m_invIB;
 
@@ -228,6 +230,7 @@ void b2WheelJoint::SolveVelocityConstraints(const b2SolverData& data)
 		float32 Cdot = b2Dot(m_ax, vB - vA) + m_sBx * wB - m_sAx * wA;
 		float32 impulse = -m_springMass * (Cdot + m_bias + m_gamma * m_springImpulse);
 		m_springImpulse += impulse;
+		maxDelta = b2Max(maxDelta, b2Abs(impulse));
 
 		b2Vec2 P = impulse * m_ax;
 		float32 LA = impulse * m_sAx;
@@ -249,6 +252,7 @@ void b2WheelJoint::SolveVelocityConstraints(const b2SolverData& data)
 		float32 maxImpulse = data.step.dt * m_maxMotorTorque;
 		m_motorImpulse = b2Clamp(m_motorImpulse + impulse, -maxImpulse, maxImpulse);
 		impulse = m_motorImpulse - oldImpulse;
+		maxDelta = b2Max(maxDelta, b2Abs(impulse));
 
 		wA -= iA * impulse;
 		wB += iB * impulse;
@@ -259,6 +263,7 @@ void b2WheelJoint::SolveVelocityConstraints(const b2SolverData& data)
 		float32 Cdot = b2Dot(m_ay, vB - vA) + m_sBy * wB - m_sAy * wA;
 		float32 impulse = -m_mass * Cdot;
 		m_impulse += impulse;
+		maxDelta = b2Max(maxDelta, b2Abs(impulse));
 
 		b2Vec2 P = impulse * m_ay;
 		float32 LA = impulse * m_sAy;
@@ -275,6 +280,8 @@ void b2WheelJoint::SolveVelocityConstraints(const b2SolverData& data)
 	data.velocities[m_indexA].w = wA;
 	data.velocities[m_indexB].v = vB;
 	data.velocities[m_indexB].w = wB;
+
+	return maxDelta;
 }
 
 bool b2WheelJoint::SolvePositionConstraints(const b2SolverData& data)
@@ -362,8 +369,8 @@ float32 b2WheelJoint::GetJointTranslation() const
 
 float32 b2WheelJoint::GetJointSpeed() const
 {
-	float32 wA = m_bodyA->m_angularVelocity;
-	float32 wB = m_bodyB->m_angularVelocity;
+	float32 wA = m_bodyA->AngularVelocity();
+	float32 wB = m_bodyB->AngularVelocity();
 	return wB - wA;
 }
 
@@ -19,10 +19,12 @@
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2Fixture.h>
 #include <Box2D/Dynamics/b2World.h>
+#include <Box2D/Dynamics/b2Island.h>
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
 #include <Box2D/Dynamics/Joints/b2Joint.h>
+#include <Box2D/Collision/Shapes/b2PolygonShape.h>
 
-b2Body::b2Body(const b2BodyDef* bd, b2World* world)
+b2Body::b2Body(const b2BodyDef* bd, b2World* world, int32 worldIndex)
 {
 	b2Assert(bd->position.IsValid());
 	b2Assert(bd->linearVelocity.IsValid());
@@ -55,49 +57,65 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 	}
 
 	m_world = world;
+	m_states = &world->m_bodyStates;
+	m_worldIndex = worldIndex;
 
-	m_xf.p = bd->position;
-	m_xf.q.Set(bd->angle);
+	Transform().p = bd->position;
+	Transform().q.Set(bd->angle);
 
-	m_sweep.localCenter.SetZero();
-	m_sweep.c0 = m_xf.p;
-	m_sweep.c = m_xf.p;
-	m_sweep.a0 = bd->angle;
-	m_sweep.a = bd->angle;
-	m_sweep.alpha0 = 0.0f;
+	Sweep().localCenter.SetZero();
+	Sweep().c0 = Transform().p;
+	Sweep().c = Transform().p;
+	Sweep().a0 = bd->angle;
+	Sweep().a = bd->angle;
+	Sweep().alpha0 = 0.0f;
 
 	m_jointList = NULL;
 	m_contactList = NULL;
 	m_prev = NULL;
 	m_next = NULL;
 
-	m_linearVelocity = bd->linearVelocity;
-	m_angularVelocity = bd->angularVelocity;
+	m_island = NULL;
+	m_islandPrev = NULL;
+	m_islandNext = NULL;
+	m_awakeIndex = -1;
+
+	LinearVelocity() = bd->linearVelocity;
+	AngularVelocity() = bd->angularVelocity;
 
 	m_linearDamping = bd->linearDamping;
 	m_angularDamping = bd->angularDamping;
 	m_gravityScale = bd->gravityScale;
 
-	m_force.SetZero();
-	m_torque = 0.0f;
+	Force().SetZero();
+	Torque() = 0.0f;
 
 	m_sleepTime = 0.0f;
+	m_minExtent = b2_maxFloat;
 
 	m_type = bd->type;
 
+	// Static bodies never move, so the initial velocity is ignored like in
+	// SetLinearVelocity. Islands solved concurrently never write static bodies.
+	if (m_type == b2_staticBody)
+	{
+		LinearVelocity().SetZero();
+		AngularVelocity() = 0.0f;
+	}
+
 	if (m_type == b2_dynamicBody)
 	{
 		m_mass = 1.0f;
-		m_invMass = 1.0f;
+		InvMass() = 1.0f;
 	}
 	else
 	{
 		m_mass = 0.0f;
-		m_invMass = 0.0f;
+		InvMass() = 0.0f;
 	}
 
 	m_I = 0.0f;
-	m_invI = 0.0f;
+	InvI() = 0.0f;
 
 	m_userData = bd->userData;
 
@@ -123,23 +141,41 @@ void b2Body::SetType(b2BodyType type)
 		return;
 	}
 
+	// The body and its constraints may move to a different island.
+	m_world->RemoveFromIsland(this);
+
 	m_type = type;
 
+	m_world->AddToIsland(this);
+
+	// The proxies move to the broad-phase tree of the new type. The contacts
+	// keep working with the new proxy ids.
+	if (m_flags & e_activeFlag)
+	{
+		b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
+		for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
+		{
+			f->DestroyProxies(broadPhase);
+			f->CreateProxies(broadPhase, Transform());
+		}
+	}
+
 	ResetMassData();
 
 	if (m_type == b2_staticBody)
 	{
-		m_linearVelocity.SetZero();
-		m_angularVelocity = 0.0f;
-		m_sweep.a0 = m_sweep.a;
-		m_sweep.c0 = m_sweep.c;
+		LinearVelocity().SetZero();
+		AngularVelocity() = 0.0f;
+		Sweep().a0 = Sweep().a;
+		Sweep().c0 = Sweep().c;
 		SynchronizeFixtures();
 	}
 
 	SetAwake(true);
+	m_world->UpdateAwakeSet(this);
 
-	m_force.SetZero();
-	m_torque = 0.0f;
+	Force().SetZero();
+	Torque() = 0.0f;
 
 	// Since the body type changed, we need to flag contacts for filtering.
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
@@ -165,7 +201,7 @@ b2Fixture* b2Body::CreateFixture(const b2FixtureDef* def)
 	if (m_flags & e_activeFlag)
 	{
 		b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
-		fixture->CreateProxies(broadPhase, m_xf);
+		fixture->CreateProxies(broadPhase, Transform());
 	}
 
 	fixture->m_next = m_fixtureList;
@@ -174,6 +210,8 @@ b2Fixture* b2Body::CreateFixture(const b2FixtureDef* def)
 
 	fixture->m_body = this;
 
+	UpdateMinExtent();
+
 	// Adjust mass properties if needed.
 	if (fixture->m_density > 0.0f)
 	{
@@ -259,25 +297,51 @@ void b2Body::DestroyFixture(b2Fixture* fixture)
 
 	--m_fixtureCount;
 
+	UpdateMinExtent();
+
 	// Reset the mass data.
 	ResetMassData();
 }
 
+void b2Body::UpdateMinExtent()
+{
+	m_minExtent = b2_maxFloat;
+	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
+	{
+		const b2Shape* shape = f->GetShape();
+		float32 extent = shape->m_radius;
+		if (shape->GetType() == b2Shape::e_polygon)
+		{
+			// The distance from the centroid to the nearest side.
+			const b2PolygonShape* poly = (const b2PolygonShape*)shape;
+			float32 inner = b2_maxFloat;
+			for (int32 i = 0; i < poly->m_vertexCount; ++i)
+			{
+				inner = b2Min(inner, b2Dot(poly->m_normals[i], poly->m_vertices[i] - poly->m_centroid));
+			}
+			extent += inner;
+		}
+
+		// Edges and chains only have the skin.
+		m_minExtent = b2Min(m_minExtent, b2Max(extent, b2_linearSlop));
+	}
+}
+
 void b2Body::ResetMassData()
 {
 	// Compute mass data from shapes. Each shape has its own density.
 	m_mass = 0.0f;
-	m_invMass = 0.0f;
+	InvMass() = 0.0f;
 	m_I = 0.0f;
-	m_invI = 0.0f;
-	m_sweep.localCenter.SetZero();
+	InvI() = 0.0f;
+	Sweep().localCenter.SetZero();
 
 	// Static and kinematic bodies have zero mass.
 	if (m_type == b2_staticBody || m_type == b2_kinematicBody)
 	{
-		m_sweep.c0 = m_xf.p;
-		m_sweep.c = m_xf.p;
-		m_sweep.a0 = m_sweep.a;
+		Sweep().c0 = Transform().p;
+		Sweep().c = Transform().p;
+		Sweep().a0 = Sweep().a;
 		return;
 	}
 
@@ -302,14 +366,14 @@ void b2Body::ResetMassData()
 	// Compute center of mass.
 	if (m_mass > 0.0f)
 	{
-		m_invMass = 1.0f / m_mass;
-		localCenter *= m_invMass;
+		InvMass() = 1.0f / m_mass;
+		localCenter *= InvMass();
 	}
 	else
 	{
 		// Force all dynamic bodies to have a positive mass.
 		m_mass = 1.0f;
-		m_invMass = 1.0f;
+		InvMass() = 1.0f;
 	}
 
 	if (m_I > 0.0f && (m_flags & e_fixedRotationFlag) == 0)
@@ -317,22 +381,22 @@ void b2Body::ResetMassData()
 		// Center the inertia about the center of mass.
 		m_I -= m_mass * b2Dot(localCenter, localCenter);
 		b2Assert(m_I > 0.0f);
-		m_invI = 1.0f / m_I;
+		InvI() = 1.0f / m_I;
 
 	}
 	else
 	{
 		m_I = 0.0f;
-		m_invI = 0.0f;
+		InvI() = 0.0f;
 	}
 
 	// Move center of mass.
-	b2Vec2 oldCenter = m_sweep.c;
-	m_sweep.localCenter = localCenter;
-	m_sweep.c0 = m_sweep.c = b2Mul(m_xf, m_sweep.localCenter);
+	b2Vec2 oldCenter = Sweep().c;
+	Sweep().localCenter = localCenter;
+	Sweep().c0 = Sweep().c = b2Mul(Transform(), Sweep().localCenter);
 
 	// Update center of mass velocity.
-	m_linearVelocity += b2Cross(m_angularVelocity, m_sweep.c - oldCenter);
+	LinearVelocity() += b2Cross(AngularVelocity(), Sweep().c - oldCenter);
 }
 
 void b2Body::SetMassData(const b2MassData* massData)
@@ -348,9 +412,9 @@ void b2Body::SetMassData(const b2MassData* massData)
 		return;
 	}
 
-	m_invMass = 0.0f;
+	InvMass() = 0.0f;
 	m_I = 0.0f;
-	m_invI = 0.0f;
+	InvI() = 0.0f;
 
 	m_mass = massData->mass;
 	if (m_mass <= 0.0f)
@@ -358,22 +422,22 @@ void b2Body::SetMassData(const b2MassData* massData)
 		m_mass = 1.0f;
 	}
 
-	m_invMass = 1.0f / m_mass;
+	InvMass() = 1.0f / m_mass;
 
 	if (massData->I > 0.0f && (m_flags & b2Body::e_fixedRotationFlag) == 0)
 	{
 		m_I = massData->I - m_mass * b2Dot(massData->center, massData->center);
 		b2Assert(m_I > 0.0f);
-		m_invI = 1.0f / m_I;
+		InvI() = 1.0f / m_I;
 	}
 
 	// Move center of mass.
-	b2Vec2 oldCenter = m_sweep.c;
-	m_sweep.localCenter =  massData->center;
-	m_sweep.c0 = m_sweep.c = b2Mul(m_xf, m_sweep.localCenter);
+	b2Vec2 oldCenter = Sweep().c;
+	Sweep().localCenter =  massData->center;
+	Sweep().c0 = Sweep().c = b2Mul(Transform(), Sweep().localCenter);
 
 	// Update center of mass velocity.
-	m_linearVelocity += b2Cross(m_angularVelocity, m_sweep.c - oldCenter);
+	LinearVelocity() += b2Cross(AngularVelocity(), Sweep().c - oldCenter);
 }
 
 bool b2Body::ShouldCollide(const b2Body* other) const
@@ -407,19 +471,19 @@ void b2Body::SetTransform(const b2Vec2& position, float32 angle)
 		return;
 	}
 
-	m_xf.q.Set(angle);
-	m_xf.p = position;
+	Transform().q.Set(angle);
+	Transform().p = position;
 
-	m_sweep.c = b2Mul(m_xf, m_sweep.localCenter);
-	m_sweep.a = angle;
+	Sweep().c = b2Mul(Transform(), Sweep().localCenter);
+	Sweep().a = angle;
 
-	m_sweep.c0 = m_sweep.c;
-	m_sweep.a0 = angle;
+	Sweep().c0 = Sweep().c;
+	Sweep().a0 = angle;
 
 	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
 	{
-		f->Synchronize(broadPhase, m_xf, m_xf);
+		f->Synchronize(broadPhase, Transform(), Transform(), b2Vec2_zero);
 	}
 
 	m_world->m_contactManager.FindNewContacts();
@@ -428,13 +492,63 @@ void b2Body::SetTransform(const b2Vec2& position, float32 angle)
 void b2Body::SynchronizeFixtures()
 {
 	b2Transform xf1;
-	xf1.q.Set(m_sweep.a0);
-	xf1.p = m_sweep.c0 - b2Mul(xf1.q, m_sweep.localCenter);
+	xf1.q.Set(Sweep().a0);
+	xf1.p = Sweep().c0 - b2Mul(xf1.q, Sweep().localCenter);
+
+	b2Vec2 ahead = ComputeLookAhead(xf1);
+
+	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
+	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
+	{
+		f->Synchronize(broadPhase, xf1, Transform(), ahead);
+	}
+}
+
+b2Vec2 b2Body::ComputeLookAhead(const b2Transform& xf1) const
+{
+	// Speculative contacts need the pairs one step ahead. Assume the body keeps
+	// moving as it did in this step.
+	if (m_world->m_contactManager.m_speculativeTime > 0.0f)
+	{
+		return Transform().p - xf1.p;
+	}
+
+	return b2Vec2_zero;
+}
+
+bool b2Body::ComputeFixtureAABBs()
+{
+	b2Transform xf1;
+	xf1.q.Set(Sweep().a0);
+	xf1.p = Sweep().c0 - b2Mul(xf1.q, Sweep().localCenter);
+
+	b2Vec2 ahead = ComputeLookAhead(xf1);
+
+	const b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
+	bool move = false;
+	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
+	{
+		if (f->ComputeProxyAABBs(broadPhase, xf1, Transform(), ahead))
+		{
+			move = true;
+		}
+	}
+
+	return move;
+}
+
+void b2Body::MoveFixtureProxies()
+{
+	b2Transform xf1;
+	xf1.q.Set(Sweep().a0);
+	xf1.p = Sweep().c0 - b2Mul(xf1.q, Sweep().localCenter);
+
+	b2Vec2 displacement = Transform().p - xf1.p;
 
 	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
 	{
-		f->Synchronize(broadPhase, xf1, m_xf);
+		f->MoveProxies(broadPhase, displacement);
 	}
 }
 
@@ -455,10 +569,12 @@ void b2Body::SetActive(bool flag)
 		b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 		for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
 		{
-			f->CreateProxies(broadPhase, m_xf);
+			f->CreateProxies(broadPhase, Transform());
 		}
 
 		// Contacts are created the next time step.
+
+		m_world->AddToIsland(this);
 	}
 	else
 	{
@@ -480,6 +596,32 @@ void b2Body::SetActive(bool flag)
 			m_world->m_contactManager.Destroy(ce0->contact);
 		}
 		m_contactList = NULL;
+
+		m_world->RemoveFromIsland(this);
+	}
+}
+
+void b2Body::SetAwake(bool flag)
+{
+	if (flag)
+	{
+		if ((m_flags & e_awakeFlag) == 0)
+		{
+			m_flags |= e_awakeFlag;
+			m_sleepTime = 0.0f;
+			m_world->UpdateAwakeSet(this);
+		}
+
+		// The whole island is simulated with this body.
+		if (m_island && m_island->m_awake == false)
+		{
+			m_world->WakeIsland(m_island);
+		}
+	}
+	else
+	{
+		Sleep();
+		m_world->UpdateAwakeSet(this);
 	}
 }
 
@@ -490,10 +632,10 @@ void b2Body::Dump()
 	b2Log("{\n");
 	b2Log("  b2BodyDef bd;\n");
 	b2Log("  bd.type = b2BodyType(%d);\n", m_type);
-	b2Log("  bd.position.Set(%.15lef, %.15lef);\n", m_xf.p.x, m_xf.p.y);
-	b2Log("  bd.angle = %.15lef;\n", m_sweep.a);
-	b2Log("  bd.linearVelocity.Set(%.15lef, %.15lef);\n", m_linearVelocity.x, m_linearVelocity.y);
-	b2Log("  bd.angularVelocity = %.15lef;\n", m_angularVelocity);
+	b2Log("  bd.position.Set(%.15lef, %.15lef);\n", Transform().p.x, Transform().p.y);
+	b2Log("  bd.angle = %.15lef;\n", Sweep().a);
+	b2Log("  bd.linearVelocity.Set(%.15lef, %.15lef);\n", LinearVelocity().x, LinearVelocity().y);
+	b2Log("  bd.angularVelocity = %.15lef;\n", AngularVelocity());
 	b2Log("  bd.linearDamping = %.15lef;\n", m_linearDamping);
 	b2Log("  bd.angularDamping = %.15lef;\n", m_angularDamping);
 	b2Log("  bd.allowSleep = bool(%d);\n", m_flags & e_autoSleepFlag);
@@ -28,6 +28,7 @@ class b2Joint;
 class b2Contact;
 class b2Controller;
 class b2World;
+class b2PersistentIsland;
 struct b2FixtureDef;
 struct b2JointEdge;
 struct b2ContactEdge;
@@ -122,6 +123,22 @@ struct b2BodyDef
 	float32 gravityScale;
 };
 
+/// The hot simulation state of the bodies of a world in structure of arrays
+/// form. The world owns the arrays and b2Body::m_worldIndex indexes them, so
+/// the solver touches contiguous memory instead of the body objects.
+/// This is an internal struct.
+struct b2BodyStates
+{
+	b2Transform* transforms;
+	b2Sweep* sweeps;
+	b2Vec2* linearVelocities;
+	float32* angularVelocities;
+	b2Vec2* forces;
+	float32* torques;
+	float32* invMasses;
+	float32* invIs;
+};
+
 /// A rigid body. These are created via b2World::CreateBody.
 class b2Body
 {
@@ -162,21 +179,21 @@ public:
 
 	/// Get the body transform for the body's origin.
 	/// @return the world transform of the body's origin.
-	const b2Transform& GetTransform() const;
+	b2Transform GetTransform() const;
 
 	/// Get the world body origin position.
 	/// @return the world position of the body's origin.
-	const b2Vec2& GetPosition() const;
+	b2Vec2 GetPosition() const;
 
 	/// Get the angle in radians.
 	/// @return the current world rotation angle in radians.
 	float32 GetAngle() const;
 
 	/// Get the world position of the center of mass.
-	const b2Vec2& GetWorldCenter() const;
+	b2Vec2 GetWorldCenter() const;
 
 	/// Get the local position of the center of mass.
-	const b2Vec2& GetLocalCenter() const;
+	b2Vec2 GetLocalCenter() const;
 
 	/// Set the linear velocity of the center of mass.
 	/// @param v the new linear velocity of the center of mass.
@@ -382,9 +399,14 @@ private:
 
 	friend class b2World;
 	friend class b2Island;
+	friend class b2PersistentIsland;
 	friend class b2ContactManager;
 	friend class b2ContactSolver;
 	friend class b2Contact;
+	friend struct b2SolveIslandsTask;
+	friend struct b2SynchronizeFixturesTask;
+	friend struct b2FindTOIsTask;
+	friend class b2TreeJointSolver;
 
 	friend class b2DistanceJoint;
 	friend class b2GearJoint;
@@ -409,47 +431,85 @@ private:
 		e_toiFlag			= 0x0040
 	};
 
-	b2Body(const b2BodyDef* bd, b2World* world);
+	b2Body(const b2BodyDef* bd, b2World* world, int32 worldIndex);
 	~b2Body();
 
 	void SynchronizeFixtures();
 	void SynchronizeTransform();
 
+	// Find the smallest extent of the shapes, see b2World::SetIslandSubStepRatio.
+	void UpdateMinExtent();
+
+	// Put the body to sleep without updating the awake set of the world, so that
+	// islands can be solved concurrently. The world updates the set when it puts
+	// the island to sleep.
+	void Sleep();
+
+	// SynchronizeFixtures in two stages. ComputeFixtureAABBs doesn't modify the
+	// broad-phase, so different bodies can be computed concurrently. It returns
+	// true if MoveFixtureProxies has proxies to move.
+	bool ComputeFixtureAABBs();
+	void MoveFixtureProxies();
+
+	// The displacement by which the proxies reach ahead of the body.
+	b2Vec2 ComputeLookAhead(const b2Transform& xf1) const;
+
 	// This is used to prevent connected bodies from colliding.
 	// It may lie, depending on the collideConnected flag.
 	bool ShouldCollide(const b2Body* other) const;
 
 	void Advance(float32 t);
 
+	// Views of the state of this body in the arrays of the world. References are
+	// invalidated when a body is created or destroyed and when the world reorders
+	// its bodies.
+	b2Transform& Transform() const;
+	b2Sweep& Sweep() const;
+	b2Vec2& LinearVelocity() const;
+	float32& AngularVelocity() const;
+	b2Vec2& Force() const;
+	float32& Torque() const;
+	float32& InvMass() const;
+	float32& InvI() const;
+
 	b2BodyType m_type;
 
 	uint16 m_flags;
 
 	int32 m_islandIndex;
 
-	b2Transform m_xf;		// the body origin transform
-	b2Sweep m_sweep;		// the swept motion for CCD
-
-	b2Vec2 m_linearVelocity;
-	float32 m_angularVelocity;
-
-	b2Vec2 m_force;
-	float32 m_torque;
-
 	b2World* m_world;
 	b2Body* m_prev;
 	b2Body* m_next;
 
+	// The persistent island of this body and the island body list pointers. Only
+	// active dynamic and kinematic bodies belong to an island.
+	b2PersistentIsland* m_island;
+	b2Body* m_islandPrev;
+	b2Body* m_islandNext;
+
+	// Index in the awake body array of the world or -1. See b2World::UpdateAwakeSet.
+	int32 m_awakeIndex;
+
+	// Index in the body array of the world. This is also the slot of the body
+	// in the body states and the published transforms. It only changes outside
+	// of a time step.
+	int32 m_worldIndex;
+
+	// The transform, the swept motion for CCD, the velocity, the force and the
+	// inverse mass of the body live in the world arrays at m_worldIndex.
+	b2BodyStates* m_states;
+
 	b2Fixture* m_fixtureList;
 	int32 m_fixtureCount;
 
 	b2JointEdge* m_jointList;
 	b2ContactEdge* m_contactList;
 
-	float32 m_mass, m_invMass;
+	float32 m_mass;
 
 	// Rotational inertia about the center of mass.
-	float32 m_I, m_invI;
+	float32 m_I;
 
 	float32 m_linearDamping;
 	float32 m_angularDamping;
@@ -457,37 +517,80 @@ private:
 
 	float32 m_sleepTime;
 
+	// The smallest extent of the shapes, or b2_maxFloat without shapes.
+	float32 m_minExtent;
+
 	void* m_userData;
 };
 
+inline b2Transform& b2Body::Transform() const
+{
+	return m_states->transforms[m_worldIndex];
+}
+
+inline b2Sweep& b2Body::Sweep() const
+{
+	return m_states->sweeps[m_worldIndex];
+}
+
+inline b2Vec2& b2Body::LinearVelocity() const
+{
+	return m_states->linearVelocities[m_worldIndex];
+}
+
+inline float32& b2Body::AngularVelocity() const
+{
+	return m_states->angularVelocities[m_worldIndex];
+}
+
+inline b2Vec2& b2Body::Force() const
+{
+	return m_states->forces[m_worldIndex];
+}
+
+inline float32& b2Body::Torque() const
+{
+	return m_states->torques[m_worldIndex];
+}
+
+inline float32& b2Body::InvMass() const
+{
+	return m_states->invMasses[m_worldIndex];
+}
+
+inline float32& b2Body::InvI() const
+{
+	return m_states->invIs[m_worldIndex];
+}
+
 inline b2BodyType b2Body::GetType() const
 {
 	return m_type;
 }
 
-inline const b2Transform& b2Body::GetTransform() const
+inline b2Transform b2Body::GetTransform() const
 {
-	return m_xf;
+	return Transform();
 }
 
-inline const b2Vec2& b2Body::GetPosition() const
+inline b2Vec2 b2Body::GetPosition() const
 {
-	return m_xf.p;
+	return Transform().p;
 }
 
 inline float32 b2Body::GetAngle() const
 {
-	return m_sweep.a;
+	return Sweep().a;
 }
 
-inline const b2Vec2& b2Body::GetWorldCenter() const
+inline b2Vec2 b2Body::GetWorldCenter() const
 {
-	return m_sweep.c;
+	return Sweep().c;
 }
 
-inline const b2Vec2& b2Body::GetLocalCenter() const
+inline b2Vec2 b2Body::GetLocalCenter() const
 {
-	return m_sweep.localCenter;
+	return Sweep().localCenter;
 }
 
 inline void b2Body::SetLinearVelocity(const b2Vec2& v)
@@ -502,12 +605,12 @@ inline void b2Body::SetLinearVelocity(const b2Vec2& v)
 		SetAwake(true);
 	}
 
-	m_linearVelocity = v;
+	LinearVelocity() = v;
 }
 
 inline b2Vec2 b2Body::GetLinearVelocity() const
 {
-	return m_linearVelocity;
+	return LinearVelocity();
 }
 
 inline void b2Body::SetAngularVelocity(float32 w)
@@ -522,12 +625,12 @@ inline void b2Body::SetAngularVelocity(float32 w)
 		SetAwake(true);
 	}
 
-	m_angularVelocity = w;
+	AngularVelocity() = w;
 }
 
 inline float32 b2Body::GetAngularVelocity() const
 {
-	return m_angularVelocity;
+	return AngularVelocity();
 }
 
 inline float32 b2Body::GetMass() const
@@ -537,39 +640,39 @@ inline float32 b2Body::GetMass() const
 
 inline float32 b2Body::GetInertia() const
 {
-	return m_I + m_mass * b2Dot(m_sweep.localCenter, m_sweep.localCenter);
+	return m_I + m_mass * b2Dot(Sweep().localCenter, Sweep().localCenter);
 }
 
 inline void b2Body::GetMassData(b2MassData* data) const
 {
 	data->mass = m_mass;
-	data->I = m_I + m_mass * b2Dot(m_sweep.localCenter, m_sweep.localCenter);
-	data->center = m_sweep.localCenter;
+	data->I = m_I + m_mass * b2Dot(Sweep().localCenter, Sweep().localCenter);
+	data->center = Sweep().localCenter;
 }
 
 inline b2Vec2 b2Body::GetWorldPoint(const b2Vec2& localPoint) const
 {
-	return b2Mul(m_xf, localPoint);
+	return b2Mul(Transform(), localPoint);
 }
 
 inline b2Vec2 b2Body::GetWorldVector(const b2Vec2& localVector) const
 {
-	return b2Mul(m_xf.q, localVector);
+	return b2Mul(Transform().q, localVector);
 }
 
 inline b2Vec2 b2Body::GetLocalPoint(const b2Vec2& worldPoint) const
 {
-	return b2MulT(m_xf, worldPoint);
+	return b2MulT(Transform(), worldPoint);
 }
 
 inline b2Vec2 b2Body::GetLocalVector(const b2Vec2& worldVector) const
 {
-	return b2MulT(m_xf.q, worldVector);
+	return b2MulT(Transform().q, worldVector);
 }
 
 inline b2Vec2 b2Body::GetLinearVelocityFromWorldPoint(const b2Vec2& worldPoint) const
 {
-	return m_linearVelocity + b2Cross(m_angularVelocity, worldPoint - m_sweep.c);
+	return LinearVelocity() + b2Cross(AngularVelocity(), worldPoint - Sweep().c);
 }
 
 inline b2Vec2 b2Body::GetLinearVelocityFromLocalPoint(const b2Vec2& localPoint) const
@@ -624,25 +727,14 @@ inline bool b2Body::IsBullet() const
 	return (m_flags & e_bulletFlag) == e_bulletFlag;
 }
 
-inline void b2Body::SetAwake(bool flag)
+inline void b2Body::Sleep()
 {
-	if (flag)
-	{
-		if ((m_flags & e_awakeFlag) == 0)
-		{
-			m_flags |= e_awakeFlag;
-			m_sleepTime = 0.0f;
-		}
-	}
-	else
-	{
-		m_flags &= ~e_awakeFlag;
-		m_sleepTime = 0.0f;
-		m_linearVelocity.SetZero();
-		m_angularVelocity = 0.0f;
-		m_force.SetZero();
-		m_torque = 0.0f;
-	}
+	m_flags &= ~e_awakeFlag;
+	m_sleepTime = 0.0f;
+	LinearVelocity().SetZero();
+	AngularVelocity() = 0.0f;
+	Force().SetZero();
+	Torque() = 0.0f;
 }
 
 inline bool b2Body::IsAwake() const
@@ -754,8 +846,8 @@ inline void b2Body::ApplyForce(const b2Vec2& force, const b2Vec2& point)
 		SetAwake(true);
 	}
 
-	m_force += force;
-	m_torque += b2Cross(point - m_sweep.c, force);
+	Force() += force;
+	Torque() += b2Cross(point - Sweep().c, force);
 }
 
 inline void b2Body::ApplyForceToCenter(const b2Vec2& force)
@@ -770,7 +862,7 @@ inline void b2Body::ApplyForceToCenter(const b2Vec2& force)
 		SetAwake(true);
 	}
 
-	m_force += force;
+	Force() += force;
 }
 
 inline void b2Body::ApplyTorque(float32 torque)
@@ -785,7 +877,7 @@ inline void b2Body::ApplyTorque(float32 torque)
 		SetAwake(true);
 	}
 
-	m_torque += torque;
+	Torque() += torque;
 }
 
 inline void b2Body::ApplyLinearImpulse(const b2Vec2& impulse, const b2Vec2& point)
@@ -799,8 +891,8 @@ inline void b2Body::ApplyLinearImpulse(const b2Vec2& impulse, const b2Vec2& poin
 	{
 		SetAwake(true);
 	}
-	m_linearVelocity += m_invMass * impulse;
-	m_angularVelocity += m_invI * b2Cross(point - m_sweep.c, impulse);
+	LinearVelocity() += InvMass() * impulse;
+	AngularVelocity() += InvI() * b2Cross(point - Sweep().c, impulse);
 }
 
 inline void b2Body::ApplyAngularImpulse(float32 impulse)
@@ -814,23 +906,23 @@ inline void b2Body::ApplyAngularImpulse(float32 impulse)
 	{
 		SetAwake(true);
 	}
-	m_angularVelocity += m_invI * impulse;
+	AngularVelocity() += InvI() * impulse;
 }
 
 inline void b2Body::SynchronizeTransform()
 {
-	m_xf.q.Set(m_sweep.a);
-	m_xf.p = m_sweep.c - b2Mul(m_xf.q, m_sweep.localCenter);
+	Transform().q.Set(Sweep().a);
+	Transform().p = Sweep().c - b2Mul(Transform().q, Sweep().localCenter);
 }
 
 inline void b2Body::Advance(float32 alpha)
 {
 	// Advance to the new safe time. This doesn't sync the broad-phase.
-	m_sweep.Advance(alpha);
-	m_sweep.c = m_sweep.c0;
-	m_sweep.a = m_sweep.a0;
-	m_xf.q.Set(m_sweep.a);
-	m_xf.p = m_sweep.c - b2Mul(m_xf.q, m_sweep.localCenter);
+	Sweep().Advance(alpha);
+	Sweep().c = Sweep().c0;
+	Sweep().a = Sweep().a0;
+	Transform().q.Set(Sweep().a);
+	Transform().p = Sweep().c - b2Mul(Transform().q, Sweep().localCenter);
 }
 
 inline b2World* b2Body::GetWorld()
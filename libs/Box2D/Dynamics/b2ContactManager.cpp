@@ -19,12 +19,32 @@
 #include <Box2D/Dynamics/b2ContactManager.h>
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2Fixture.h>
+#include <Box2D/Dynamics/b2World.h>
 #include <Box2D/Dynamics/b2WorldCallbacks.h>
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
+#include <Box2D/Common/b2TaskScheduler.h>
+#include <cstring>
+#include <algorithm>
 
 b2ContactFilter b2_defaultFilter;
 b2ContactListener b2_defaultListener;
 
+// A contact manifold computed ahead of b2Contact::Update.
+struct b2ContactUpdate
+{
+	b2Contact* contact;
+	b2Manifold manifold;
+	bool touching;
+};
+
+// An update in the buffer and the number of contacts created after its contact,
+// which orders the contact list.
+struct b2ContactSortKey
+{
+	uint32 age;
+	int32 index;
+};
+
 b2ContactManager::b2ContactManager()
 {
 	m_contactList = NULL;
@@ -32,6 +52,31 @@ b2ContactManager::b2ContactManager()
 	m_contactFilter = &b2_defaultFilter;
 	m_contactListener = &b2_defaultListener;
 	m_allocator = NULL;
+	m_speculativeTime = 0.0f;
+	m_taskScheduler = NULL;
+	m_updateCapacity = 16;
+	m_updateBuffer = (b2ContactUpdate*)b2Alloc(m_updateCapacity * sizeof(b2ContactUpdate));
+	m_sortKeys = (b2ContactSortKey*)b2Alloc(2 * m_updateCapacity * sizeof(b2ContactSortKey));
+
+	m_awakeContactCapacity = 16;
+	m_awakeContactCount = 0;
+	m_awakeContacts = (b2Contact**)b2Alloc(m_awakeContactCapacity * sizeof(b2Contact*));
+	m_awakeSequences = (uint32*)b2Alloc(m_awakeContactCapacity * sizeof(uint32));
+	m_contactSequence = 0;
+
+	m_wokenContactCapacity = 16;
+	m_wokenContactCount = 0;
+	m_wokenContacts = (b2Contact**)b2Alloc(m_wokenContactCapacity * sizeof(b2Contact*));
+	m_collectWoken = false;
+}
+
+b2ContactManager::~b2ContactManager()
+{
+	b2Free(m_wokenContacts);
+	b2Free(m_awakeSequences);
+	b2Free(m_awakeContacts);
+	b2Free(m_sortKeys);
+	b2Free(m_updateBuffer);
 }
 
 void b2ContactManager::Destroy(b2Contact* c)
@@ -46,6 +91,8 @@ void b2ContactManager::Destroy(b2Contact* c)
 		m_contactListener->EndContact(c);
 	}
 
+	bodyA->GetWorld()->UnlinkContact(c);
+
 	// Remove from the world.
 	if (c->m_prev)
 	{
@@ -94,79 +141,319 @@ void b2ContactManager::Destroy(b2Contact* c)
 		bodyB->m_contactList = c->m_nodeB.next;
 	}
 
+	RemoveAwake(c);
+
 	// Call the factory.
 	b2Contact::Destroy(c, m_allocator);
 	--m_contactCount;
 }
 
+// The number of contacts handed to a thread at a time by Collide.
+const int32 b2_collideGrainSize = 64;
+
+// Computes contact manifolds for b2ContactManager::Collide on the task scheduler.
+struct b2CollideTask : public b2ParallelTask
+{
+	void Execute(int32 begin, int32 end, int32 threadIndex)
+	{
+		B2_NOT_USED(threadIndex);
+		contactManager->ComputeManifolds(updates, begin, end);
+	}
+
+	const b2ContactManager* contactManager;
+	b2ContactUpdate* updates;
+};
+
+void b2ContactManager::ComputeManifolds(b2ContactUpdate* updates, int32 begin, int32 end) const
+{
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2ContactUpdate* update = updates + i;
+		update->touching = update->contact->ComputeManifold(&update->manifold, m_speculativeTime);
+	}
+}
+
+// Orders contacts as in the contact list. The sequences are subtracted, so the
+// counter may wrap around.
+struct b2ContactListOrder
+{
+	bool operator()(const b2Contact* a, const b2Contact* b) const
+	{
+		return int32(a->m_sequence - b->m_sequence) > 0;
+	}
+};
+
+// Puts the contact that comes first in the contact list on top of a heap.
+struct b2WokenContactOrder
+{
+	bool operator()(const b2Contact* a, const b2Contact* b) const
+	{
+		return b2ContactListOrder()(b, a);
+	}
+};
+
+const b2ContactSortKey* b2ContactManager::SortUpdates(int32 count)
+{
+	// The age grows along the contact list, even when the sequence wraps around.
+	// The awake contacts are still in the order of the buffer here.
+	b2ContactSortKey* keys = m_sortKeys;
+	b2ContactSortKey* sorted = m_sortKeys + m_updateCapacity;
+	for (int32 i = 0; i < count; ++i)
+	{
+		keys[i].age = m_contactSequence - m_awakeSequences[i];
+		keys[i].index = i;
+	}
+
+	// Sort the keys by age, a byte per pass. A pass is skipped if all ages have
+	// the same byte, which is common for the high bytes.
+	for (uint32 shift = 0; shift < 32; shift += 8)
+	{
+		int32 offsets[256];
+		memset(offsets, 0, sizeof(offsets));
+		for (int32 i = 0; i < count; ++i)
+		{
+			++offsets[(keys[i].age >> shift) & 0xff];
+		}
+
+		if (count == 0 || offsets[(keys[0].age >> shift) & 0xff] == count)
+		{
+			continue;
+		}
+
+		int32 offset = 0;
+		for (int32 i = 0; i < 256; ++i)
+		{
+			int32 n = offsets[i];
+			offsets[i] = offset;
+			offset += n;
+		}
+
+		for (int32 i = 0; i < count; ++i)
+		{
+			sorted[offsets[(keys[i].age >> shift) & 0xff]++] = keys[i];
+		}
+
+		b2Swap(keys, sorted);
+	}
+
+	return keys;
+}
+
 // This is the top level collision call for the time step. Here
 // all the narrow phase collision is processed for the world
 // contact list.
 void b2ContactManager::Collide()
 {
-	// Update awake contacts.
-	b2Contact* c = m_contactList;
-	while (c)
-	{
-		b2Fixture* fixtureA = c->GetFixtureA();
-		b2Fixture* fixtureB = c->GetFixtureB();
-		int32 indexA = c->GetChildIndexA();
-		int32 indexB = c->GetChildIndexB();
-		b2Body* bodyA = fixtureA->GetBody();
-		b2Body* bodyB = fixtureB->GetBody();
-
-		// Is this contact flagged for filtering?
-		if (c->m_flags & b2Contact::e_filterFlag)
+	// Compute the manifolds of the awake contacts first. They don't depend on
+	// each other, so they can be computed concurrently. The manifolds of the
+	// contacts that are filtered or destroyed below go unused.
+	int32 updateCount = m_awakeContactCount;
+	if (m_updateCapacity < updateCount)
+	{
+		b2Free(m_updateBuffer);
+		b2Free(m_sortKeys);
+		m_updateCapacity = b2Max(updateCount, 2 * m_updateCapacity);
+		m_updateBuffer = (b2ContactUpdate*)b2Alloc(m_updateCapacity * sizeof(b2ContactUpdate));
+		m_sortKeys = (b2ContactSortKey*)b2Alloc(2 * m_updateCapacity * sizeof(b2ContactSortKey));
+	}
+
+	for (int32 i = 0; i < updateCount; ++i)
+	{
+		m_updateBuffer[i].contact = m_awakeContacts[i];
+	}
+
+	if (m_taskScheduler)
+	{
+		b2CollideTask task;
+		task.contactManager = this;
+		task.updates = m_updateBuffer;
+		m_taskScheduler->ParallelFor(&task, updateCount, b2_collideGrainSize);
+	}
+	else
+	{
+		ComputeManifolds(m_updateBuffer, 0, updateCount);
+	}
+
+	// Filter, destroy or update each contact in list order, so the callbacks are
+	// reported as by a walk over the contact list. Only the contact at hand is
+	// destroyed, so the others in the buffer stay valid. A contact that is woken
+	// along the way is visited in turn if it comes later in the list. Otherwise
+	// the walk has passed it and it waits for the next step.
+	const b2ContactSortKey* order = SortUpdates(updateCount);
+	m_wokenContactCount = 0;
+	m_collectWoken = true;
+
+	b2Contact* last = NULL;
+	int32 index = 0;
+	for (;;)
+	{
+		b2ContactUpdate* update = index < updateCount ? m_updateBuffer + order[index].index : NULL;
+		b2Contact* next = update ? update->contact : NULL;
+		if (m_wokenContactCount > 0)
 		{
-			// Should these bodies collide?
-			if (bodyB->ShouldCollide(bodyA) == false)
+			b2Contact* woken = m_wokenContacts[0];
+			if (next == NULL || b2ContactListOrder()(woken, next))
 			{
-				b2Contact* cNuke = c;
-				c = cNuke->GetNext();
-				Destroy(cNuke);
+				std::pop_heap(m_wokenContacts, m_wokenContacts + m_wokenContactCount, b2WokenContactOrder());
+				--m_wokenContactCount;
+
+				if (last && b2ContactListOrder()(last, woken) == false)
+				{
+					continue;
+				}
+
+				last = woken;
+				if (Filter(woken))
+				{
+					b2Manifold manifold;
+					bool touching = woken->ComputeManifold(&manifold, m_speculativeTime);
+					woken->Update(manifold, touching, m_contactListener);
+				}
 				continue;
 			}
+		}
 
-			// Check user filtering.
-			if (m_contactFilter && m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
-			{
-				b2Contact* cNuke = c;
-				c = cNuke->GetNext();
-				Destroy(cNuke);
-				continue;
-			}
+		if (next == NULL)
+		{
+			break;
+		}
 
-			// Clear the filtering flag.
-			c->m_flags &= ~b2Contact::e_filterFlag;
+		++index;
+
+		last = next;
+		if (Filter(next))
+		{
+			next->Update(update->manifold, update->touching, m_contactListener);
 		}
+	}
 
-		bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
-		bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
+	m_collectWoken = false;
+}
 
-		// At least one body must be awake and it must be dynamic or kinematic.
-		if (activeA == false && activeB == false)
+bool b2ContactManager::Filter(b2Contact* c)
+{
+	b2Fixture* fixtureA = c->GetFixtureA();
+	b2Fixture* fixtureB = c->GetFixtureB();
+	int32 indexA = c->GetChildIndexA();
+	int32 indexB = c->GetChildIndexB();
+	b2Body* bodyA = fixtureA->GetBody();
+	b2Body* bodyB = fixtureB->GetBody();
+
+	// Is this contact flagged for filtering?
+	if (c->m_flags & b2Contact::e_filterFlag)
+	{
+		// Should these bodies collide?
+		if (bodyB->ShouldCollide(bodyA) == false)
 		{
-			c = c->GetNext();
-			continue;
+			Destroy(c);
+			return false;
+		}
+
+		// Check user filtering.
+		if (m_contactFilter && m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
+		{
+			Destroy(c);
+			return false;
 		}
 
-		int32 proxyIdA = fixtureA->m_proxies[indexA].proxyId;
-		int32 proxyIdB = fixtureB->m_proxies[indexB].proxyId;
-		bool overlap = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
+		// Clear the filtering flag.
+		c->m_flags &= ~b2Contact::e_filterFlag;
+	}
+
+	bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
+	bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
+
+	// At least one body must be awake and it must be dynamic or kinematic.
+	if (activeA == false && activeB == false)
+	{
+		// The contact was only awake to be filtered.
+		RemoveAwake(c);
+		return false;
+	}
+
+	int32 proxyIdA = fixtureA->m_proxies[indexA].proxyId;
+	int32 proxyIdB = fixtureB->m_proxies[indexB].proxyId;
+	bool overlap = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
 
-		// Here we destroy contacts that cease to overlap in the broad-phase.
-		if (overlap == false)
+	// Here we destroy contacts that cease to overlap in the broad-phase.
+	if (overlap == false)
+	{
+		Destroy(c);
+		return false;
+	}
+
+	// The contact persists.
+	return true;
+}
+
+void b2ContactManager::UpdateAwakeSet(b2Contact* c)
+{
+	b2Body* bodyA = c->GetFixtureA()->GetBody();
+	b2Body* bodyB = c->GetFixtureB()->GetBody();
+	bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
+	bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
+	bool awake = activeA || activeB || (c->m_flags & b2Contact::e_filterFlag) != 0;
+
+	if (awake == false)
+	{
+		RemoveAwake(c);
+		return;
+	}
+
+	if (c->m_awakeIndex != -1)
+	{
+		return;
+	}
+
+	if (m_awakeContactCount == m_awakeContactCapacity)
+	{
+		b2Contact** oldContacts = m_awakeContacts;
+		uint32* oldSequences = m_awakeSequences;
+		m_awakeContactCapacity *= 2;
+		m_awakeContacts = (b2Contact**)b2Alloc(m_awakeContactCapacity * sizeof(b2Contact*));
+		m_awakeSequences = (uint32*)b2Alloc(m_awakeContactCapacity * sizeof(uint32));
+		memcpy(m_awakeContacts, oldContacts, m_awakeContactCount * sizeof(b2Contact*));
+		memcpy(m_awakeSequences, oldSequences, m_awakeContactCount * sizeof(uint32));
+		b2Free(oldContacts);
+		b2Free(oldSequences);
+	}
+
+	c->m_awakeIndex = m_awakeContactCount;
+	m_awakeContacts[m_awakeContactCount] = c;
+	m_awakeSequences[m_awakeContactCount] = c->m_sequence;
+	++m_awakeContactCount;
+
+	if (m_collectWoken)
+	{
+		if (m_wokenContactCount == m_wokenContactCapacity)
 		{
-			b2Contact* cNuke = c;
-			c = cNuke->GetNext();
-			Destroy(cNuke);
-			continue;
+			b2Contact** oldContacts = m_wokenContacts;
+			m_wokenContactCapacity *= 2;
+			m_wokenContacts = (b2Contact**)b2Alloc(m_wokenContactCapacity * sizeof(b2Contact*));
+			memcpy(m_wokenContacts, oldContacts, m_wokenContactCount * sizeof(b2Contact*));
+			b2Free(oldContacts);
 		}
 
-		// The contact persists.
-		c->Update(m_contactListener);
-		c = c->GetNext();
+		m_wokenContacts[m_wokenContactCount] = c;
+		++m_wokenContactCount;
+		std::push_heap(m_wokenContacts, m_wokenContacts + m_wokenContactCount, b2WokenContactOrder());
+	}
+}
+
+void b2ContactManager::RemoveAwake(b2Contact* c)
+{
+	int32 index = c->m_awakeIndex;
+	if (index == -1)
+	{
+		return;
 	}
+
+	b2Assert(m_awakeContacts[index] == c);
+	--m_awakeContactCount;
+	m_awakeContacts[index] = m_awakeContacts[m_awakeContactCount];
+	m_awakeSequences[index] = m_awakeSequences[m_awakeContactCount];
+	m_awakeContacts[index]->m_awakeIndex = index;
+	c->m_awakeIndex = -1;
 }
 
 void b2ContactManager::FindNewContacts()
@@ -251,6 +538,8 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 	bodyB = fixtureB->GetBody();
 
 	// Insert into the world.
+	c->m_sequence = m_contactSequence;
+	++m_contactSequence;
 	c->m_prev = NULL;
 	c->m_next = m_contactList;
 	if (m_contactList != NULL)
@@ -289,5 +578,7 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 	bodyA->SetAwake(true);
 	bodyB->SetAwake(true);
 
+	UpdateAwakeSet(c);
+
 	++m_contactCount;
 }
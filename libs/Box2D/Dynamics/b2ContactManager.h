@@ -25,12 +25,16 @@ class b2Contact;
 class b2ContactFilter;
 class b2ContactListener;
 class b2BlockAllocator;
+class b2TaskScheduler;
+struct b2ContactSortKey;
+struct b2ContactUpdate;
 
 // Delegate of b2World.
 class b2ContactManager
 {
 public:
 	b2ContactManager();
+	~b2ContactManager();
 
 	// Broad-phase callback.
 	void AddPair(void* proxyUserDataA, void* proxyUserDataB);
@@ -41,12 +45,60 @@ public:
 
 	void Collide();
 
+	// Destroy the contact if its bodies no longer collide or its proxies no
+	// longer overlap, or drop it from the awake contacts if it was only awake
+	// to be filtered. Returns true if the contact is to be updated.
+	bool Filter(b2Contact* c);
+
+	// Sort the first count updates in the order of the contact list. Returns the
+	// sorted keys, which index the update buffer.
+	const b2ContactSortKey* SortUpdates(int32 count);
+
+	// Compute the manifolds of updates [begin, end). This doesn't modify the
+	// contacts or bodies.
+	void ComputeManifolds(b2ContactUpdate* updates, int32 begin, int32 end) const;
+
+	// Add the contact to the awake contacts or remove it. A contact is awake if
+	// one of its bodies is awake and not static, or if it is flagged for filtering.
+	void UpdateAwakeSet(b2Contact* c);
+	void RemoveAwake(b2Contact* c);
+
 	b2BroadPhase m_broadPhase;
 	b2Contact* m_contactList;
 	int32 m_contactCount;
+
+	// The contacts visited by Collide and SolveTOI in no particular order. Their
+	// sequences are kept alongside, so they can be sorted without touching them.
+	b2Contact** m_awakeContacts;
+	uint32* m_awakeSequences;
+	int32 m_awakeContactCount;
+	int32 m_awakeContactCapacity;
+
+	// The sequence of the next contact, see b2Contact::m_sequence.
+	uint32 m_contactSequence;
+
+	// While m_collectWoken is set, contacts that become awake are kept in a heap
+	// ordered by the contact list, so Collide can visit them in turn.
+	b2Contact** m_wokenContacts;
+	int32 m_wokenContactCount;
+	int32 m_wokenContactCapacity;
+	bool m_collectWoken;
+
 	b2ContactFilter* m_contactFilter;
 	b2ContactListener* m_contactListener;
 	b2BlockAllocator* m_allocator;
+
+	// The length of the next time step if it uses speculative contacts, or zero.
+	float32 m_speculativeTime;
+
+	// When set, Collide computes the contact manifolds on the scheduler and then
+	// reports the results in order.
+	b2TaskScheduler* m_taskScheduler;
+	b2ContactUpdate* m_updateBuffer;
+
+	// Twice the update capacity, as the sort goes back and forth between halves.
+	b2ContactSortKey* m_sortKeys;
+	int32 m_updateCapacity;
 };
 
 #endif
@@ -123,14 +123,15 @@ void b2Fixture::CreateProxies(b2BroadPhase* broadPhase, const b2Transform& xf)
 {
 	b2Assert(m_proxyCount == 0);
 
-	// Create proxies in the broad-phase.
+	// Create proxies in the broad-phase tree of the body type.
 	m_proxyCount = m_shape->GetChildCount();
+	int32 tree = int32(m_body->GetType());
 
 	for (int32 i = 0; i < m_proxyCount; ++i)
 	{
 		b2FixtureProxy* proxy = m_proxies + i;
 		m_shape->ComputeAABB(&proxy->aabb, xf, i);
-		proxy->proxyId = broadPhase->CreateProxy(proxy->aabb, proxy);
+		proxy->proxyId = broadPhase->CreateProxy(proxy->aabb, proxy, tree);
 		proxy->fixture = this;
 		proxy->childIndex = i;
 	}
@@ -149,7 +150,7 @@ void b2Fixture::DestroyProxies(b2BroadPhase* broadPhase)
 	m_proxyCount = 0;
 }
 
-void b2Fixture::Synchronize(b2BroadPhase* broadPhase, const b2Transform& transform1, const b2Transform& transform2)
+void b2Fixture::Synchronize(b2BroadPhase* broadPhase, const b2Transform& transform1, const b2Transform& transform2, const b2Vec2& ahead)
 {
 	if (m_proxyCount == 0)
 	{
@@ -166,6 +167,8 @@ void b2Fixture::Synchronize(b2BroadPhase* broadPhase, const b2Transform& transfo
 		m_shape->ComputeAABB(&aabb2, transform2, proxy->childIndex);
 
 		proxy->aabb.Combine(aabb1, aabb2);
+		proxy->aabb.lowerBound = b2Min(proxy->aabb.lowerBound, aabb2.lowerBound + ahead);
+		proxy->aabb.upperBound = b2Max(proxy->aabb.upperBound, aabb2.upperBound + ahead);
 
 		b2Vec2 displacement = transform2.p - transform1.p;
 
@@ -173,6 +176,40 @@ void b2Fixture::Synchronize(b2BroadPhase* broadPhase, const b2Transform& transfo
 	}
 }
 
+bool b2Fixture::ComputeProxyAABBs(const b2BroadPhase* broadPhase, const b2Transform& transform1, const b2Transform& transform2, const b2Vec2& ahead)
+{
+	bool move = false;
+	for (int32 i = 0; i < m_proxyCount; ++i)
+	{
+		b2FixtureProxy* proxy = m_proxies + i;
+
+		// Compute an AABB that covers the swept shape (may miss some rotation effect).
+		b2AABB aabb1, aabb2;
+		m_shape->ComputeAABB(&aabb1, transform1, proxy->childIndex);
+		m_shape->ComputeAABB(&aabb2, transform2, proxy->childIndex);
+
+		proxy->aabb.Combine(aabb1, aabb2);
+		proxy->aabb.lowerBound = b2Min(proxy->aabb.lowerBound, aabb2.lowerBound + ahead);
+		proxy->aabb.upperBound = b2Max(proxy->aabb.upperBound, aabb2.upperBound + ahead);
+
+		if (broadPhase->GetFatAABB(proxy->proxyId).Contains(proxy->aabb) == false)
+		{
+			move = true;
+		}
+	}
+
+	return move;
+}
+
+void b2Fixture::MoveProxies(b2BroadPhase* broadPhase, const b2Vec2& displacement)
+{
+	for (int32 i = 0; i < m_proxyCount; ++i)
+	{
+		b2FixtureProxy* proxy = m_proxies + i;
+		broadPhase->MoveProxy(proxy->proxyId, proxy->aabb, displacement);
+	}
+}
+
 void b2Fixture::SetFilterData(const b2Filter& filter)
 {
 	m_filter = filter;
@@ -213,7 +213,14 @@ protected:
 	void CreateProxies(b2BroadPhase* broadPhase, const b2Transform& xf);
 	void DestroyProxies(b2BroadPhase* broadPhase);
 
-	void Synchronize(b2BroadPhase* broadPhase, const b2Transform& xf1, const b2Transform& xf2);
+	// The proxies also cover the shape at xf2 moved by ahead, so speculative
+	// contacts find the pairs of the next step.
+	void Synchronize(b2BroadPhase* broadPhase, const b2Transform& xf1, const b2Transform& xf2, const b2Vec2& ahead);
+
+	// Synchronize in two stages. ComputeProxyAABBs only reads the broad-phase and
+	// returns true if a proxy left its fat AABB. MoveProxies applies the AABBs.
+	bool ComputeProxyAABBs(const b2BroadPhase* broadPhase, const b2Transform& xf1, const b2Transform& xf2, const b2Vec2& ahead);
+	void MoveProxies(b2BroadPhase* broadPhase, const b2Vec2& displacement);
 
 	float32 m_density;
 
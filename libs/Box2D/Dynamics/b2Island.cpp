@@ -24,7 +24,9 @@
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
 #include <Box2D/Dynamics/Contacts/b2ContactSolver.h>
 #include <Box2D/Dynamics/Joints/b2Joint.h>
+#include <Box2D/Dynamics/Joints/b2TreeJointSolver.h>
 #include <Box2D/Common/b2StackAllocator.h>
+#include <Box2D/Common/b2TaskScheduler.h>
 #include <Box2D/Common/b2Timer.h>
 
 /*
@@ -150,7 +152,8 @@ b2Island::b2Island(
 	int32 contactCapacity,
 	int32 jointCapacity,
 	b2StackAllocator* allocator,
-	b2ContactListener* listener)
+	b2ContactListener* listener,
+	int32 staticSlotCount)
 {
 	m_bodyCapacity = bodyCapacity;
 	m_contactCapacity = contactCapacity;
@@ -158,29 +161,106 @@ b2Island::b2Island(
 	m_bodyCount = 0;
 	m_contactCount = 0;
 	m_jointCount = 0;
+	m_staticSlotCount = staticSlotCount;
 
 	m_allocator = allocator;
 	m_listener = listener;
+	m_impulses = NULL;
+	m_graphColoring = false;
+	m_simdContactSolver = false;
+	m_softStepCount = 0;
+	m_subStepRatio = 0.0f;
+	m_subStepCount = 1;
+	m_velocityTolerance = 0.0f;
+	m_velocityIterationCount = 0;
+	m_treeJointSolver = false;
+	m_taskScheduler = NULL;
 
 	m_bodies = (b2Body**)m_allocator->Allocate(bodyCapacity * sizeof(b2Body*));
 	m_contacts = (b2Contact**)m_allocator->Allocate(contactCapacity	 * sizeof(b2Contact*));
 	m_joints = (b2Joint**)m_allocator->Allocate(jointCapacity * sizeof(b2Joint*));
 
-	m_velocities = (b2Velocity*)m_allocator->Allocate(m_bodyCapacity * sizeof(b2Velocity));
-	m_positions = (b2Position*)m_allocator->Allocate(m_bodyCapacity * sizeof(b2Position));
+	m_solverVelocities = (b2Velocity*)m_allocator->Allocate((m_staticSlotCount + m_bodyCapacity) * sizeof(b2Velocity));
+	m_solverPositions = (b2Position*)m_allocator->Allocate((m_staticSlotCount + m_bodyCapacity) * sizeof(b2Position));
+	m_velocities = m_solverVelocities + m_staticSlotCount;
+	m_positions = m_solverPositions + m_staticSlotCount;
 }
 
 b2Island::~b2Island()
 {
 	// Warning: the order should reverse the constructor order.
-	m_allocator->Free(m_positions);
-	m_allocator->Free(m_velocities);
+	m_allocator->Free(m_solverPositions);
+	m_allocator->Free(m_solverVelocities);
 	m_allocator->Free(m_joints);
 	m_allocator->Free(m_contacts);
 	m_allocator->Free(m_bodies);
 }
 
 void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep)
+{
+	if (m_softStepCount > 0)
+	{
+		SolveSoft(profile, step, gravity, allowSleep);
+		return;
+	}
+
+	int32 subStepCount = ComputeSubStepCount(step);
+
+	// The impulses are warm started from the last substep of the previous step.
+	b2TimeStep subStep = step;
+	subStep.dt = step.dt / subStepCount;
+	subStep.inv_dt = step.inv_dt * subStepCount;
+	subStep.dtRatio = step.dtRatio * m_subStepCount / subStepCount;
+
+	profile->solveInit = 0.0f;
+	profile->solveVelocity = 0.0f;
+	profile->solvePosition = 0.0f;
+	m_velocityIterationCount = 0;
+
+	bool positionSolved = false;
+	for (int32 i = 0; i < subStepCount; ++i)
+	{
+		bool first = i == 0;
+		bool last = i == subStepCount - 1;
+		positionSolved = SolveStep(profile, subStep, gravity, first, last);
+		subStep.dtRatio = 1.0f;
+	}
+
+	m_subStepCount = subStepCount;
+
+	if (allowSleep)
+	{
+		UpdateSleep(step.dt, positionSolved);
+	}
+}
+
+int32 b2Island::ComputeSubStepCount(const b2TimeStep& step) const
+{
+	if (m_subStepRatio == 0.0f)
+	{
+		return 1;
+	}
+
+	// The motion of a body in a step is the distance it moves relative to its
+	// smallest shape extent plus the angle it turns.
+	float32 maxMotion = 0.0f;
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		const b2Body* b = m_bodies[i];
+		if (b->m_type == b2_staticBody)
+		{
+			continue;
+		}
+
+		float32 motion = step.dt * (b->LinearVelocity().Length() / b->m_minExtent + b2Abs(b->AngularVelocity()));
+		maxMotion = b2Max(maxMotion, motion);
+	}
+
+	float32 count = b2Min(maxMotion / m_subStepRatio, float32(b2_maxIslandSubSteps));
+	return b2Min(1 + int32(count), b2_maxIslandSubSteps);
+}
+
+bool b2Island::SolveStep(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool first, bool last)
 {
 	b2Timer timer;
 
@@ -190,21 +270,37 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	for (int32 i = 0; i < m_bodyCount; ++i)
 	{
 		b2Body* b = m_bodies[i];
+		b2Sweep& sweep = b->Sweep();
 
-		b2Vec2 c = b->m_sweep.c;
-		float32 a = b->m_sweep.a;
-		b2Vec2 v = b->m_linearVelocity;
-		float32 w = b->m_angularVelocity;
+		b2Vec2 c = sweep.c;
+		float32 a = sweep.a;
+		b2Vec2 v = b->LinearVelocity();
+		float32 w = b->AngularVelocity();
 
-		// Store positions for continuous collision.
-		b->m_sweep.c0 = b->m_sweep.c;
-		b->m_sweep.a0 = b->m_sweep.a;
+		if (b->m_islandIndex != m_staticSlotCount + i)
+		{
+			// Shared static body.
+			m_positions[i].c = c;
+			m_positions[i].a = a;
+			m_velocities[i].v = v;
+			m_velocities[i].w = w;
+			m_solverPositions[b->m_islandIndex] = m_positions[i];
+			m_solverVelocities[b->m_islandIndex] = m_velocities[i];
+			continue;
+		}
+
+		if (first)
+		{
+			// Store positions for continuous collision.
+			sweep.c0 = c;
+			sweep.a0 = a;
+		}
 
 		if (b->m_type == b2_dynamicBody)
 		{
 			// Integrate velocities.
-			v += h * (b->m_gravityScale * gravity + b->m_invMass * b->m_force);
-			w += h * b->m_invI * b->m_torque;
+			v += h * (b->m_gravityScale * gravity + b->InvMass() * b->Force());
+			w += h * b->InvI() * b->Torque();
 
 			// Apply damping.
 			// ODE: dv/dt + c * v = 0
@@ -228,48 +324,88 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	// Solver data
 	b2SolverData solverData;
 	solverData.step = step;
-	solverData.positions = m_positions;
-	solverData.velocities = m_velocities;
+	solverData.positions = m_solverPositions;
+	solverData.velocities = m_solverVelocities;
+
+	// The joints that form trees are moved to the end and left out of m_jointCount
+	// until the constraints are solved.
+	b2TreeJointSolverDef treeSolverDef;
+	treeSolverDef.joints = m_joints;
+	treeSolverDef.count = m_treeJointSolver ? m_jointCount : 0;
+	treeSolverDef.bodies = m_bodies;
+	treeSolverDef.bodyCount = m_bodyCount;
+	treeSolverDef.staticSlotCount = m_staticSlotCount;
+	treeSolverDef.allocator = m_allocator;
+
+	b2TreeJointSolver treeSolver(&treeSolverDef);
+	m_jointCount -= treeSolver.m_count;
+
+	// Large islands may be solved by color instead of sequentially.
+	bool colored = m_graphColoring && m_contactCount + m_jointCount >= b2_minColoredConstraints;
 
 	// Initialize velocity constraints.
 	b2ContactSolverDef contactSolverDef;
 	contactSolverDef.step = step;
 	contactSolverDef.contacts = m_contacts;
 	contactSolverDef.count = m_contactCount;
-	contactSolverDef.positions = m_positions;
-	contactSolverDef.velocities = m_velocities;
+	contactSolverDef.positions = m_solverPositions;
+	contactSolverDef.velocities = m_solverVelocities;
+	contactSolverDef.bodyCount = m_staticSlotCount + m_bodyCount;
 	contactSolverDef.allocator = m_allocator;
+	contactSolverDef.simd = m_simdContactSolver && colored == false;
 
 	b2ContactSolver contactSolver(&contactSolverDef);
 	contactSolver.InitializeVelocityConstraints();
 
-	if (step.warmStarting)
+	b2GraphColors colors;
+	if (colored)
 	{
-		contactSolver.WarmStart();
+		ColorConstraints(&colors);
 	}
 
-	for (int32 i = 0; i < m_jointCount; ++i)
+	if (step.warmStarting)
 	{
-		m_joints[i]->InitVelocityConstraints(solverData);
+		contactSolver.WarmStart();
 	}
 
-	profile->solveInit = timer.GetMilliseconds();
+	b2Joint::InitVelocityConstraints(m_joints, m_jointCount + treeSolver.m_count, solverData);
+	treeSolver.InitVelocityConstraints(solverData);
+
+	profile->solveInit += timer.GetMilliseconds();
 
 	// Solve velocity constraints
 	timer.Reset();
 	for (int32 i = 0; i < step.velocityIterations; ++i)
 	{
-		for (int32 j = 0; j < m_jointCount; ++j)
+		++m_velocityIterationCount;
+
+		bool velocitySolved;
+		if (colored)
 		{
-			m_joints[j]->SolveVelocityConstraints(solverData);
+			velocitySolved = SolveColors(&colors, &contactSolver, solverData, e_velocityStage);
+		}
+		else
+		{
+			float32 maxDelta = b2Joint::SolveVelocityConstraints(m_joints, m_jointCount, solverData);
+			float32 delta = contactSolver.SolveVelocityConstraints();
+			maxDelta = b2Max(maxDelta, delta);
+			velocitySolved = maxDelta <= m_velocityTolerance;
 		}
 
-		contactSolver.SolveVelocityConstraints();
+		// The tree joints go last, so they hold exactly after each pass.
+		float32 treeDelta = treeSolver.SolveVelocityConstraints(solverData, true);
+		velocitySolved = velocitySolved && treeDelta <= m_velocityTolerance;
+
+		if (velocitySolved)
+		{
+			// Exit early if the impulses have settled.
+			break;
+		}
 	}
 
 	// Store impulses for warm starting
 	contactSolver.StoreImpulses();
-	profile->solveVelocity = timer.GetMilliseconds();
+	profile->solveVelocity += timer.GetMilliseconds();
 
 	// Integrate positions
 	for (int32 i = 0; i < m_bodyCount; ++i)
@@ -304,21 +440,36 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		m_velocities[i].w = w;
 	}
 
+	// The speculative points that hit bounce once the bodies have moved up to
+	// the contact.
+	if (contactSolver.m_speculative)
+	{
+		contactSolver.ApplyRestitution();
+	}
+
 	// Solve position constraints
 	timer.Reset();
 	bool positionSolved = false;
 	for (int32 i = 0; i < step.positionIterations; ++i)
 	{
-		bool contactsOkay = contactSolver.SolvePositionConstraints();
-
-		bool jointsOkay = true;
-		for (int32 i = 0; i < m_jointCount; ++i)
+		bool constraintsOkay;
+		if (colored)
 		{
-			bool jointOkay = m_joints[i]->SolvePositionConstraints(solverData);
-			jointsOkay = jointsOkay && jointOkay;
+			constraintsOkay = SolveColors(&colors, &contactSolver, solverData, e_positionStage);
 		}
+		else
+		{
+			bool contactsOkay = contactSolver.SolvePositionConstraints();
+
+			bool jointsOkay = b2Joint::SolvePositionConstraints(m_joints, m_jointCount, solverData);
 
-		if (contactsOkay && jointsOkay)
+			constraintsOkay = contactsOkay && jointsOkay;
+		}
+
+		// The tree joints correct their position errors like the other joints.
+		bool treeOkay = b2Joint::SolvePositionConstraints(m_joints + m_jointCount, treeSolver.m_count, solverData);
+
+		if (constraintsOkay && treeOkay)
 		{
 			// Exit early if the position errors are small.
 			positionSolved = true;
@@ -326,61 +477,538 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		}
 	}
 
+	if (colored)
+	{
+		m_allocator->Free(colors.contactOrder);
+	}
+
+	m_jointCount += treeSolver.m_count;
+
 	// Copy state buffers back to the bodies
 	for (int32 i = 0; i < m_bodyCount; ++i)
 	{
 		b2Body* body = m_bodies[i];
-		body->m_sweep.c = m_positions[i].c;
-		body->m_sweep.a = m_positions[i].a;
-		body->m_linearVelocity = m_velocities[i].v;
-		body->m_angularVelocity = m_velocities[i].w;
+		if (body->m_islandIndex != m_staticSlotCount + i)
+		{
+			// Shared static bodies don't move and belong to no single island.
+			continue;
+		}
+
+		b2Sweep& sweep = body->Sweep();
+		sweep.c = m_positions[i].c;
+		sweep.a = m_positions[i].a;
+		body->LinearVelocity() = m_velocities[i].v;
+		body->AngularVelocity() = m_velocities[i].w;
 		body->SynchronizeTransform();
 	}
 
-	profile->solvePosition = timer.GetMilliseconds();
+	profile->solvePosition += timer.GetMilliseconds();
 
-	Report(contactSolver.m_velocityConstraints);
+	if (last)
+	{
+		Report(contactSolver.m_velocityConstraints);
+	}
 
-	if (allowSleep)
+	return positionSolved;
+}
+
+void b2Island::SolveSoft(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep)
+{
+	b2Timer timer;
+
+	int32 subStepCount = m_softStepCount;
+	float32 h = step.dt / subStepCount;
+	m_velocityIterationCount = subStepCount;
+
+	// Initialize the body state. The velocities are integrated in each substep.
+	for (int32 i = 0; i < m_bodyCount; ++i)
 	{
-		float32 minSleepTime = b2_maxFloat;
+		b2Body* b = m_bodies[i];
+		b2Sweep& sweep = b->Sweep();
 
-		const float32 linTolSqr = b2_linearSleepTolerance * b2_linearSleepTolerance;
-		const float32 angTolSqr = b2_angularSleepTolerance * b2_angularSleepTolerance;
+		m_positions[i].c = sweep.c;
+		m_positions[i].a = sweep.a;
+		m_velocities[i].v = b->LinearVelocity();
+		m_velocities[i].w = b->AngularVelocity();
 
-		for (int32 i = 0; i < m_bodyCount; ++i)
+		if (b->m_islandIndex != m_staticSlotCount + i)
 		{
-			b2Body* b = m_bodies[i];
-			if (b->GetType() == b2_staticBody)
+			// Shared static body.
+			m_solverPositions[b->m_islandIndex] = m_positions[i];
+			m_solverVelocities[b->m_islandIndex] = m_velocities[i];
+			continue;
+		}
+
+		// Store positions for continuous collision.
+		sweep.c0 = sweep.c;
+		sweep.a0 = sweep.a;
+	}
+
+	timer.Reset();
+
+	// The joints are solved with the substep. Their impulses carry over from one
+	// substep to the next.
+	b2SolverData solverData;
+	solverData.step = step;
+	solverData.step.dt = h;
+	solverData.step.inv_dt = subStepCount * step.inv_dt;
+	solverData.positions = m_solverPositions;
+	solverData.velocities = m_solverVelocities;
+
+	// See Solve.
+	b2TreeJointSolverDef treeSolverDef;
+	treeSolverDef.joints = m_joints;
+	treeSolverDef.count = m_treeJointSolver ? m_jointCount : 0;
+	treeSolverDef.bodies = m_bodies;
+	treeSolverDef.bodyCount = m_bodyCount;
+	treeSolverDef.staticSlotCount = m_staticSlotCount;
+	treeSolverDef.allocator = m_allocator;
+
+	b2TreeJointSolver treeSolver(&treeSolverDef);
+	m_jointCount -= treeSolver.m_count;
+
+	bool colored = m_graphColoring && m_contactCount + m_jointCount >= b2_minColoredConstraints;
+
+	// The contact impulses are scaled for warm starting with the ratio of the steps.
+	b2ContactSolverDef contactSolverDef;
+	contactSolverDef.step = step;
+	contactSolverDef.contacts = m_contacts;
+	contactSolverDef.count = m_contactCount;
+	contactSolverDef.positions = m_solverPositions;
+	contactSolverDef.velocities = m_solverVelocities;
+	contactSolverDef.bodyCount = m_staticSlotCount + m_bodyCount;
+	contactSolverDef.allocator = m_allocator;
+	contactSolverDef.simd = false;
+
+	b2ContactSolver contactSolver(&contactSolverDef);
+	contactSolver.InitializeVelocityConstraints();
+	contactSolver.InitializeSoftConstraints(h);
+
+	b2GraphColors colors;
+	if (colored)
+	{
+		ColorConstraints(&colors);
+	}
+
+	profile->solveInit = timer.GetMilliseconds();
+
+	timer.Reset();
+	for (int32 i = 0; i < subStepCount; ++i)
+	{
+		// Integrate velocities and apply damping.
+		for (int32 j = 0; j < m_bodyCount; ++j)
+		{
+			b2Body* b = m_bodies[j];
+			if (b->m_type != b2_dynamicBody)
 			{
 				continue;
 			}
 
-			if ((b->m_flags & b2Body::e_autoSleepFlag) == 0 ||
-				b->m_angularVelocity * b->m_angularVelocity > angTolSqr ||
-				b2Dot(b->m_linearVelocity, b->m_linearVelocity) > linTolSqr)
+			b2Vec2 v = m_velocities[j].v;
+			float32 w = m_velocities[j].w;
+
+			v += h * (b->m_gravityScale * gravity + b->InvMass() * b->Force());
+			w += h * b->InvI() * b->Torque();
+
+			// See Solve.
+			v *= b2Clamp(1.0f - h * b->m_linearDamping, 0.0f, 1.0f);
+			w *= b2Clamp(1.0f - h * b->m_angularDamping, 0.0f, 1.0f);
+
+			m_velocities[j].v = v;
+			m_velocities[j].w = w;
+		}
+
+		// The joints warm start when they are initialized.
+		contactSolver.WarmStart();
+		b2Joint::InitVelocityConstraints(m_joints, m_jointCount + treeSolver.m_count, solverData);
+		treeSolver.InitVelocityConstraints(solverData);
+
+		solverData.step.dtRatio = 1.0f;
+		solverData.step.warmStarting = true;
+
+		if (colored)
+		{
+			SolveColors(&colors, &contactSolver, solverData, e_softStage);
+		}
+		else
+		{
+			b2Joint::SolveVelocityConstraints(m_joints, m_jointCount, solverData);
+			contactSolver.SolveSoftConstraints(true);
+		}
+		treeSolver.SolveVelocityConstraints(solverData, true);
+
+		// Integrate positions. The velocity is limited like in Solve.
+		for (int32 j = 0; j < m_bodyCount; ++j)
+		{
+			b2Vec2 v = m_velocities[j].v;
+			float32 w = m_velocities[j].w;
+
+			b2Vec2 translation = step.dt * v;
+			if (b2Dot(translation, translation) > b2_maxTranslationSquared)
+			{
+				float32 ratio = b2_maxTranslation / translation.Length();
+				v *= ratio;
+			}
+
+			float32 rotation = step.dt * w;
+			if (rotation * rotation > b2_maxRotationSquared)
 			{
-				b->m_sleepTime = 0.0f;
-				minSleepTime = 0.0f;
+				float32 ratio = b2_maxRotation / b2Abs(rotation);
+				w *= ratio;
 			}
-			else
+
+			m_positions[j].c += h * v;
+			m_positions[j].a += h * w;
+			m_velocities[j].v = v;
+			m_velocities[j].w = w;
+		}
+
+		// Remove the velocity added by the bias.
+		if (colored)
+		{
+			SolveColors(&colors, &contactSolver, solverData, e_relaxStage);
+		}
+		else
+		{
+			b2Joint::SolveVelocityConstraints(m_joints, m_jointCount, solverData);
+			contactSolver.SolveSoftConstraints(false);
+		}
+		treeSolver.SolveVelocityConstraints(solverData, false);
+	}
+
+	contactSolver.ApplyRestitution();
+	contactSolver.StoreImpulses();
+	profile->solveVelocity = timer.GetMilliseconds();
+
+	// The soft bias keeps the contacts apart, but the joints drift.
+	timer.Reset();
+	bool positionSolved = true;
+	if (m_jointCount + treeSolver.m_count > 0)
+	{
+		positionSolved = false;
+		for (int32 i = 0; i < step.positionIterations; ++i)
+		{
+			bool jointsOkay = b2Joint::SolvePositionConstraints(m_joints, m_jointCount + treeSolver.m_count, solverData);
+			if (jointsOkay)
 			{
-				b->m_sleepTime += h;
-				minSleepTime = b2Min(minSleepTime, b->m_sleepTime);
+				positionSolved = true;
+				break;
 			}
 		}
+	}
+
+	if (colored)
+	{
+		m_allocator->Free(colors.contactOrder);
+	}
+
+	m_jointCount += treeSolver.m_count;
+
+	// Copy state buffers back to the bodies
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		b2Body* body = m_bodies[i];
+		if (body->m_islandIndex != m_staticSlotCount + i)
+		{
+			// Shared static bodies don't move and belong to no single island.
+			continue;
+		}
+
+		b2Sweep& sweep = body->Sweep();
+		sweep.c = m_positions[i].c;
+		sweep.a = m_positions[i].a;
+		body->LinearVelocity() = m_velocities[i].v;
+		body->AngularVelocity() = m_velocities[i].w;
+		body->SynchronizeTransform();
+	}
+
+	profile->solvePosition = timer.GetMilliseconds();
+
+	Report(contactSolver.m_velocityConstraints);
+
+	if (allowSleep)
+	{
+		UpdateSleep(step.dt, positionSolved);
+	}
+}
+
+void b2Island::UpdateSleep(float32 h, bool positionSolved)
+{
+	float32 minSleepTime = b2_maxFloat;
+
+	const float32 linTolSqr = b2_linearSleepTolerance * b2_linearSleepTolerance;
+	const float32 angTolSqr = b2_angularSleepTolerance * b2_angularSleepTolerance;
+
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		b2Body* b = m_bodies[i];
+		if (b->GetType() == b2_staticBody)
+		{
+			continue;
+		}
 
-		if (minSleepTime >= b2_timeToSleep && positionSolved)
+		float32 w = b->AngularVelocity();
+		const b2Vec2& v = b->LinearVelocity();
+		if ((b->m_flags & b2Body::e_autoSleepFlag) == 0 ||
+			w * w > angTolSqr ||
+			b2Dot(v, v) > linTolSqr)
 		{
-			for (int32 i = 0; i < m_bodyCount; ++i)
+			b->m_sleepTime = 0.0f;
+			minSleepTime = 0.0f;
+		}
+		else
+		{
+			b->m_sleepTime += h;
+			minSleepTime = b2Min(minSleepTime, b->m_sleepTime);
+		}
+	}
+
+	if (minSleepTime >= b2_timeToSleep && positionSolved)
+	{
+		for (int32 i = 0; i < m_bodyCount; ++i)
+		{
+			b2Body* b = m_bodies[i];
+			if (b->m_islandIndex != m_staticSlotCount + i)
 			{
-				b2Body* b = m_bodies[i];
-				b->SetAwake(false);
+				// The world settles the sleep state of shared static bodies.
+				continue;
 			}
+
+			// The world updates its awake set when it puts the island to sleep.
+			b->Sleep();
 		}
 	}
 }
 
+// Give a constraint the first color that none of its dynamic bodies uses. A body
+// index of -1 stands for a static or kinematic body. Returns the group of the
+// constraint, where group 0 is solved sequentially.
+static int32 b2AssignColor(uint32* bodyColors, int32 indexA, int32 indexB)
+{
+	uint32 used = 0;
+	if (indexA != -1)
+	{
+		used |= bodyColors[indexA];
+	}
+	if (indexB != -1)
+	{
+		used |= bodyColors[indexB];
+	}
+
+	for (int32 i = 0; i < b2_graphColorCount; ++i)
+	{
+		uint32 bit = 1u << i;
+		if (used & bit)
+		{
+			continue;
+		}
+
+		if (indexA != -1)
+		{
+			bodyColors[indexA] |= bit;
+		}
+		if (indexB != -1)
+		{
+			bodyColors[indexB] |= bit;
+		}
+		return i + 1;
+	}
+
+	return 0;
+}
+
+// Sort the indices [0, count) by group, keeping the order within a group.
+static void b2SortByGroup(int32* order, int32* start, const int32* groups, int32 count)
+{
+	for (int32 i = 0; i < b2_graphColorCount + 2; ++i)
+	{
+		start[i] = 0;
+	}
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		++start[groups[i] + 1];
+	}
+
+	for (int32 i = 1; i < b2_graphColorCount + 2; ++i)
+	{
+		start[i] += start[i - 1];
+	}
+
+	int32 next[b2_graphColorCount + 1];
+	for (int32 i = 0; i < b2_graphColorCount + 1; ++i)
+	{
+		next[i] = start[i];
+	}
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		order[next[groups[i]]++] = i;
+	}
+}
+
+void b2Island::ColorConstraints(b2GraphColors* colors)
+{
+	colors->contactOrder = (int32*)m_allocator->Allocate(m_contactCount * sizeof(int32));
+
+	uint32* bodyColors = (uint32*)m_allocator->Allocate(m_bodyCount * sizeof(uint32));
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		bodyColors[i] = 0;
+	}
+
+	int32* groups = (int32*)m_allocator->Allocate(b2Max(m_jointCount, m_contactCount) * sizeof(int32));
+
+	// Color the joints first so they are spread over the colors. Joints solved
+	// concurrently must only write dynamic bodies of this island.
+	for (int32 i = 0; i < m_jointCount; ++i)
+	{
+		b2Joint* joint = m_joints[i];
+		b2Body* bodyA = joint->m_bodyA;
+		b2Body* bodyB = joint->m_bodyB;
+		if (joint->m_type == e_gearJoint || bodyA->m_type != b2_dynamicBody || bodyB->m_type != b2_dynamicBody)
+		{
+			groups[i] = 0;
+			continue;
+		}
+
+		groups[i] = b2AssignColor(bodyColors, bodyA->m_islandIndex - m_staticSlotCount, bodyB->m_islandIndex - m_staticSlotCount);
+	}
+
+	// Put the joints in color order. The sort keeps the joints of a color in island order.
+	int32* jointOrder = (int32*)m_allocator->Allocate(m_jointCount * sizeof(int32));
+	b2SortByGroup(jointOrder, colors->jointStart, groups, m_jointCount);
+
+	b2Joint** joints = (b2Joint**)m_allocator->Allocate(m_jointCount * sizeof(b2Joint*));
+	for (int32 i = 0; i < m_jointCount; ++i)
+	{
+		joints[i] = m_joints[jointOrder[i]];
+	}
+	memcpy(m_joints, joints, m_jointCount * sizeof(b2Joint*));
+	m_allocator->Free(joints);
+	m_allocator->Free(jointOrder);
+
+	// The contact solver leaves static and kinematic bodies alone.
+	for (int32 i = 0; i < m_contactCount; ++i)
+	{
+		b2Body* bodyA = m_contacts[i]->GetFixtureA()->GetBody();
+		b2Body* bodyB = m_contacts[i]->GetFixtureB()->GetBody();
+		int32 indexA = bodyA->m_type == b2_dynamicBody ? bodyA->m_islandIndex - m_staticSlotCount : -1;
+		int32 indexB = bodyB->m_type == b2_dynamicBody ? bodyB->m_islandIndex - m_staticSlotCount : -1;
+		groups[i] = b2AssignColor(bodyColors, indexA, indexB);
+	}
+
+	b2SortByGroup(colors->contactOrder, colors->contactStart, groups, m_contactCount);
+
+	m_allocator->Free(groups);
+	m_allocator->Free(bodyColors);
+}
+
+// The number of constraints handed to a thread at a time when solving a color.
+const int32 b2_colorGrainSize = 32;
+
+// Solves one color. Items [0, jointCount) are joints and the rest are contacts.
+struct b2SolveColorTask : public b2ParallelTask
+{
+	void Execute(int32 begin, int32 end, int32 threadIndex)
+	{
+		int32 jointBegin = b2Min(begin, jointCount);
+		int32 jointEnd = b2Min(end, jointCount);
+		int32 contactBegin = b2Max(begin - jointCount, 0);
+		int32 contactEnd = b2Max(end - jointCount, 0);
+
+		bool solved = island->SolveConstraints(joints + jointBegin, jointEnd - jointBegin,
+			contacts + contactBegin, contactEnd - contactBegin, contactSolver, *data, stage);
+		if (solved == false)
+		{
+			unsolved[threadIndex] = true;
+		}
+	}
+
+	b2Island* island;
+	b2ContactSolver* contactSolver;
+	const b2SolverData* data;
+	b2Joint** joints;
+	int32 jointCount;
+	const int32* contacts;
+	b2Island::Stage stage;
+	bool* unsolved;
+};
+
+bool b2Island::SolveColors(const b2GraphColors* colors, b2ContactSolver* contactSolver, const b2SolverData& data, Stage stage)
+{
+	// Group 0 can't be colored, so it is solved first and sequentially.
+	bool solved = SolveConstraints(m_joints, colors->jointStart[1],
+		colors->contactOrder, colors->contactStart[1], contactSolver, data, stage);
+
+	bool unsolved[b2_maxThreads];
+	for (int32 i = 0; i < b2_maxThreads; ++i)
+	{
+		unsolved[i] = false;
+	}
+
+	for (int32 i = 1; i < b2_graphColorCount + 1; ++i)
+	{
+		int32 jointStart = colors->jointStart[i];
+		int32 jointCount = colors->jointStart[i + 1] - jointStart;
+		int32 contactStart = colors->contactStart[i];
+		int32 contactCount = colors->contactStart[i + 1] - contactStart;
+
+		b2SolveColorTask task;
+		task.island = this;
+		task.contactSolver = contactSolver;
+		task.data = &data;
+		task.joints = m_joints + jointStart;
+		task.jointCount = jointCount;
+		task.contacts = colors->contactOrder + contactStart;
+		task.stage = stage;
+		task.unsolved = unsolved;
+
+		if (m_taskScheduler)
+		{
+			m_taskScheduler->ParallelFor(&task, jointCount + contactCount, b2_colorGrainSize);
+		}
+		else
+		{
+			task.Execute(0, jointCount + contactCount, 0);
+		}
+	}
+
+	for (int32 i = 0; i < b2_maxThreads; ++i)
+	{
+		if (unsolved[i])
+		{
+			solved = false;
+		}
+	}
+
+	return solved;
+}
+
+bool b2Island::SolveConstraints(b2Joint** joints, int32 jointCount, const int32* contacts, int32 contactCount,
+							   b2ContactSolver* contactSolver, const b2SolverData& data, Stage stage)
+{
+	if (stage != e_positionStage)
+	{
+		float32 maxDelta = b2Joint::SolveVelocityConstraints(joints, jointCount, data);
+
+		if (stage == e_velocityStage)
+		{
+			float32 delta = contactSolver->SolveVelocityConstraints(contacts, contactCount);
+			maxDelta = b2Max(maxDelta, delta);
+		}
+		else
+		{
+			contactSolver->SolveSoftConstraints(contacts, contactCount, stage == e_softStage);
+		}
+		return maxDelta <= m_velocityTolerance;
+	}
+
+	bool solved = b2Joint::SolvePositionConstraints(joints, jointCount, data);
+	bool contactsOkay = contactSolver->SolvePositionConstraints(contacts, contactCount);
+	return solved && contactsOkay;
+}
+
 void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiIndexB)
 {
 	b2Assert(toiIndexA < m_bodyCount);
@@ -390,10 +1018,11 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 	for (int32 i = 0; i < m_bodyCount; ++i)
 	{
 		b2Body* b = m_bodies[i];
-		m_positions[i].c = b->m_sweep.c;
-		m_positions[i].a = b->m_sweep.a;
-		m_velocities[i].v = b->m_linearVelocity;
-		m_velocities[i].w = b->m_angularVelocity;
+		const b2Sweep& sweep = b->Sweep();
+		m_positions[i].c = sweep.c;
+		m_positions[i].a = sweep.a;
+		m_velocities[i].v = b->LinearVelocity();
+		m_velocities[i].w = b->AngularVelocity();
 	}
 
 	b2ContactSolverDef contactSolverDef;
@@ -403,6 +1032,8 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 	contactSolverDef.step = subStep;
 	contactSolverDef.positions = m_positions;
 	contactSolverDef.velocities = m_velocities;
+	contactSolverDef.bodyCount = m_bodyCount;
+	contactSolverDef.simd = false;
 	b2ContactSolver contactSolver(&contactSolverDef);
 
 	// Solve position constraints.
@@ -449,10 +1080,10 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 #endif
 
 	// Leap of faith to new safe state.
-	m_bodies[toiIndexA]->m_sweep.c0 = m_positions[toiIndexA].c;
-	m_bodies[toiIndexA]->m_sweep.a0 = m_positions[toiIndexA].a;
-	m_bodies[toiIndexB]->m_sweep.c0 = m_positions[toiIndexB].c;
-	m_bodies[toiIndexB]->m_sweep.a0 = m_positions[toiIndexB].a;
+	m_bodies[toiIndexA]->Sweep().c0 = m_positions[toiIndexA].c;
+	m_bodies[toiIndexA]->Sweep().a0 = m_positions[toiIndexA].a;
+	m_bodies[toiIndexB]->Sweep().c0 = m_positions[toiIndexB].c;
+	m_bodies[toiIndexB]->Sweep().a0 = m_positions[toiIndexB].a;
 
 	// No warm starting is needed for TOI events because warm
 	// starting impulses were applied in the discrete solver.
@@ -503,10 +1134,11 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 
 		// Sync bodies
 		b2Body* body = m_bodies[i];
-		body->m_sweep.c = c;
-		body->m_sweep.a = a;
-		body->m_linearVelocity = v;
-		body->m_angularVelocity = w;
+		b2Sweep& sweep = body->Sweep();
+		sweep.c = c;
+		sweep.a = a;
+		body->LinearVelocity() = v;
+		body->AngularVelocity() = w;
 		body->SynchronizeTransform();
 	}
 
@@ -515,7 +1147,7 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 
 void b2Island::Report(const b2ContactVelocityConstraint* constraints)
 {
-	if (m_listener == NULL)
+	if (m_listener == NULL && m_impulses == NULL)
 	{
 		return;
 	}
@@ -534,6 +1166,227 @@ void b2Island::Report(const b2ContactVelocityConstraint* constraints)
 			impulse.tangentImpulses[j] = vc->points[j].tangentImpulse;
 		}
 
+		if (m_impulses)
+		{
+			m_impulses[i] = impulse;
+			continue;
+		}
+
 		m_listener->PostSolve(c, &impulse);
 	}
 }
+
+void b2Island::Report(const b2ContactImpulse* impulses)
+{
+	if (m_listener == NULL)
+	{
+		return;
+	}
+
+	for (int32 i = 0; i < m_contactCount; ++i)
+	{
+		m_listener->PostSolve(m_contacts[i], impulses + i);
+	}
+}
+
+void b2PersistentIsland::Clear()
+{
+	m_bodyList = NULL;
+	m_contactList = NULL;
+	m_jointList = NULL;
+	m_contactTail = NULL;
+	m_bodyCount = 0;
+	m_contactCount = 0;
+	m_jointCount = 0;
+	m_constraintRemoveCount = 0;
+	m_subStepCount = 1;
+}
+
+void b2PersistentIsland::AddBody(b2Body* body)
+{
+	body->m_island = this;
+	body->m_islandPrev = NULL;
+	body->m_islandNext = m_bodyList;
+	if (m_bodyList)
+	{
+		m_bodyList->m_islandPrev = body;
+	}
+	m_bodyList = body;
+	++m_bodyCount;
+}
+
+void b2PersistentIsland::RemoveBody(b2Body* body)
+{
+	b2Assert(body->m_island == this);
+
+	if (body->m_islandPrev)
+	{
+		body->m_islandPrev->m_islandNext = body->m_islandNext;
+	}
+
+	if (body->m_islandNext)
+	{
+		body->m_islandNext->m_islandPrev = body->m_islandPrev;
+	}
+
+	if (body == m_bodyList)
+	{
+		m_bodyList = body->m_islandNext;
+	}
+
+	body->m_island = NULL;
+	body->m_islandPrev = NULL;
+	body->m_islandNext = NULL;
+	--m_bodyCount;
+	++m_constraintRemoveCount;
+}
+
+void b2PersistentIsland::AddContact(b2Contact* contact)
+{
+	contact->m_flags |= b2Contact::e_islandLinkedFlag;
+	contact->m_islandPrev = m_contactTail;
+	contact->m_islandNext = NULL;
+	if (m_contactTail)
+	{
+		m_contactTail->m_islandNext = contact;
+	}
+	else
+	{
+		m_contactList = contact;
+	}
+	m_contactTail = contact;
+	++m_contactCount;
+}
+
+void b2PersistentIsland::RemoveContact(b2Contact* contact)
+{
+	b2Assert(contact->m_flags & b2Contact::e_islandLinkedFlag);
+
+	if (contact->m_islandPrev)
+	{
+		contact->m_islandPrev->m_islandNext = contact->m_islandNext;
+	}
+
+	if (contact->m_islandNext)
+	{
+		contact->m_islandNext->m_islandPrev = contact->m_islandPrev;
+	}
+
+	if (contact == m_contactList)
+	{
+		m_contactList = contact->m_islandNext;
+	}
+
+	if (contact == m_contactTail)
+	{
+		m_contactTail = contact->m_islandPrev;
+	}
+
+	contact->m_flags &= ~b2Contact::e_islandLinkedFlag;
+	contact->m_islandPrev = NULL;
+	contact->m_islandNext = NULL;
+	--m_contactCount;
+	++m_constraintRemoveCount;
+}
+
+void b2PersistentIsland::AddJoint(b2Joint* joint)
+{
+	joint->m_islandLinked = true;
+	joint->m_islandPrev = NULL;
+	joint->m_islandNext = m_jointList;
+	if (m_jointList)
+	{
+		m_jointList->m_islandPrev = joint;
+	}
+	m_jointList = joint;
+	++m_jointCount;
+}
+
+void b2PersistentIsland::RemoveJoint(b2Joint* joint)
+{
+	b2Assert(joint->m_islandLinked);
+
+	if (joint->m_islandPrev)
+	{
+		joint->m_islandPrev->m_islandNext = joint->m_islandNext;
+	}
+
+	if (joint->m_islandNext)
+	{
+		joint->m_islandNext->m_islandPrev = joint->m_islandPrev;
+	}
+
+	if (joint == m_jointList)
+	{
+		m_jointList = joint->m_islandNext;
+	}
+
+	joint->m_islandLinked = false;
+	joint->m_islandPrev = NULL;
+	joint->m_islandNext = NULL;
+	--m_jointCount;
+	++m_constraintRemoveCount;
+}
+
+void b2PersistentIsland::Merge(b2PersistentIsland* other)
+{
+	b2Assert(other != this);
+
+	// Put the lists of the other island in front of ours.
+	if (other->m_bodyList)
+	{
+		b2Body* tail = NULL;
+		for (b2Body* b = other->m_bodyList; b; b = b->m_islandNext)
+		{
+			b->m_island = this;
+			tail = b;
+		}
+
+		tail->m_islandNext = m_bodyList;
+		if (m_bodyList)
+		{
+			m_bodyList->m_islandPrev = tail;
+		}
+		m_bodyList = other->m_bodyList;
+	}
+
+	if (other->m_contactList)
+	{
+		other->m_contactTail->m_islandNext = m_contactList;
+		if (m_contactList)
+		{
+			m_contactList->m_islandPrev = other->m_contactTail;
+		}
+		else
+		{
+			m_contactTail = other->m_contactTail;
+		}
+		m_contactList = other->m_contactList;
+	}
+
+	if (other->m_jointList)
+	{
+		b2Joint* tail = other->m_jointList;
+		while (tail->m_islandNext)
+		{
+			tail = tail->m_islandNext;
+		}
+
+		tail->m_islandNext = m_jointList;
+		if (m_jointList)
+		{
+			m_jointList->m_islandPrev = tail;
+		}
+		m_jointList = other->m_jointList;
+	}
+
+	m_bodyCount += other->m_bodyCount;
+	m_contactCount += other->m_contactCount;
+	m_jointCount += other->m_jointCount;
+	m_constraintRemoveCount += other->m_constraintRemoveCount;
+
+	// Warm starting too little is safer than too much.
+	m_subStepCount = b2Min(m_subStepCount, other->m_subStepCount);
+
+	other->Clear();
+}
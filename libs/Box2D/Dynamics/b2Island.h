@@ -27,15 +27,35 @@ class b2Contact;
 class b2Joint;
 class b2StackAllocator;
 class b2ContactListener;
+class b2ContactSolver;
+class b2TaskScheduler;
+struct b2ContactImpulse;
 struct b2ContactVelocityConstraint;
 struct b2Profile;
+struct b2SolverData;
+
+/// The constraints of an island grouped by color for graph coloring. No two
+/// constraints of a color share a dynamic body, so a color can be solved
+/// concurrently. Group 0 holds the constraints that can't be colored: joints
+/// attached to a static or kinematic body, gear joints, and constraints left
+/// over when the colors run out. It is solved sequentially before the colors.
+/// The island joints are put in color order, so the joints of group i are
+/// m_joints[jointStart[i], jointStart[i + 1]). The contacts of group i are
+/// contactOrder[contactStart[i], contactStart[i + 1]).
+struct b2GraphColors
+{
+	int32 jointStart[b2_graphColorCount + 2];
+	int32 contactStart[b2_graphColorCount + 2];
+	int32* contactOrder;
+};
 
 /// This is an internal class.
 class b2Island
 {
 public:
 	b2Island(int32 bodyCapacity, int32 contactCapacity, int32 jointCapacity,
-			b2StackAllocator* allocator, b2ContactListener* listener);
+			b2StackAllocator* allocator, b2ContactListener* listener,
+			int32 staticSlotCount);
 	~b2Island();
 
 	void Clear()
@@ -45,14 +65,25 @@ public:
 		m_jointCount = 0;
 	}
 
+	// Solve a time step. If the island moves fast it is solved in substeps, see
+	// m_subStepRatio.
 	void Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep);
 
+	// Solve with soft contacts in m_softStepCount substeps instead of iterations.
+	// Each substep integrates the velocities, solves the constraints once with a
+	// soft bias, integrates the positions and relaxes the constraints once without
+	// the bias. The position iterations only correct the joints.
+	void SolveSoft(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep);
+
 	void SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiIndexB);
 
 	void Add(b2Body* body)
 	{
 		b2Assert(m_bodyCount < m_bodyCapacity);
-		body->m_islandIndex = m_bodyCount;
+		if (m_staticSlotCount == 0 || body->m_type != b2_staticBody)
+		{
+			body->m_islandIndex = m_staticSlotCount + m_bodyCount;
+		}
 		m_bodies[m_bodyCount] = body;
 		++m_bodyCount;
 	}
@@ -69,11 +100,87 @@ public:
 		m_joints[m_jointCount++] = joint;
 	}
 
+	// Add a static body used by the constraints of this island, unless it was
+	// added already. The island flag of the body must be cleared afterwards.
+	void AddStatic(b2Body* body)
+	{
+		if (body->m_type != b2_staticBody || (body->m_flags & b2Body::e_islandFlag))
+		{
+			return;
+		}
+
+		body->m_flags |= b2Body::e_islandFlag;
+		body->SetAwake(true);
+		Add(body);
+	}
+
 	void Report(const b2ContactVelocityConstraint* constraints);
+	void Report(const b2ContactImpulse* impulses);
+
+	// The number of substeps that keeps the motion of each body within
+	// m_subStepRatio per substep.
+	int32 ComputeSubStepCount(const b2TimeStep& step) const;
+
+	// Solve one substep with the iterations. The first substep stores the
+	// positions for continuous collision and the last one reports the impulses.
+	// This returns true if the position errors are small.
+	bool SolveStep(b2Profile* profile, const b2TimeStep& subStep, const b2Vec2& gravity, bool first, bool last);
+
+	// Advance the sleep time of the bodies and put the island to sleep when they
+	// have been resting long enough.
+	void UpdateSleep(float32 h, bool positionSolved);
+
+	// The constraint passes of SolveColors and SolveConstraints.
+	enum Stage
+	{
+		e_velocityStage,
+		e_positionStage,
+		e_softStage,
+		e_relaxStage
+	};
+
+	// Graph coloring. See b2GraphColors. The velocity stage returns true when no
+	// impulse changed by more than m_velocityTolerance, the position stage when
+	// the position errors are within tolerance.
+	void ColorConstraints(b2GraphColors* colors);
+	bool SolveColors(const b2GraphColors* colors, b2ContactSolver* contactSolver, const b2SolverData& data, Stage stage);
+	bool SolveConstraints(b2Joint** joints, int32 jointCount, const int32* contacts, int32 contactCount,
+						b2ContactSolver* contactSolver, const b2SolverData& data, Stage stage);
 
 	b2StackAllocator* m_allocator;
 	b2ContactListener* m_listener;
 
+	// If not NULL the contact impulses are stored here instead of being
+	// reported, so that islands solved concurrently can report them later.
+	b2ContactImpulse* m_impulses;
+
+	// Large islands are solved with graph coloring when this is set. The colors
+	// are solved on m_taskScheduler if it is not NULL.
+	bool m_graphColoring;
+	b2TaskScheduler* m_taskScheduler;
+
+	// Solve the contacts of islands that aren't colored with the batched solver.
+	bool m_simdContactSolver;
+
+	// The number of substeps of SolveSoft. Solve uses the iterations when it is zero.
+	int32 m_softStepCount;
+
+	// Solve splits the step into substeps when a body moves more than this ratio
+	// of its smallest shape extent, or turns more than this angle, in a step.
+	// Zero disables it. m_subStepCount holds the substeps of the previous step,
+	// which scale the warm starting impulses, and then those of this step.
+	float32 m_subStepRatio;
+	int32 m_subStepCount;
+
+	// Solve stops the velocity iterations once no impulse changes by more than
+	// the tolerance in a pass. The number of passes made is stored in
+	// m_velocityIterationCount.
+	float32 m_velocityTolerance;
+	int32 m_velocityIterationCount;
+
+	// Solve the joints that form trees directly, see b2TreeJointSolver.
+	bool m_treeJointSolver;
+
 	b2Body** m_bodies;
 	b2Contact** m_contacts;
 	b2Joint** m_joints;
@@ -81,6 +188,13 @@ public:
 	b2Position* m_positions;
 	b2Velocity* m_velocities;
 
+	// Islands solved concurrently may share static bodies. Each shared body
+	// keeps the solver slot assigned by the world in [0, m_staticSlotCount)
+	// and the island never writes to it.
+	b2Position* m_solverPositions;
+	b2Velocity* m_solverVelocities;
+	int32 m_staticSlotCount;
+
 	int32 m_bodyCount;
 	int32 m_jointCount;
 	int32 m_contactCount;
@@ -90,4 +204,53 @@ public:
 	int32 m_jointCapacity;
 };
 
+/// A persistent island keeps a connected part of the constraint graph from one
+/// time step to the next. Islands are merged when a constraint connects them, but
+/// they are only split when a constraint was removed and the island may go to
+/// sleep, so an island can hold several disconnected parts. Static bodies don't
+/// belong to an island. Constraints belong to the island of their other bodies.
+/// This is an internal class.
+class b2PersistentIsland
+{
+public:
+	void Clear();
+
+	void AddBody(b2Body* body);
+	void RemoveBody(b2Body* body);
+
+	void AddContact(b2Contact* contact);
+	void RemoveContact(b2Contact* contact);
+
+	void AddJoint(b2Joint* joint);
+	void RemoveJoint(b2Joint* joint);
+
+	// Move the bodies and constraints of the other island into this one. The
+	// other island is left empty.
+	void Merge(b2PersistentIsland* other);
+
+	// World island list pointers.
+	b2PersistentIsland* m_prev;
+	b2PersistentIsland* m_next;
+
+	b2Body* m_bodyList;
+	b2Contact* m_contactList;
+	b2Joint* m_jointList;
+
+	// Contacts are appended so they are solved in the order they began touching.
+	b2Contact* m_contactTail;
+
+	int32 m_bodyCount;
+	int32 m_contactCount;
+	int32 m_jointCount;
+
+	// The number of bodies and constraints removed since the island was built.
+	// The island may be disconnected if this isn't zero.
+	int32 m_constraintRemoveCount;
+
+	// The substeps of the last step, see b2Island::m_subStepCount.
+	int32 m_subStepCount;
+
+	bool m_awake;
+};
+
 #endif
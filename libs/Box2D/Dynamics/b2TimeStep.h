@@ -32,6 +32,15 @@ struct b2Profile
 	float32 solvePosition;
 	float32 broadphase;
 	float32 solveTOI;
+
+	/// The velocity iterations made by each awake island in the last step, in
+	/// island order. This is owned by the world and valid until the next step.
+	const int32* islandIterations;
+	int32 islandCount;
+
+	/// The bodies that changed place in the reordering pass of the last step, see
+	/// b2World::SetReorderInterval. Zero if there was no pass.
+	int32 reorderedBodyCount;
 };
 
 /// This is an internal structure.
@@ -43,6 +52,7 @@ struct b2TimeStep
 	int32 velocityIterations;
 	int32 positionIterations;
 	bool warmStarting;
+	bool speculativeContacts;	// the manifolds may have points that are apart
 };
 
 /// This is an internal structure.
@@ -32,7 +32,10 @@
 #include <Box2D/Collision/b2TimeOfImpact.h>
 #include <Box2D/Common/b2Draw.h>
 #include <Box2D/Common/b2Timer.h>
+#include <Box2D/Common/b2ThreadPool.h>
 #include <new>
+#include <cstring>
+#include <algorithm>
 
 b2World::b2World(const b2Vec2& gravity)
 {
@@ -45,9 +48,42 @@ b2World::b2World(const b2Vec2& gravity)
 	m_bodyCount = 0;
 	m_jointCount = 0;
 
+	m_bodyCapacity = 0;
+	m_bodies = NULL;
+	memset(&m_bodyStates, 0, sizeof(b2BodyStates));
+	ResizeBodyArrays(16);
+
+	m_frontCapacity = 16;
+	m_frontTransforms = (b2PublishedTransform*)b2Alloc(m_frontCapacity * sizeof(b2PublishedTransform));
+	m_backCapacity = 16;
+	m_backTransforms = (b2PublishedTransform*)b2Alloc(m_backCapacity * sizeof(b2PublishedTransform));
+
+	m_stepThread = NULL;
+	m_stepTask = NULL;
+	m_stepping = false;
+
+	m_awakeIslandList = NULL;
+	m_sleepingIslandList = NULL;
+
+	m_awakeBodyCapacity = 16;
+	m_awakeBodyCount = 0;
+	m_awakeBodies = (b2Body**)b2Alloc(m_awakeBodyCapacity * sizeof(b2Body*));
+
 	m_warmStarting = true;
 	m_continuousPhysics = true;
 	m_subStepping = false;
+	m_graphColoring = false;
+	m_simdContactSolver = false;
+	m_softStepCount = 0;
+	m_velocityTolerance = 0.0f;
+	m_treeJointSolver = false;
+	m_islandSubStepRatio = 0.0f;
+	m_reorderInterval = 0;
+	m_reorderCursor = 0;
+	m_reorderPending = false;
+	m_reorderLower.SetZero();
+	m_reorderUpper.SetZero();
+	m_speculativeContacts = false;
 
 	m_stepComplete = true;
 
@@ -60,11 +96,30 @@ b2World::b2World(const b2Vec2& gravity)
 
 	m_contactManager.m_allocator = &m_blockAllocator;
 
+	m_threadPool = NULL;
+	m_threadCount = b2ThreadPool::GetHardwareThreadCount();
+	m_customScheduler = NULL;
+	m_taskScheduler = NULL;
+	m_threadStackAllocators = NULL;
+	m_threadStackAllocatorCount = 0;
+
 	memset(&m_profile, 0, sizeof(b2Profile));
+
+	m_islandIterationCapacity = 16;
+	m_islandIterations = (int32*)b2Alloc(m_islandIterationCapacity * sizeof(int32));
 }
 
 b2World::~b2World()
 {
+	Wait();
+
+	if (m_stepThread)
+	{
+		m_stepThread->~b2WorkerThread();
+		b2Free(m_stepThread);
+		b2Free(m_stepTask);
+	}
+
 	// Some shapes allocate using b2Alloc.
 	b2Body* b = m_bodyList;
 	while (b)
@@ -82,6 +137,23 @@ b2World::~b2World()
 
 		b = bNext;
 	}
+
+	SetTaskScheduler(NULL);
+	SetThreadCount(1);
+
+	b2Free(m_awakeBodies);
+	b2Free(m_bodies);
+	b2Free(m_bodyStates.transforms);
+	b2Free(m_bodyStates.sweeps);
+	b2Free(m_bodyStates.linearVelocities);
+	b2Free(m_bodyStates.angularVelocities);
+	b2Free(m_bodyStates.forces);
+	b2Free(m_bodyStates.torques);
+	b2Free(m_bodyStates.invMasses);
+	b2Free(m_bodyStates.invIs);
+	b2Free(m_frontTransforms);
+	b2Free(m_backTransforms);
+	b2Free(m_islandIterations);
 }
 
 void b2World::SetDestructionListener(b2DestructionListener* listener)
@@ -104,6 +176,34 @@ void b2World::SetDebugDraw(b2Draw* debugDraw)
 	m_debugDraw = debugDraw;
 }
 
+// Move an array to a new allocation, keeping the first count elements.
+template <typename T>
+static void b2ResizeArray(T** array, int32 count, int32 capacity)
+{
+	T* oldArray = *array;
+	*array = (T*)b2Alloc(capacity * sizeof(T));
+	if (oldArray)
+	{
+		memcpy(*array, oldArray, count * sizeof(T));
+		b2Free(oldArray);
+	}
+}
+
+void b2World::ResizeBodyArrays(int32 capacity)
+{
+	b2Assert(capacity >= m_bodyCount);
+	b2ResizeArray(&m_bodies, m_bodyCount, capacity);
+	b2ResizeArray(&m_bodyStates.transforms, m_bodyCount, capacity);
+	b2ResizeArray(&m_bodyStates.sweeps, m_bodyCount, capacity);
+	b2ResizeArray(&m_bodyStates.linearVelocities, m_bodyCount, capacity);
+	b2ResizeArray(&m_bodyStates.angularVelocities, m_bodyCount, capacity);
+	b2ResizeArray(&m_bodyStates.forces, m_bodyCount, capacity);
+	b2ResizeArray(&m_bodyStates.torques, m_bodyCount, capacity);
+	b2ResizeArray(&m_bodyStates.invMasses, m_bodyCount, capacity);
+	b2ResizeArray(&m_bodyStates.invIs, m_bodyCount, capacity);
+	m_bodyCapacity = capacity;
+}
+
 b2Body* b2World::CreateBody(const b2BodyDef* def)
 {
 	b2Assert(IsLocked() == false);
@@ -112,8 +212,14 @@ b2Body* b2World::CreateBody(const b2BodyDef* def)
 		return NULL;
 	}
 
+	// The body writes its state to the world arrays.
+	if (m_bodyCount == m_bodyCapacity)
+	{
+		ResizeBodyArrays(2 * m_bodyCapacity);
+	}
+
 	void* mem = m_blockAllocator.Allocate(sizeof(b2Body));
-	b2Body* b = new (mem) b2Body(def, this);
+	b2Body* b = new (mem) b2Body(def, this, m_bodyCount);
 
 	// Add to world doubly linked list.
 	b->m_prev = NULL;
@@ -123,8 +229,25 @@ b2Body* b2World::CreateBody(const b2BodyDef* def)
 		m_bodyList->m_prev = b;
 	}
 	m_bodyList = b;
+
+	// Add to the body array and publish the initial transform.
+	if (m_bodyCount == m_frontCapacity)
+	{
+		b2PublishedTransform* oldTransforms = m_frontTransforms;
+		m_frontCapacity *= 2;
+		m_frontTransforms = (b2PublishedTransform*)b2Alloc(m_frontCapacity * sizeof(b2PublishedTransform));
+		memcpy(m_frontTransforms, oldTransforms, m_bodyCount * sizeof(b2PublishedTransform));
+		b2Free(oldTransforms);
+	}
+
+	m_bodies[m_bodyCount] = b;
+	m_frontTransforms[m_bodyCount].xf0 = b->GetTransform();
+	m_frontTransforms[m_bodyCount].xf = b->GetTransform();
 	++m_bodyCount;
 
+	AddToIsland(b);
+	UpdateAwakeSet(b);
+
 	return b;
 }
 
@@ -165,6 +288,9 @@ void b2World::DestroyBody(b2Body* b)
 	}
 	b->m_contactList = NULL;
 
+	RemoveFromIsland(b);
+	RemoveAwake(b);
+
 	// Delete the attached fixtures. This destroys broad-phase proxies.
 	b2Fixture* f = b->m_fixtureList;
 	while (f)
@@ -204,6 +330,23 @@ void b2World::DestroyBody(b2Body* b)
 		m_bodyList = b->m_next;
 	}
 
+	// Remove from the body array by moving the last body into its slot.
+	int32 index = b->m_worldIndex;
+	int32 lastIndex = m_bodyCount - 1;
+	b2Body* last = m_bodies[lastIndex];
+	m_bodies[index] = last;
+	m_bodyStates.transforms[index] = m_bodyStates.transforms[lastIndex];
+	m_bodyStates.sweeps[index] = m_bodyStates.sweeps[lastIndex];
+	m_bodyStates.linearVelocities[index] = m_bodyStates.linearVelocities[lastIndex];
+	m_bodyStates.angularVelocities[index] = m_bodyStates.angularVelocities[lastIndex];
+	m_bodyStates.forces[index] = m_bodyStates.forces[lastIndex];
+	m_bodyStates.torques[index] = m_bodyStates.torques[lastIndex];
+	m_bodyStates.invMasses[index] = m_bodyStates.invMasses[lastIndex];
+	m_bodyStates.invIs[index] = m_bodyStates.invIs[lastIndex];
+	m_frontTransforms[index] = m_frontTransforms[lastIndex];
+	last->m_worldIndex = index;
+	b->m_worldIndex = -1;
+
 	--m_bodyCount;
 	b->~b2Body();
 	m_blockAllocator.Free(b, sizeof(b2Body));
@@ -244,6 +387,8 @@ b2Joint* b2World::CreateJoint(const b2JointDef* def)
 	if (j->m_bodyB->m_jointList) j->m_bodyB->m_jointList->prev = &j->m_edgeB;
 	j->m_bodyB->m_jointList = &j->m_edgeB;
 
+	LinkJoint(j);
+
 	b2Body* bodyA = def->bodyA;
 	b2Body* bodyB = def->bodyB;
 
@@ -279,6 +424,8 @@ void b2World::DestroyJoint(b2Joint* j)
 
 	bool collideConnected = j->m_collideConnected;
 
+	UnlinkJoint(j);
+
 	// Remove from the doubly linked list.
 	if (j->m_prev)
 	{
@@ -382,217 +529,1059 @@ void b2World::SetAllowSleeping(bool flag)
 	}
 }
 
-// Find islands, integrate and solve constraints, solve position constraints
-void b2World::Solve(const b2TimeStep& step)
+void b2World::SetThreadCount(int32 count)
 {
-	m_profile.solveInit = 0.0f;
-	m_profile.solveVelocity = 0.0f;
-	m_profile.solvePosition = 0.0f;
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
 
-	// Size the island for the worst case.
-	b2Island island(m_bodyCount,
-					m_contactManager.m_contactCount,
-					m_jointCount,
-					&m_stackAllocator,
-					m_contactManager.m_contactListener);
+	m_threadCount = b2Clamp(count, 1, b2_maxThreads);
 
-	// Clear all the island flags.
-	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	// The next step starts a pool of the new size.
+	if (m_threadPool && m_threadPool->GetThreadCount() != m_threadCount)
 	{
-		b->m_flags &= ~b2Body::e_islandFlag;
+		StopThreads();
 	}
-	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+}
+
+int32 b2World::GetThreadCount() const
+{
+	return m_customScheduler ? m_customScheduler->GetThreadCount() : m_threadCount;
+}
+
+void b2World::StartThreads()
+{
+	if (m_customScheduler || m_threadPool || m_threadCount == 1)
 	{
-		c->m_flags &= ~b2Contact::e_islandFlag;
+		return;
 	}
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
+
+	void* mem = b2Alloc(sizeof(b2ThreadPool));
+	m_threadPool = new (mem) b2ThreadPool(m_threadCount);
+	UpdateTaskScheduler();
+}
+
+void b2World::StopThreads()
+{
+	if (m_threadPool == NULL)
 	{
-		j->m_islandFlag = false;
+		return;
 	}
 
-	// Build and simulate all awake islands.
-	int32 stackSize = m_bodyCount;
-	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
-	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
+	m_threadPool->~b2ThreadPool();
+	b2Free(m_threadPool);
+	m_threadPool = NULL;
+	UpdateTaskScheduler();
+}
+
+void b2World::SetTaskScheduler(b2TaskScheduler* scheduler)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	m_customScheduler = scheduler;
+	if (m_customScheduler)
+	{
+		StopThreads();
+	}
+	UpdateTaskScheduler();
+}
+
+void b2World::UpdateTaskScheduler()
+{
+	b2TaskScheduler* scheduler = m_customScheduler ? m_customScheduler : m_threadPool;
+
+	// Thread 0 uses m_stackAllocator, the other threads get their own.
+	int32 allocatorCount = scheduler ? scheduler->GetThreadCount() - 1 : 0;
+	b2Assert(allocatorCount < b2_maxThreads);
+	if (allocatorCount != m_threadStackAllocatorCount)
 	{
-		if (seed->m_flags & b2Body::e_islandFlag)
+		for (int32 i = 0; i < m_threadStackAllocatorCount; ++i)
 		{
-			continue;
+			m_threadStackAllocators[i].~b2StackAllocator();
 		}
+		b2Free(m_threadStackAllocators);
+		m_threadStackAllocators = NULL;
 
-		if (seed->IsAwake() == false || seed->IsActive() == false)
+		m_threadStackAllocatorCount = allocatorCount;
+		if (allocatorCount > 0)
 		{
-			continue;
+			m_threadStackAllocators = (b2StackAllocator*)b2Alloc(allocatorCount * sizeof(b2StackAllocator));
+			for (int32 i = 0; i < allocatorCount; ++i)
+			{
+				new (m_threadStackAllocators + i) b2StackAllocator;
+			}
 		}
+	}
 
-		// The seed can be dynamic or kinematic.
-		if (seed->GetType() == b2_staticBody)
+	m_taskScheduler = scheduler;
+	m_contactManager.m_taskScheduler = scheduler;
+	m_contactManager.m_broadPhase.SetTaskScheduler(scheduler);
+}
+
+static void b2InsertIsland(b2PersistentIsland** list, b2PersistentIsland* island)
+{
+	island->m_prev = NULL;
+	island->m_next = *list;
+	if (*list)
+	{
+		(*list)->m_prev = island;
+	}
+	*list = island;
+}
+
+static void b2RemoveIsland(b2PersistentIsland** list, b2PersistentIsland* island)
+{
+	if (island->m_prev)
+	{
+		island->m_prev->m_next = island->m_next;
+	}
+
+	if (island->m_next)
+	{
+		island->m_next->m_prev = island->m_prev;
+	}
+
+	if (island == *list)
+	{
+		*list = island->m_next;
+	}
+}
+
+b2PersistentIsland* b2World::CreateIsland(bool awake)
+{
+	void* mem = m_blockAllocator.Allocate(sizeof(b2PersistentIsland));
+	b2PersistentIsland* island = (b2PersistentIsland*)mem;
+	island->Clear();
+	island->m_awake = awake;
+	b2InsertIsland(awake ? &m_awakeIslandList : &m_sleepingIslandList, island);
+	return island;
+}
+
+void b2World::DestroyIsland(b2PersistentIsland* island)
+{
+	b2Assert(island->m_bodyCount == 0);
+	b2Assert(island->m_contactCount == 0);
+	b2Assert(island->m_jointCount == 0);
+
+	b2RemoveIsland(island->m_awake ? &m_awakeIslandList : &m_sleepingIslandList, island);
+	m_blockAllocator.Free(island, sizeof(b2PersistentIsland));
+}
+
+void b2World::WakeIsland(b2PersistentIsland* island)
+{
+	if (island->m_awake)
+	{
+		return;
+	}
+
+	// The bodies are woken when the island is solved.
+	b2RemoveIsland(&m_sleepingIslandList, island);
+	b2InsertIsland(&m_awakeIslandList, island);
+	island->m_awake = true;
+}
+
+void b2World::SleepIsland(b2PersistentIsland* island)
+{
+	if (island->m_awake == false)
+	{
+		return;
+	}
+
+	b2RemoveIsland(&m_awakeIslandList, island);
+	b2InsertIsland(&m_sleepingIslandList, island);
+	island->m_awake = false;
+
+	// The solver puts the bodies to sleep without updating the awake set.
+	for (b2Body* b = island->m_bodyList; b; b = b->m_islandNext)
+	{
+		UpdateAwakeSet(b);
+	}
+}
+
+// Merge the smaller island into the larger one. Either island may be NULL.
+b2PersistentIsland* b2World::MergeIslands(b2PersistentIsland* islandA, b2PersistentIsland* islandB)
+{
+	if (islandA == NULL)
+	{
+		return islandB;
+	}
+
+	if (islandB == NULL || islandA == islandB)
+	{
+		return islandA;
+	}
+
+	if (islandA->m_bodyCount < islandB->m_bodyCount)
+	{
+		b2Swap(islandA, islandB);
+	}
+
+	// The merged island is awake if either island is.
+	if (islandB->m_awake)
+	{
+		WakeIsland(islandA);
+	}
+
+	islandA->Merge(islandB);
+	DestroyIsland(islandB);
+	return islandA;
+}
+
+// Split an island into its connected parts. The first part keeps the island.
+void b2World::SplitIsland(b2PersistentIsland* island)
+{
+	int32 bodyCount = island->m_bodyCount;
+	int32 contactCount = island->m_contactCount;
+	int32 jointCount = island->m_jointCount;
+
+	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(bodyCount * sizeof(b2Body*));
+	b2Contact** contacts = (b2Contact**)m_stackAllocator.Allocate(contactCount * sizeof(b2Contact*));
+	b2Joint** joints = (b2Joint**)m_stackAllocator.Allocate(jointCount * sizeof(b2Joint*));
+	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(bodyCount * sizeof(b2Body*));
+
+	int32 count = 0;
+	for (b2Body* b = island->m_bodyList; b; b = b->m_islandNext)
+	{
+		bodies[count++] = b;
+	}
+
+	count = 0;
+	for (b2Contact* c = island->m_contactList; c; c = c->m_islandNext)
+	{
+		contacts[count++] = c;
+	}
+
+	count = 0;
+	for (b2Joint* j = island->m_jointList; j; j = j->m_islandNext)
+	{
+		joints[count++] = j;
+	}
+
+	// A body without an island hasn't been visited yet. The parts keep the
+	// substeps of the island.
+	int32 subStepCount = island->m_subStepCount;
+	island->Clear();
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		bodies[i]->m_island = NULL;
+	}
+
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		b2Body* seed = bodies[i];
+		if (seed->m_island)
 		{
 			continue;
 		}
 
-		// Reset island and stack.
-		island.Clear();
+		b2PersistentIsland* part = i == 0 ? island : CreateIsland(island->m_awake);
+		part->m_subStepCount = subStepCount;
 		int32 stackCount = 0;
 		stack[stackCount++] = seed;
-		seed->m_flags |= b2Body::e_islandFlag;
+		part->AddBody(seed);
 
-		// Perform a depth first search (DFS) on the constraint graph.
+		// Perform a depth first search (DFS) on the constraints of the island.
 		while (stackCount > 0)
 		{
-			// Grab the next body off the stack and add it to the island.
 			b2Body* b = stack[--stackCount];
+
+			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+			{
+				b2Body* other = ce->other;
+				if ((ce->contact->m_flags & b2Contact::e_islandLinkedFlag) == 0 ||
+					other->m_type == b2_staticBody || other->m_island)
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < bodyCount);
+				stack[stackCount++] = other;
+				part->AddBody(other);
+			}
+
+			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+			{
+				b2Body* other = je->other;
+				if (je->joint->m_islandLinked == false ||
+					other->m_type == b2_staticBody || other->m_island)
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < bodyCount);
+				stack[stackCount++] = other;
+				part->AddBody(other);
+			}
+		}
+	}
+
+	// Hand the constraints to the parts of their bodies.
+	for (int32 i = 0; i < contactCount; ++i)
+	{
+		b2Contact* c = contacts[i];
+		b2Body* bodyA = c->m_fixtureA->m_body;
+		b2Body* bodyB = c->m_fixtureB->m_body;
+		b2PersistentIsland* part = bodyA->m_island ? bodyA->m_island : bodyB->m_island;
+		part->AddContact(c);
+	}
+
+	for (int32 i = 0; i < jointCount; ++i)
+	{
+		b2Joint* j = joints[i];
+		b2PersistentIsland* part = j->m_bodyA->m_island ? j->m_bodyA->m_island : j->m_bodyB->m_island;
+		part->AddJoint(j);
+	}
+
+	m_stackAllocator.Free(stack);
+	m_stackAllocator.Free(joints);
+	m_stackAllocator.Free(contacts);
+	m_stackAllocator.Free(bodies);
+}
+
+// Put an active dynamic or kinematic body in an island of its own and link the
+// constraints of the body.
+void b2World::AddToIsland(b2Body* body)
+{
+	b2Assert(body->m_island == NULL);
+
+	if (body->m_type != b2_staticBody && body->IsActive())
+	{
+		b2PersistentIsland* island = CreateIsland(body->IsAwake());
+		island->AddBody(body);
+	}
+
+	for (b2JointEdge* je = body->m_jointList; je; je = je->next)
+	{
+		LinkJoint(je->joint);
+	}
+
+	for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+	{
+		b2Contact* c = ce->contact;
+		bool solid = (c->m_flags & (b2Contact::e_touchingFlag | b2Contact::e_speculativeFlag)) != 0;
+		if (solid && c->m_fixtureA->m_isSensor == false && c->m_fixtureB->m_isSensor == false)
+		{
+			LinkContact(c);
+		}
+	}
+}
+
+// Unlink the constraints of a body and take it out of its island.
+void b2World::RemoveFromIsland(b2Body* body)
+{
+	for (b2JointEdge* je = body->m_jointList; je; je = je->next)
+	{
+		UnlinkJoint(je->joint);
+	}
+
+	for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+	{
+		UnlinkContact(ce->contact);
+	}
+
+	b2PersistentIsland* island = body->m_island;
+	if (island)
+	{
+		island->RemoveBody(body);
+		if (island->m_bodyCount == 0)
+		{
+			DestroyIsland(island);
+		}
+	}
+}
+
+void b2World::UpdateAwakeSet(b2Body* body)
+{
+	bool awake = body->IsAwake() && body->m_type != b2_staticBody;
+	if (awake == (body->m_awakeIndex != -1))
+	{
+		return;
+	}
+
+	if (awake)
+	{
+		if (m_awakeBodyCount == m_awakeBodyCapacity)
+		{
+			b2Body** oldBodies = m_awakeBodies;
+			m_awakeBodyCapacity *= 2;
+			m_awakeBodies = (b2Body**)b2Alloc(m_awakeBodyCapacity * sizeof(b2Body*));
+			memcpy(m_awakeBodies, oldBodies, m_awakeBodyCount * sizeof(b2Body*));
+			b2Free(oldBodies);
+		}
+
+		body->m_awakeIndex = m_awakeBodyCount;
+		m_awakeBodies[m_awakeBodyCount] = body;
+		++m_awakeBodyCount;
+	}
+	else
+	{
+		RemoveAwake(body);
+	}
+
+	for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+	{
+		m_contactManager.UpdateAwakeSet(ce->contact);
+	}
+}
+
+void b2World::RemoveAwake(b2Body* body)
+{
+	int32 index = body->m_awakeIndex;
+	if (index == -1)
+	{
+		return;
+	}
+
+	b2Assert(m_awakeBodies[index] == body);
+	--m_awakeBodyCount;
+	m_awakeBodies[index] = m_awakeBodies[m_awakeBodyCount];
+	m_awakeBodies[index]->m_awakeIndex = index;
+	body->m_awakeIndex = -1;
+}
+
+void b2World::LinkContact(b2Contact* contact)
+{
+	if (contact->m_flags & b2Contact::e_islandLinkedFlag)
+	{
+		return;
+	}
+
+	b2Body* bodyA = contact->m_fixtureA->m_body;
+	b2Body* bodyB = contact->m_fixtureB->m_body;
+	b2PersistentIsland* island = MergeIslands(bodyA->m_island, bodyB->m_island);
+	if (island)
+	{
+		island->AddContact(contact);
+	}
+}
+
+void b2World::UnlinkContact(b2Contact* contact)
+{
+	if ((contact->m_flags & b2Contact::e_islandLinkedFlag) == 0)
+	{
+		return;
+	}
+
+	b2Body* bodyA = contact->m_fixtureA->m_body;
+	b2Body* bodyB = contact->m_fixtureB->m_body;
+	b2PersistentIsland* island = bodyA->m_island ? bodyA->m_island : bodyB->m_island;
+	island->RemoveContact(contact);
+}
+
+void b2World::LinkJoint(b2Joint* joint)
+{
+	if (joint->m_islandLinked)
+	{
+		return;
+	}
+
+	// Don't simulate joints connected to inactive bodies.
+	b2Body* bodyA = joint->m_bodyA;
+	b2Body* bodyB = joint->m_bodyB;
+	if (bodyA->IsActive() == false || bodyB->IsActive() == false)
+	{
+		return;
+	}
+
+	b2PersistentIsland* island = MergeIslands(bodyA->m_island, bodyB->m_island);
+	if (island)
+	{
+		island->AddJoint(joint);
+	}
+}
+
+void b2World::UnlinkJoint(b2Joint* joint)
+{
+	if (joint->m_islandLinked == false)
+	{
+		return;
+	}
+
+	b2Body* bodyA = joint->m_bodyA;
+	b2Body* bodyB = joint->m_bodyB;
+	b2PersistentIsland* island = bodyA->m_island ? bodyA->m_island : bodyB->m_island;
+	island->RemoveJoint(joint);
+}
+
+// The bodies, contacts, and joints of island i are at [bodyStart[i], bodyStart[i + 1])
+// and so on in the lists of the island graph.
+struct b2IslandRanges
+{
+	int32* bodyStart;
+	int32* contactStart;
+	int32* jointStart;
+};
+
+// Solves islands collected by b2World::Solve. Each island only touches its own
+// bodies, contacts, and joints. Static bodies are shared, so they are given a
+// solver slot up front and are never written.
+struct b2SolveIslandsTask : public b2ParallelTask
+{
+	void Execute(int32 begin, int32 end, int32 threadIndex)
+	{
+		// Thread 0 is the caller and has no allocator of its own.
+		b2StackAllocator* allocator = threadIndex == 0 ? stackAllocator : threadStackAllocators + threadIndex - 1;
+		b2Profile* threadProfile = profiles + threadIndex;
+
+		for (int32 i = begin; i < end; ++i)
+		{
+			// Colored islands are solved afterwards using every thread.
+			if (IsColored(i))
+			{
+				continue;
+			}
+
+			SolveIsland(i, allocator, NULL, threadProfile);
+		}
+	}
+
+	bool IsColored(int32 i) const
+	{
+		int32 contactCount = ranges->contactStart[i + 1] - ranges->contactStart[i];
+		int32 jointCount = ranges->jointStart[i + 1] - ranges->jointStart[i];
+		return graphColoring && contactCount + jointCount >= b2_minColoredConstraints;
+	}
+
+	void SolveIsland(int32 i, b2StackAllocator* allocator, b2TaskScheduler* taskScheduler, b2Profile* threadProfile)
+	{
+		int32 bodyStart = ranges->bodyStart[i];
+		int32 bodyCount = ranges->bodyStart[i + 1] - bodyStart;
+		int32 contactStart = ranges->contactStart[i];
+		int32 contactCount = ranges->contactStart[i + 1] - contactStart;
+		int32 jointStart = ranges->jointStart[i];
+		int32 jointCount = ranges->jointStart[i + 1] - jointStart;
+
+		// Contact impulses are reported afterwards on the calling thread.
+		b2Island island(bodyCount, contactCount, jointCount, allocator, NULL, staticSlotCount);
+		island.m_graphColoring = graphColoring;
+		island.m_simdContactSolver = simdContactSolver;
+		island.m_softStepCount = softStepCount;
+		island.m_velocityTolerance = velocityTolerance;
+		island.m_treeJointSolver = treeJointSolver;
+		island.m_subStepRatio = islandSubStepRatio;
+		island.m_taskScheduler = taskScheduler;
+		if (impulses)
+		{
+			island.m_impulses = impulses + contactStart;
+		}
+
+		for (int32 j = 0; j < bodyCount; ++j)
+		{
+			island.Add(graph->m_bodies[bodyStart + j]);
+		}
+		for (int32 j = 0; j < contactCount; ++j)
+		{
+			island.Add(graph->m_contacts[contactStart + j]);
+		}
+		for (int32 j = 0; j < jointCount; ++j)
+		{
+			island.Add(graph->m_joints[jointStart + j]);
+		}
+
+		// The first body belongs to the persistent island, which only this task
+		// touches.
+		b2PersistentIsland* persistentIsland = island.m_bodies[0]->m_island;
+		island.m_subStepCount = persistentIsland->m_subStepCount;
+
+		b2Profile profile;
+		island.Solve(&profile, *step, gravity, allowSleep);
+		persistentIsland->m_subStepCount = island.m_subStepCount;
+		threadProfile->solveInit += profile.solveInit;
+		threadProfile->solveVelocity += profile.solveVelocity;
+		threadProfile->solvePosition += profile.solvePosition;
+		iterations[i] = island.m_velocityIterationCount;
+	}
+
+	b2StackAllocator* stackAllocator;
+	b2StackAllocator* threadStackAllocators;
+	const b2Island* graph;
+	const b2IslandRanges* ranges;
+	const b2TimeStep* step;
+	b2Vec2 gravity;
+	bool allowSleep;
+	bool graphColoring;
+	bool simdContactSolver;
+	int32 softStepCount;
+	float32 velocityTolerance;
+	bool treeJointSolver;
+	float32 islandSubStepRatio;
+	int32 staticSlotCount;
+	b2ContactImpulse* impulses;
+	b2Profile* profiles;
+	int32* iterations;
+};
+
+// The number of bodies handed to a thread at a time when synchronizing fixtures.
+const int32 b2_synchronizeGrainSize = 32;
+
+// Computes the fixture AABBs of moved bodies. The broad-phase is only read.
+struct b2SynchronizeFixturesTask : public b2ParallelTask
+{
+	void Execute(int32 begin, int32 end, int32 threadIndex)
+	{
+		B2_NOT_USED(threadIndex);
+		for (int32 i = begin; i < end; ++i)
+		{
+			moves[i] = bodies[i]->ComputeFixtureAABBs();
+		}
+	}
+
+	b2Body** bodies;
+	bool* moves;
+};
+
+// Integrate and solve constraints of the awake islands, solve position constraints
+void b2World::Solve(const b2TimeStep& step)
+{
+	m_profile.solveInit = 0.0f;
+	m_profile.solveVelocity = 0.0f;
+	m_profile.solvePosition = 0.0f;
+
+	// Split the islands that lost a constraint once a body is ready to sleep, so
+	// the parts can go to sleep on their own. New parts are put at the front of
+	// the list and aren't visited again.
+	if (m_allowSleep)
+	{
+		for (b2PersistentIsland* island = m_awakeIslandList; island; island = island->m_next)
+		{
+			if (island->m_constraintRemoveCount == 0)
+			{
+				continue;
+			}
+
+			for (b2Body* b = island->m_bodyList; b; b = b->m_islandNext)
+			{
+				if (b->m_sleepTime >= b2_timeToSleep)
+				{
+					SplitIsland(island);
+					break;
+				}
+			}
+		}
+	}
+
+	// Put the islands without awake bodies to sleep and size the solver for the rest.
+	int32 islandCount = 0;
+	int32 bodyCount = 0;
+	int32 contactCount = 0;
+	int32 jointCount = 0;
+	b2PersistentIsland* persistentIsland = m_awakeIslandList;
+	while (persistentIsland)
+	{
+		b2PersistentIsland* next = persistentIsland->m_next;
+
+		bool awake = false;
+		for (b2Body* b = persistentIsland->m_bodyList; b; b = b->m_islandNext)
+		{
+			if (b->IsAwake())
+			{
+				awake = true;
+				break;
+			}
+		}
+
+		if (awake)
+		{
+			++islandCount;
+			bodyCount += persistentIsland->m_bodyCount;
+			contactCount += persistentIsland->m_contactCount;
+			jointCount += persistentIsland->m_jointCount;
+		}
+		else
+		{
+			SleepIsland(persistentIsland);
+		}
+
+		persistentIsland = next;
+	}
+
+	if (islandCount > m_islandIterationCapacity)
+	{
+		b2Free(m_islandIterations);
+		m_islandIterationCapacity = b2Max(2 * m_islandIterationCapacity, islandCount);
+		m_islandIterations = (int32*)b2Alloc(m_islandIterationCapacity * sizeof(int32));
+	}
+
+	m_profile.islandIterations = m_islandIterations;
+	m_profile.islandCount = islandCount;
+
+	// With worker threads all islands are collected into one island graph and
+	// solved afterwards. A static body can be in several islands, so its entry
+	// may be repeated once per contact or joint.
+	bool parallel = m_taskScheduler != NULL;
+	b2Island island(bodyCount + contactCount + jointCount,
+					contactCount,
+					jointCount,
+					&m_stackAllocator,
+					m_contactManager.m_contactListener,
+					0);
+	island.m_graphColoring = m_graphColoring;
+	island.m_simdContactSolver = m_simdContactSolver;
+	island.m_softStepCount = m_softStepCount;
+	island.m_velocityTolerance = m_velocityTolerance;
+	island.m_treeJointSolver = m_treeJointSolver;
+	island.m_subStepRatio = m_islandSubStepRatio;
+
+	b2IslandRanges ranges;
+	if (parallel)
+	{
+		ranges.bodyStart = (int32*)m_stackAllocator.Allocate((islandCount + 1) * sizeof(int32));
+		ranges.contactStart = (int32*)m_stackAllocator.Allocate((islandCount + 1) * sizeof(int32));
+		ranges.jointStart = (int32*)m_stackAllocator.Allocate((islandCount + 1) * sizeof(int32));
+	}
+
+	// Build and simulate all awake islands.
+	int32 islandIndex = 0;
+	for (persistentIsland = m_awakeIslandList; persistentIsland; persistentIsland = persistentIsland->m_next)
+	{
+		int32 bodyStart = 0;
+		if (parallel)
+		{
+			bodyStart = island.m_bodyCount;
+			ranges.bodyStart[islandIndex] = island.m_bodyCount;
+			ranges.contactStart[islandIndex] = island.m_contactCount;
+			ranges.jointStart[islandIndex] = island.m_jointCount;
+		}
+		else
+		{
+			island.Clear();
+		}
+
+		for (b2Body* b = persistentIsland->m_bodyList; b; b = b->m_islandNext)
+		{
 			b2Assert(b->IsActive() == true);
 			island.Add(b);
 
 			// Make sure the body is awake.
 			b->SetAwake(true);
+		}
 
-			// To keep islands as small as possible, we don't
-			// propagate islands across static bodies.
-			if (b->GetType() == b2_staticBody)
+		for (b2Contact* contact = persistentIsland->m_contactList; contact; contact = contact->m_islandNext)
+		{
+			// Is this contact solid and touching, or about to touch?
+			if (contact->IsEnabled() == false ||
+				(contact->m_flags & (b2Contact::e_touchingFlag | b2Contact::e_speculativeFlag)) == 0)
 			{
 				continue;
 			}
 
-			// Search all contacts connected to this body.
-			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+			// Skip sensors.
+			bool sensorA = contact->m_fixtureA->m_isSensor;
+			bool sensorB = contact->m_fixtureB->m_isSensor;
+			if (sensorA || sensorB)
 			{
-				b2Contact* contact = ce->contact;
+				continue;
+			}
 
-				// Has this contact already been added to an island?
-				if (contact->m_flags & b2Contact::e_islandFlag)
-				{
-					continue;
-				}
+			island.Add(contact);
+			island.AddStatic(contact->m_fixtureA->m_body);
+			island.AddStatic(contact->m_fixtureB->m_body);
+		}
 
-				// Is this contact solid and touching?
-				if (contact->IsEnabled() == false ||
-					contact->IsTouching() == false)
-				{
-					continue;
-				}
+		for (b2Joint* joint = persistentIsland->m_jointList; joint; joint = joint->m_islandNext)
+		{
+			island.Add(joint);
+			island.AddStatic(joint->m_bodyA);
+			island.AddStatic(joint->m_bodyB);
+		}
+
+		// Allow static bodies to participate in other islands.
+		for (int32 i = bodyStart; i < island.m_bodyCount; ++i)
+		{
+			b2Body* b = island.m_bodies[i];
+			if (b->GetType() == b2_staticBody)
+			{
+				b->m_flags &= ~b2Body::e_islandFlag;
+			}
+		}
+
+		if (parallel)
+		{
+			++islandIndex;
+			continue;
+		}
+
+		b2Profile profile;
+		island.m_subStepCount = persistentIsland->m_subStepCount;
+		island.Solve(&profile, step, m_gravity, m_allowSleep);
+		persistentIsland->m_subStepCount = island.m_subStepCount;
+		m_profile.solveInit += profile.solveInit;
+		m_profile.solveVelocity += profile.solveVelocity;
+		m_profile.solvePosition += profile.solvePosition;
+		m_islandIterations[islandIndex++] = island.m_velocityIterationCount;
+	}
+
+	if (parallel)
+	{
+		ranges.bodyStart[islandCount] = island.m_bodyCount;
+		ranges.contactStart[islandCount] = island.m_contactCount;
+		ranges.jointStart[islandCount] = island.m_jointCount;
+
+		// Give every static body in the graph one solver slot.
+		int32 staticSlotCount = 0;
+		for (int32 i = 0; i < island.m_bodyCount; ++i)
+		{
+			b2Body* b = island.m_bodies[i];
+			if (b->GetType() == b2_staticBody)
+			{
+				b->m_islandIndex = -1;
+			}
+		}
+		for (int32 i = 0; i < island.m_bodyCount; ++i)
+		{
+			b2Body* b = island.m_bodies[i];
+			if (b->GetType() == b2_staticBody && b->m_islandIndex == -1)
+			{
+				b->m_islandIndex = staticSlotCount++;
 
-				// Skip sensors.
-				bool sensorA = contact->m_fixtureA->m_isSensor;
-				bool sensorB = contact->m_fixtureB->m_isSensor;
-				if (sensorA || sensorB)
-				{
-					continue;
-				}
+				// The islands don't write shared bodies, so store the position for
+				// continuous collision here. A TOI advance may have left it behind.
+				b->Sweep().c0 = b->Sweep().c;
+				b->Sweep().a0 = b->Sweep().a;
+			}
+		}
 
-				island.Add(contact);
-				contact->m_flags |= b2Contact::e_islandFlag;
+		b2ContactImpulse* impulses = NULL;
+		if (m_contactManager.m_contactListener)
+		{
+			impulses = (b2ContactImpulse*)m_stackAllocator.Allocate(island.m_contactCount * sizeof(b2ContactImpulse));
+		}
 
-				b2Body* other = ce->other;
+		b2Profile profiles[b2_maxThreads];
+		memset(profiles, 0, sizeof(profiles));
+
+		b2SolveIslandsTask task;
+		task.stackAllocator = &m_stackAllocator;
+		task.threadStackAllocators = m_threadStackAllocators;
+		task.graph = &island;
+		task.ranges = &ranges;
+		task.step = &step;
+		task.gravity = m_gravity;
+		task.allowSleep = m_allowSleep;
+		task.graphColoring = m_graphColoring;
+		task.simdContactSolver = m_simdContactSolver;
+		task.softStepCount = m_softStepCount;
+		task.velocityTolerance = m_velocityTolerance;
+		task.treeJointSolver = m_treeJointSolver;
+		task.islandSubStepRatio = m_islandSubStepRatio;
+		task.staticSlotCount = staticSlotCount;
+		task.impulses = impulses;
+		task.profiles = profiles;
+		task.iterations = m_islandIterations;
+		m_taskScheduler->ParallelFor(&task, islandCount, 1);
+
+		for (int32 i = 0; i < islandCount; ++i)
+		{
+			if (task.IsColored(i))
+			{
+				task.SolveIsland(i, &m_stackAllocator, m_taskScheduler, profiles);
+			}
+		}
 
-				// Was the other body already added to this island?
-				if (other->m_flags & b2Body::e_islandFlag)
-				{
-					continue;
-				}
+		for (int32 i = 0; i < m_taskScheduler->GetThreadCount(); ++i)
+		{
+			m_profile.solveInit += profiles[i].solveInit;
+			m_profile.solveVelocity += profiles[i].solveVelocity;
+			m_profile.solvePosition += profiles[i].solvePosition;
+		}
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
-			}
+		// Report in island order, as the single threaded solver does.
+		if (impulses)
+		{
+			island.Report(impulses);
+			m_stackAllocator.Free(impulses);
+		}
 
-			// Search all joints connect to this body.
-			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+		// A static body is left in the sleep state of the last island that touched it.
+		for (int32 i = 0; i < islandCount; ++i)
+		{
+			int32 bodyStart = ranges.bodyStart[i];
+			bool awake = island.m_bodies[bodyStart]->IsAwake();
+			for (int32 j = bodyStart; j < ranges.bodyStart[i + 1]; ++j)
 			{
-				if (je->joint->m_islandFlag == true)
+				b2Body* b = island.m_bodies[j];
+				if (b->GetType() == b2_staticBody)
 				{
-					continue;
+					b->SetAwake(awake);
 				}
+			}
+		}
 
-				b2Body* other = je->other;
+		m_stackAllocator.Free(ranges.jointStart);
+		m_stackAllocator.Free(ranges.contactStart);
+		m_stackAllocator.Free(ranges.bodyStart);
+	}
 
-				// Don't simulate joints connected to inactive bodies.
-				if (other->IsActive() == false)
-				{
-					continue;
-				}
+	b2Timer timer;
+	if (m_taskScheduler)
+	{
+		// Gather the moved bodies in island order.
+		b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(bodyCount * sizeof(b2Body*));
+		int32 movedCount = 0;
+		for (persistentIsland = m_awakeIslandList; persistentIsland; persistentIsland = persistentIsland->m_next)
+		{
+			for (b2Body* b = persistentIsland->m_bodyList; b; b = b->m_islandNext)
+			{
+				bodies[movedCount++] = b;
+			}
+		}
 
-				island.Add(je->joint);
-				je->joint->m_islandFlag = true;
+		bool* moves = (bool*)m_stackAllocator.Allocate(movedCount * sizeof(bool));
 
-				if (other->m_flags & b2Body::e_islandFlag)
-				{
-					continue;
-				}
+		// Compute the fixture AABBs concurrently, then apply the proxy moves
+		// serially in the original order.
+		b2SynchronizeFixturesTask task;
+		task.bodies = bodies;
+		task.moves = moves;
+		m_taskScheduler->ParallelFor(&task, movedCount, b2_synchronizeGrainSize);
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
+		for (int32 i = 0; i < movedCount; ++i)
+		{
+			if (moves[i])
+			{
+				bodies[i]->MoveFixtureProxies();
 			}
 		}
 
-		b2Profile profile;
-		island.Solve(&profile, step, m_gravity, m_allowSleep);
-		m_profile.solveInit += profile.solveInit;
-		m_profile.solveVelocity += profile.solveVelocity;
-		m_profile.solvePosition += profile.solvePosition;
-
-		// Post solve cleanup.
-		for (int32 i = 0; i < island.m_bodyCount; ++i)
+		m_stackAllocator.Free(moves);
+		m_stackAllocator.Free(bodies);
+	}
+	else
+	{
+		// Synchronize fixtures, check for out of range bodies. Only the bodies
+		// of the awake islands moved.
+		for (persistentIsland = m_awakeIslandList; persistentIsland; persistentIsland = persistentIsland->m_next)
 		{
-			// Allow static bodies to participate in other islands.
-			b2Body* b = island.m_bodies[i];
-			if (b->GetType() == b2_staticBody)
+			for (b2Body* b = persistentIsland->m_bodyList; b; b = b->m_islandNext)
 			{
-				b->m_flags &= ~b2Body::e_islandFlag;
+				// Update fixtures (for broad-phase).
+				b->SynchronizeFixtures();
 			}
 		}
 	}
 
-	m_stackAllocator.Free(stack);
+	// An island is put to sleep with all of its bodies. This comes before new
+	// contacts are found, because they wake their bodies.
+	persistentIsland = m_awakeIslandList;
+	while (persistentIsland)
+	{
+		b2PersistentIsland* next = persistentIsland->m_next;
+		if (persistentIsland->m_bodyList->IsAwake() == false)
+		{
+			SleepIsland(persistentIsland);
+		}
+		persistentIsland = next;
+	}
+
+	// Look for new contacts.
+	m_contactManager.FindNewContacts();
+	m_profile.broadphase = timer.GetMilliseconds();
+}
+
+// The number of contacts handed to a thread at a time by the TOI pre-pass.
+const int32 b2_findTOIsGrainSize = 32;
 
+// Computes and caches the first TOI of the CCD candidates among a set of contacts.
+// This is the first pass of the event loop in b2World::SolveTOI. It requires
+// every sweep to start at alpha0 = 0, so no sweep is advanced.
+struct b2FindTOIsTask : public b2ParallelTask
+{
+	void Execute(int32 begin, int32 end, int32 threadIndex)
 	{
-		b2Timer timer;
-		// Synchronize fixtures, check for out of range bodies.
-		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		B2_NOT_USED(threadIndex);
+		for (int32 i = begin; i < end; ++i)
 		{
-			// If a body was not in an island then it did not move.
-			if ((b->m_flags & b2Body::e_islandFlag) == 0)
+			b2Contact* c = contacts[i];
+
+			// Is this contact disabled?
+			if (c->IsEnabled() == false)
 			{
 				continue;
 			}
 
-			if (b->GetType() == b2_staticBody)
+			b2Fixture* fA = c->GetFixtureA();
+			b2Fixture* fB = c->GetFixtureB();
+
+			// Is there a sensor?
+			if (fA->IsSensor() || fB->IsSensor())
 			{
 				continue;
 			}
 
-			// Update fixtures (for broad-phase).
-			b->SynchronizeFixtures();
-		}
+			b2Body* bA = fA->GetBody();
+			b2Body* bB = fB->GetBody();
 
-		// Look for new contacts.
-		m_contactManager.FindNewContacts();
-		m_profile.broadphase = timer.GetMilliseconds();
+			b2BodyType typeA = bA->m_type;
+			b2BodyType typeB = bB->m_type;
+
+			bool activeA = bA->IsAwake() && typeA != b2_staticBody;
+			bool activeB = bB->IsAwake() && typeB != b2_staticBody;
+
+			// Is at least one body active (awake and dynamic or kinematic)?
+			if (activeA == false && activeB == false)
+			{
+				continue;
+			}
+
+			bool collideA = bA->IsBullet() || typeA != b2_dynamicBody;
+			bool collideB = bB->IsBullet() || typeB != b2_dynamicBody;
+
+			// Are these two non-bullet dynamic bodies?
+			if (collideA == false && collideB == false)
+			{
+				continue;
+			}
+
+			b2Assert(bA->Sweep().alpha0 == 0.0f && bB->Sweep().alpha0 == 0.0f);
+
+			// Compute the time of impact in interval [0, 1]
+			b2TOIInput input;
+			input.proxyA.Set(fA->GetShape(), c->GetChildIndexA());
+			input.proxyB.Set(fB->GetShape(), c->GetChildIndexB());
+			input.sweepA = bA->Sweep();
+			input.sweepB = bB->Sweep();
+			input.tMax = 1.0f;
+
+			b2TOIOutput output;
+			b2TimeOfImpact(&output, &input);
+
+			// With alpha0 = 0 the fraction of the remaining interval is the TOI.
+			float32 alpha = 1.0f;
+			if (output.state == b2TOIOutput::e_touching)
+			{
+				alpha = b2Min(output.t, 1.0f);
+			}
+
+			c->m_toi = alpha;
+			c->m_flags |= b2Contact::e_toiFlag;
+		}
 	}
-}
+
+	b2Contact** contacts;
+};
 
 // Find TOI contacts and solve them.
 void b2World::SolveTOI(const b2TimeStep& step)
 {
-	b2Island island(2 * b2_maxTOIContacts, b2_maxTOIContacts, 0, &m_stackAllocator, m_contactManager.m_contactListener);
+	b2Island island(2 * b2_maxTOIContacts, b2_maxTOIContacts, 0, &m_stackAllocator, m_contactManager.m_contactListener, 0);
 
-	if (m_stepComplete)
-	{
-		for (b2Body* b = m_bodyList; b; b = b->m_next)
-		{
-			b->m_flags &= ~b2Body::e_islandFlag;
-			b->m_sweep.alpha0 = 0.0f;
-		}
+	// The sweeps and TOIs are reset at the end of the previous step. Only awake
+	// contacts can have a TOI event, and the events only wake more contacts.
 
-		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
-		{
-			// Invalidate TOI
-			c->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
-			c->m_toiCount = 0;
-			c->m_toi = 1.0f;
-		}
+	// At the start of a step all sweeps are on the same time interval, so the
+	// first TOI of every contact can be computed concurrently. The event loop
+	// below then finds them cached.
+	if (m_stepComplete && m_taskScheduler)
+	{
+		b2FindTOIsTask task;
+		task.contacts = m_contactManager.m_awakeContacts;
+		m_taskScheduler->ParallelFor(&task, m_contactManager.m_awakeContactCount, b2_findTOIsGrainSize);
 	}
 
 	// Find TOI events and solve them.
@@ -602,8 +1591,10 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		b2Contact* minContact = NULL;
 		float32 minAlpha = 1.0f;
 
-		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+		for (int32 i = 0; i < m_contactManager.m_awakeContactCount; ++i)
 		{
+			b2Contact* c = m_contactManager.m_awakeContacts[i];
+
 			// Is this contact disabled?
 			if (c->IsEnabled() == false)
 			{
@@ -660,17 +1651,17 @@ void b2World::SolveTOI(const b2TimeStep& step)
 
 				// Compute the TOI for this contact.
 				// Put the sweeps onto the same time interval.
-				float32 alpha0 = bA->m_sweep.alpha0;
+				float32 alpha0 = bA->Sweep().alpha0;
 
-				if (bA->m_sweep.alpha0 < bB->m_sweep.alpha0)
+				if (bA->Sweep().alpha0 < bB->Sweep().alpha0)
 				{
-					alpha0 = bB->m_sweep.alpha0;
-					bA->m_sweep.Advance(alpha0);
+					alpha0 = bB->Sweep().alpha0;
+					bA->Sweep().Advance(alpha0);
 				}
-				else if (bB->m_sweep.alpha0 < bA->m_sweep.alpha0)
+				else if (bB->Sweep().alpha0 < bA->Sweep().alpha0)
 				{
-					alpha0 = bA->m_sweep.alpha0;
-					bB->m_sweep.Advance(alpha0);
+					alpha0 = bA->Sweep().alpha0;
+					bB->Sweep().Advance(alpha0);
 				}
 
 				b2Assert(alpha0 < 1.0f);
@@ -682,8 +1673,8 @@ void b2World::SolveTOI(const b2TimeStep& step)
 				b2TOIInput input;
 				input.proxyA.Set(fA->GetShape(), indexA);
 				input.proxyB.Set(fB->GetShape(), indexB);
-				input.sweepA = bA->m_sweep;
-				input.sweepB = bB->m_sweep;
+				input.sweepA = bA->Sweep();
+				input.sweepB = bB->Sweep();
 				input.tMax = 1.0f;
 
 				b2TOIOutput output;
@@ -725,8 +1716,8 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		b2Body* bA = fA->GetBody();
 		b2Body* bB = fB->GetBody();
 
-		b2Sweep backup1 = bA->m_sweep;
-		b2Sweep backup2 = bB->m_sweep;
+		b2Sweep backup1 = bA->Sweep();
+		b2Sweep backup2 = bB->Sweep();
 
 		bA->Advance(minAlpha);
 		bB->Advance(minAlpha);
@@ -741,8 +1732,8 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		{
 			// Restore the sweeps.
 			minContact->SetEnabled(false);
-			bA->m_sweep = backup1;
-			bB->m_sweep = backup2;
+			bA->Sweep() = backup1;
+			bB->Sweep() = backup2;
 			bA->SynchronizeTransform();
 			bB->SynchronizeTransform();
 			continue;
@@ -805,7 +1796,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 					}
 
 					// Tentatively advance the body to the TOI.
-					b2Sweep backup = other->m_sweep;
+					b2Sweep backup = other->Sweep();
 					if ((other->m_flags & b2Body::e_islandFlag) == 0)
 					{
 						other->Advance(minAlpha);
@@ -817,7 +1808,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 					// Was the contact disabled by the user?
 					if (contact->IsEnabled() == false)
 					{
-						other->m_sweep = backup;
+						other->Sweep() = backup;
 						other->SynchronizeTransform();
 						continue;
 					}
@@ -825,7 +1816,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 					// Are there contact points?
 					if (contact->IsTouching() == false)
 					{
-						other->m_sweep = backup;
+						other->Sweep() = backup;
 						other->SynchronizeTransform();
 						continue;
 					}
@@ -860,6 +1851,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		subStep.positionIterations = 20;
 		subStep.velocityIterations = step.velocityIterations;
 		subStep.warmStarting = false;
+		subStep.speculativeContacts = false;
 		island.SolveTOI(subStep, bA->m_islandIndex, bB->m_islandIndex);
 
 		// Reset island flags and synchronize broad-phase proxies.
@@ -892,12 +1884,31 @@ void b2World::SolveTOI(const b2TimeStep& step)
 			break;
 		}
 	}
+
+	if (m_stepComplete)
+	{
+		// Reset the sweeps and TOIs for the next step.
+		for (int32 i = 0; i < m_contactManager.m_awakeContactCount; ++i)
+		{
+			b2Contact* c = m_contactManager.m_awakeContacts[i];
+
+			// Invalidate TOI
+			c->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+			c->m_toiCount = 0;
+			c->m_toi = 1.0f;
+
+			c->m_fixtureA->m_body->Sweep().alpha0 = 0.0f;
+			c->m_fixtureB->m_body->Sweep().alpha0 = 0.0f;
+		}
+	}
 }
 
 void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIterations)
 {
 	b2Timer stepTimer;
 
+	StartThreads();
+
 	// If new fixtures were added, we need to find the new contacts.
 	if (m_flags & e_newFixture)
 	{
@@ -907,6 +1918,8 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 
 	m_flags |= e_locked;
 
+	m_profile.reorderedBodyCount = 0;
+
 	b2TimeStep step;
 	step.dt = dt;
 	step.velocityIterations	= velocityIterations;
@@ -924,6 +1937,11 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 
 	step.warmStarting = m_warmStarting;
 
+	// Speculative contacts replace the time of impact events.
+	bool speculative = m_continuousPhysics && m_speculativeContacts;
+	m_contactManager.m_speculativeTime = speculative ? dt : 0.0f;
+	step.speculativeContacts = speculative;
+
 	// Update contacts. This is where some contacts are destroyed.
 	{
 		b2Timer timer;
@@ -940,7 +1958,7 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 	}
 
 	// Handle TOI events.
-	if (m_continuousPhysics && step.dt > 0.0f)
+	if (m_continuousPhysics && speculative == false && step.dt > 0.0f)
 	{
 		b2Timer timer;
 		SolveTOI(step);
@@ -957,17 +1975,291 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 		ClearForces();
 	}
 
+	// An asynchronous step leaves the reordering to Wait, because the game reads
+	// the published transforms by body index while the step runs.
+	if (m_reorderInterval > 0 && step.dt > 0.0f)
+	{
+		if (m_stepping)
+		{
+			m_reorderPending = true;
+		}
+		else
+		{
+			Reorder();
+		}
+	}
+
 	m_flags &= ~e_locked;
 
 	m_profile.step = stepTimer.GetMilliseconds();
 }
 
+// Runs a time step started by StepAsync on the step thread.
+struct b2StepTask : public b2Task
+{
+	void Run()
+	{
+		world->Step(dt, velocityIterations, positionIterations);
+		world->PublishTransforms();
+	}
+
+	b2World* world;
+	float32 dt;
+	int32 velocityIterations;
+	int32 positionIterations;
+};
+
+void b2World::StepAsync(float32 dt, int32 velocityIterations, int32 positionIterations)
+{
+	b2Assert(m_stepping == false);
+	b2Assert(IsLocked() == false);
+	if (m_stepping || IsLocked())
+	{
+		return;
+	}
+
+	if (m_stepThread == NULL)
+	{
+		void* mem = b2Alloc(sizeof(b2WorkerThread));
+		m_stepThread = new (mem) b2WorkerThread;
+		m_stepTask = (b2StepTask*)b2Alloc(sizeof(b2StepTask));
+		new (m_stepTask) b2StepTask;
+	}
+
+	m_stepTask->world = this;
+	m_stepTask->dt = dt;
+	m_stepTask->velocityIterations = velocityIterations;
+	m_stepTask->positionIterations = positionIterations;
+
+	m_stepping = true;
+	m_stepThread->Submit(m_stepTask);
+}
+
+void b2World::Wait()
+{
+	if (m_stepping == false)
+	{
+		return;
+	}
+
+	m_stepThread->Wait();
+	m_stepping = false;
+
+	b2Swap(m_frontTransforms, m_backTransforms);
+	b2Swap(m_frontCapacity, m_backCapacity);
+
+	if (m_reorderPending)
+	{
+		m_reorderPending = false;
+		Reorder();
+	}
+}
+
+b2Transform b2World::GetPublishedTransform(const b2Body* body, float32 alpha) const
+{
+	const b2PublishedTransform& published = m_frontTransforms[body->m_worldIndex];
+	float32 beta = 1.0f - alpha;
+
+	b2Transform xf;
+	xf.p = beta * published.xf0.p + alpha * published.xf.p;
+
+	// Normalized linear interpolation of the rotation.
+	float32 c = beta * published.xf0.q.c + alpha * published.xf.q.c;
+	float32 s = beta * published.xf0.q.s + alpha * published.xf.q.s;
+	float32 length = b2Sqrt(c * c + s * s);
+	if (length < b2_epsilon)
+	{
+		return alpha < 0.5f ? published.xf0 : published.xf;
+	}
+
+	float32 invLength = 1.0f / length;
+	xf.q.c = invLength * c;
+	xf.q.s = invLength * s;
+	return xf;
+}
+
+struct b2PublishTransformsTask : public b2ParallelTask
+{
+	void Execute(int32 begin, int32 end, int32 threadIndex)
+	{
+		B2_NOT_USED(threadIndex);
+		for (int32 i = begin; i < end; ++i)
+		{
+			// The front transforms are only read, so the game may read them too.
+			back[i].xf0 = front[i].xf;
+			back[i].xf = transforms[i];
+		}
+	}
+
+	const b2Transform* transforms;
+	const b2World::b2PublishedTransform* front;
+	b2World::b2PublishedTransform* back;
+};
+
+const int32 b2_publishGrainSize = 256;
+
+void b2World::PublishTransforms()
+{
+	if (m_backCapacity < m_bodyCount)
+	{
+		b2Free(m_backTransforms);
+		m_backCapacity = m_frontCapacity;
+		m_backTransforms = (b2PublishedTransform*)b2Alloc(m_backCapacity * sizeof(b2PublishedTransform));
+	}
+
+	b2PublishTransformsTask task;
+	task.transforms = m_bodyStates.transforms;
+	task.front = m_frontTransforms;
+	task.back = m_backTransforms;
+
+	if (m_taskScheduler)
+	{
+		m_taskScheduler->ParallelFor(&task, m_bodyCount, b2_publishGrainSize);
+	}
+	else
+	{
+		task.Execute(0, m_bodyCount, 0);
+	}
+}
+
+// A sort key and the index of the element it belongs to.
+struct b2ReorderKey
+{
+	uint32 key;
+	int32 index;
+};
+
+inline bool b2ReorderKeyLessThan(const b2ReorderKey& key1, const b2ReorderKey& key2)
+{
+	if (key1.key == key2.key)
+	{
+		return key1.index < key2.index;
+	}
+
+	return key1.key < key2.key;
+}
+
+// Spread the low 16 bits of x to the even bits.
+inline uint32 b2SpreadBits(uint32 x)
+{
+	x &= 0x0000ffff;
+	x = (x | (x << 8)) & 0x00ff00ff;
+	x = (x | (x << 4)) & 0x0f0f0f0f;
+	x = (x | (x << 2)) & 0x33333333;
+	x = (x | (x << 1)) & 0x55555555;
+	return x;
+}
+
+// Put the elements of an array in the order of the sorted keys.
+template <typename T>
+static void b2PermuteArray(T* array, const b2ReorderKey* keys, int32 count, b2StackAllocator* allocator)
+{
+	T* copy = (T*)allocator->Allocate(count * sizeof(T));
+	memcpy(copy, array, count * sizeof(T));
+	for (int32 i = 0; i < count; ++i)
+	{
+		array[i] = copy[keys[i].index];
+	}
+	allocator->Free(copy);
+}
+
+void b2World::Reorder()
+{
+	if (m_bodyCount == 0)
+	{
+		return;
+	}
+
+	// Consecutive windows overlap by half, so a body can move past the end of
+	// its window in the next step.
+	int32 stride = (m_bodyCount + m_reorderInterval - 1) / m_reorderInterval;
+	if (m_reorderCursor >= m_bodyCount)
+	{
+		// Bodies were destroyed since the last pass.
+		m_reorderCursor = 0;
+	}
+
+	const b2Transform* transforms = m_bodyStates.transforms;
+	if (m_reorderCursor == 0)
+	{
+		// Take the bounds of all bodies at the start of each sweep, so all the
+		// windows of a sweep use the same grid.
+		m_reorderLower = transforms[0].p;
+		m_reorderUpper = transforms[0].p;
+		for (int32 i = 1; i < m_bodyCount; ++i)
+		{
+			m_reorderLower = b2Min(m_reorderLower, transforms[i].p);
+			m_reorderUpper = b2Max(m_reorderUpper, transforms[i].p);
+		}
+	}
+
+	int32 begin = m_reorderCursor;
+	int32 count = b2Min(2 * stride, m_bodyCount - begin);
+	m_reorderCursor = begin + count < m_bodyCount ? begin + stride : 0;
+
+	// Quantize the positions to a 16 bit grid over the bounds, with square cells,
+	// and interleave the bits of the cell coordinates. Bodies that have left the
+	// bounds since the start of the sweep go to the border cells.
+	float32 extent = b2Max(m_reorderUpper.x - m_reorderLower.x, m_reorderUpper.y - m_reorderLower.y);
+	float32 scale = extent > 0.0f ? 65535.0f / extent : 0.0f;
+
+	b2ReorderKey* keys = (b2ReorderKey*)m_stackAllocator.Allocate(count * sizeof(b2ReorderKey));
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Vec2 d = transforms[begin + i].p - m_reorderLower;
+		uint32 x = uint32(b2Clamp(scale * d.x, 0.0f, 65535.0f));
+		uint32 y = uint32(b2Clamp(scale * d.y, 0.0f, 65535.0f));
+		keys[i].key = b2SpreadBits(x) | (b2SpreadBits(y) << 1);
+		keys[i].index = i;
+	}
+
+	// Bodies in the same cell keep their order, so the pass is deterministic.
+	// Only the bodies that changed place are counted.
+	std::sort(keys, keys + count, b2ReorderKeyLessThan);
+
+	int32 moveCount = 0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		if (keys[i].index != i)
+		{
+			++moveCount;
+		}
+	}
+
+	if (moveCount > 0)
+	{
+		// The body objects stay where they are. Only the states indexed by
+		// m_worldIndex move.
+		b2PermuteArray(m_bodies + begin, keys, count, &m_stackAllocator);
+		b2PermuteArray(m_bodyStates.transforms + begin, keys, count, &m_stackAllocator);
+		b2PermuteArray(m_bodyStates.sweeps + begin, keys, count, &m_stackAllocator);
+		b2PermuteArray(m_bodyStates.linearVelocities + begin, keys, count, &m_stackAllocator);
+		b2PermuteArray(m_bodyStates.angularVelocities + begin, keys, count, &m_stackAllocator);
+		b2PermuteArray(m_bodyStates.forces + begin, keys, count, &m_stackAllocator);
+		b2PermuteArray(m_bodyStates.torques + begin, keys, count, &m_stackAllocator);
+		b2PermuteArray(m_bodyStates.invMasses + begin, keys, count, &m_stackAllocator);
+		b2PermuteArray(m_bodyStates.invIs + begin, keys, count, &m_stackAllocator);
+		b2PermuteArray(m_frontTransforms + begin, keys, count, &m_stackAllocator);
+
+		for (int32 i = begin; i < begin + count; ++i)
+		{
+			m_bodies[i]->m_worldIndex = i;
+		}
+	}
+
+	m_stackAllocator.Free(keys);
+
+	m_profile.reorderedBodyCount = moveCount;
+}
+
 void b2World::ClearForces()
 {
-	for (b2Body* body = m_bodyList; body; body = body->GetNext())
+	// Sleeping and static bodies have no forces.
+	for (int32 i = 0; i < m_awakeBodyCount; ++i)
 	{
-		body->m_force.SetZero();
-		body->m_torque = 0.0f;
+		int32 index = m_awakeBodies[i]->m_worldIndex;
+		m_bodyStates.forces[index].SetZero();
+		m_bodyStates.torques[index] = 0.0f;
 	}
 }
 
@@ -1095,8 +2387,8 @@ void b2World::DrawJoint(b2Joint* joint)
 {
 	b2Body* bodyA = joint->GetBodyA();
 	b2Body* bodyB = joint->GetBodyB();
-	const b2Transform& xf1 = bodyA->GetTransform();
-	const b2Transform& xf2 = bodyB->GetTransform();
+	b2Transform xf1 = bodyA->GetTransform();
+	b2Transform xf2 = bodyB->GetTransform();
 	b2Vec2 x1 = xf1.p;
 	b2Vec2 x2 = xf2.p;
 	b2Vec2 p1 = joint->GetAnchorA();
@@ -1145,7 +2437,7 @@ void b2World::DrawDebugData()
 	{
 		for (b2Body* b = m_bodyList; b; b = b->GetNext())
 		{
-			const b2Transform& xf = b->GetTransform();
+			b2Transform xf = b->GetTransform();
 			for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
 			{
 				if (b->IsActive() == false)
@@ -1256,6 +2548,29 @@ float32 b2World::GetTreeQuality() const
 	return m_contactManager.m_broadPhase.GetTreeQuality();
 }
 
+void b2World::SetTreeRebuildFactor(float32 factor)
+{
+	b2Assert(IsLocked() == false);
+	m_contactManager.m_broadPhase.SetTreeRebuildFactor(factor);
+}
+
+void b2World::SetTreeOptimizeIterations(int32 iterations)
+{
+	b2Assert(IsLocked() == false);
+	m_contactManager.m_broadPhase.SetTreeOptimizeIterations(iterations);
+}
+
+void b2World::RebuildTree()
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	m_contactManager.m_broadPhase.RebuildTree();
+}
+
 void b2World::Dump()
 {
 	if ((m_flags & e_locked) == e_locked)
@@ -22,6 +22,7 @@
 #include <Box2D/Common/b2Math.h>
 #include <Box2D/Common/b2BlockAllocator.h>
 #include <Box2D/Common/b2StackAllocator.h>
+#include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2ContactManager.h>
 #include <Box2D/Dynamics/b2WorldCallbacks.h>
 #include <Box2D/Dynamics/b2TimeStep.h>
@@ -34,6 +35,11 @@ class b2Body;
 class b2Draw;
 class b2Fixture;
 class b2Joint;
+class b2PersistentIsland;
+class b2TaskScheduler;
+class b2ThreadPool;
+class b2WorkerThread;
+struct b2StepTask;
 
 /// The world class manages all physics entities, dynamic simulation,
 /// and asynchronous queries. The world also contains efficient memory
@@ -95,6 +101,27 @@ public:
 				int32 velocityIterations,
 				int32 positionIterations);
 
+	/// Start a time step on a background thread and return immediately. This lets
+	/// the step overlap other work, such as rendering the previous step. Until Wait
+	/// returns, the world and everything in it must not be touched, except with
+	/// GetPublishedTransform. Callbacks are invoked on the background thread.
+	/// @see Step
+	void StepAsync(	float32 timeStep,
+					int32 velocityIterations,
+					int32 positionIterations);
+
+	/// Wait for the step started by StepAsync to finish and publish the body
+	/// transforms it computed. This returns immediately if no step is running.
+	void Wait();
+
+	/// Get the transform of a body published by the last StepAsync that was waited
+	/// for. This is safe to call while a step is running. Bodies created since
+	/// then report their initial transform.
+	/// @param alpha interpolates between the transform before (0) and after (1)
+	/// the published step.
+	/// @warning Step doesn't publish transforms, so don't mix it with StepAsync.
+	b2Transform GetPublishedTransform(const b2Body* body, float32 alpha) const;
+
 	/// Manually clear the force buffer on all bodies. By default, forces are cleared automatically
 	/// after each call to Step. The default behavior is modified by calling SetAutoClearForces.
 	/// The purpose of this function is to support sub-stepping. Sub-stepping is often used to maintain
@@ -157,6 +184,139 @@ public:
 	void SetSubStepping(bool flag) { m_subStepping = flag; }
 	bool GetSubStepping() const { return m_subStepping; }
 
+	/// Enable/disable speculative contacts for continuous physics. The contacts of
+	/// bullets and of bodies with static or kinematic bodies then keep the points
+	/// that can be reached in the next time step, and the solver lets them close
+	/// the gap but not pass through. This replaces the time of impact sub-steps,
+	/// which get expensive with many fast bodies. PreSolve is called for such
+	/// contacts before they touch, while BeginContact waits for the touch. Fast
+	/// bodies may hit shapes that they would have passed by, and a fast spinning
+	/// body may stop short of a surface. The default is disabled.
+	void SetSpeculativeContacts(bool flag) { m_speculativeContacts = flag; }
+	bool GetSpeculativeContacts() const { return m_speculativeContacts; }
+
+	/// Set the number of threads used by the time step, including the thread that
+	/// calls Step. With more than one thread independent islands are solved
+	/// concurrently and the results are identical to the single threaded solver.
+	/// The default is the number of hardware threads. The threads are started by
+	/// the first Step, so a world that is given a task scheduler or a single thread
+	/// before then never starts any. This has no effect while a task scheduler is set.
+	/// @warning PostSolve is reported after all islands are solved.
+	/// @warning This function is locked during callbacks.
+	void SetThreadCount(int32 count);
+
+	/// Get the number of threads used by the time step.
+	int32 GetThreadCount() const;
+
+	/// Register a task scheduler that runs the parallel phases of the time step on
+	/// your own threads instead of the threads created by SetThreadCount. The
+	/// scheduler is owned by you and must remain in scope. This stops the built-in
+	/// threads. Pass NULL to go back to them.
+	/// @warning This function is locked during callbacks.
+	void SetTaskScheduler(b2TaskScheduler* scheduler);
+
+	/// Enable/disable graph coloring for large islands. The contacts and joints of
+	/// an island with at least b2_minColoredConstraints of them are grouped into
+	/// colors that share no dynamic body, and each color is solved across the
+	/// threads. This changes the solver order, so results differ from the
+	/// sequential solver, but they don't depend on the thread count.
+	/// The default is disabled.
+	void SetGraphColoring(bool flag) { m_graphColoring = flag; }
+	bool GetGraphColoring() const { return m_graphColoring; }
+
+	/// Enable/disable the SIMD contact solver. The contacts of an island are grouped
+	/// into batches that share no dynamic body, and each batch is solved with SSE2
+	/// or AVX2 instructions, depending on the CPU. Each body still sees its contacts
+	/// in order, so the results are bit-identical to the scalar solver, unless the
+	/// compiler is allowed to fuse multiplies and adds (e.g. -mfma -ffp-contract=fast).
+	/// Islands solved with graph coloring keep the scalar solver.
+	/// The default is disabled.
+	void SetSimdContactSolver(bool flag) { m_simdContactSolver = flag; }
+	bool GetSimdContactSolver() const { return m_simdContactSolver; }
+
+	/// Set the number of substeps of the soft step solver, or zero to use the
+	/// iterations passed to Step. The soft step solver splits each time step into
+	/// substeps that solve the contacts once as soft constraints and relax them once,
+	/// so the velocity iterations are ignored and the position iterations only
+	/// correct joint drift. Four substeps make 8 passes over the contacts where 10
+	/// velocity and 8 position iterations make up to 18, and hold stacks at least
+	/// as well. Contact impulses reported to
+	/// b2ContactListener::PostSolve and joint reaction forces are those of the
+	/// last substep. The default is zero.
+	void SetSoftStepCount(int32 count) { b2Assert(count >= 0); m_softStepCount = count; }
+	int32 GetSoftStepCount() const { return m_softStepCount; }
+
+	/// Set the velocity tolerance of the iterative solver. An island stops its
+	/// velocity iterations once no contact or joint impulse changes by more than
+	/// this in a pass, so resting islands often need only one or two passes. The
+	/// iterations made are reported by b2Profile::islandIterations. Tall stacks
+	/// still need every iteration, so keep the tolerance small, around 1e-4. The
+	/// default of zero only stops when nothing changes, which gives the same
+	/// result as running every iteration.
+	void SetVelocityTolerance(float32 tolerance) { b2Assert(tolerance >= 0.0f); m_velocityTolerance = tolerance; }
+	float32 GetVelocityTolerance() const { return m_velocityTolerance; }
+
+	/// Enable/disable the direct solver for joint trees. Revolute joints without
+	/// motor or limit and rigid distance joints that connect the bodies of an
+	/// island without a loop, such as chains, bridges and ragdolls, are solved
+	/// exactly in time linear in their number instead of iteratively. The contacts
+	/// and other joints are still iterated, so ropes and bridges no longer need
+	/// many velocity iterations to stay taut. Joints that would close a loop are
+	/// left to the iterations. The default is disabled.
+	void SetTreeJointSolver(bool flag) { m_treeJointSolver = flag; }
+	bool GetTreeJointSolver() const { return m_treeJointSolver; }
+
+	/// Set the motion above which an island is solved in substeps, or zero to
+	/// solve every island in one step. The motion of a body is the distance it
+	/// moves in a step divided by the smallest extent of its shapes, plus the
+	/// angle it turns in radians. An island whose fastest body exceeds the ratio
+	/// is split into up to b2_maxIslandSubSteps substeps that keep the motion of
+	/// each substep below it, and each substep runs the iterations passed to
+	/// Step. So a fast vehicle or spinning wheel gets the accuracy it needs while
+	/// the calm islands stay cheap. Contact impulses reported to
+	/// b2ContactListener::PostSolve and joint reaction forces are those of the
+	/// last substep. A ratio of 0.5 is a good start. The default is zero.
+	void SetIslandSubStepRatio(float32 ratio) { b2Assert(ratio >= 0.0f); m_islandSubStepRatio = ratio; }
+	float32 GetIslandSubStepRatio() const { return m_islandSubStepRatio; }
+
+	/// Set the number of steps over which the body states are reordered along a
+	/// Morton curve of the body positions, or zero to keep the creation order.
+	/// Bodies that are close in space then sit close in memory, which keeps the
+	/// collision and the solver in the cache once the bodies have moved far from
+	/// where they were created. Each step sorts a window of the body states, and
+	/// the windows sweep all bodies once per interval, so a body array in much
+	/// disorder takes a few sweeps to settle. Only the body states move: pointers,
+	/// the body and contact lists and the results of the step are unchanged. The
+	/// bodies moved by the last step are reported by b2Profile::reorderedBodyCount.
+	/// After an asynchronous step the window is sorted by Wait. The default is zero.
+	void SetReorderInterval(int32 steps) { b2Assert(steps >= 0); m_reorderInterval = steps; }
+	int32 GetReorderInterval() const { return m_reorderInterval; }
+
+	/// Set how much the quality metric of the kinematic and dynamic broad-phase
+	/// trees may degrade before a tree is rebuilt, or zero to never rebuild them.
+	/// A tree is rebuilt in the first step and then whenever its quality grew
+	/// beyond the factor times its value after the last rebuild. The rebuild
+	/// sorts the proxies along a Morton curve and takes a few milliseconds for
+	/// 50k proxies. It runs in the step, so StepAsync takes it off the calling
+	/// thread. The static tree is always rebuilt after it got worse. A factor
+	/// of 1.2 is a good start. The default is zero.
+	/// @warning This function is locked during callbacks.
+	void SetTreeRebuildFactor(float32 factor);
+
+	/// Set the number of paths from the root of the kinematic and dynamic
+	/// broad-phase trees to a leaf that are optimized in each step, or zero for
+	/// none. The nodes on a path are rotated where that lowers the surface area
+	/// heuristic cost, and each step takes the next paths, so the trees stay in
+	/// shape over long sessions at a small, fixed cost per step and without the
+	/// spikes of a rebuild. Around 16 iterations is a good start. The default is
+	/// zero.
+	/// @warning This function is locked during callbacks.
+	void SetTreeOptimizeIterations(int32 iterations);
+
+	/// Rebuild the broad-phase trees now, such as after loading a level.
+	/// @warning This function is locked during callbacks.
+	void RebuildTree();
+
 	/// Get the number of broad-phase proxies.
 	int32 GetProxyCount() const;
 
@@ -169,14 +329,15 @@ public:
 	/// Get the number of contacts (each may have 0 or more contact points).
 	int32 GetContactCount() const;
 
-	/// Get the height of the dynamic tree.
+	/// Get the height of the tallest broad-phase tree. The proxies of static,
+	/// kinematic and dynamic bodies are kept in separate trees.
 	int32 GetTreeHeight() const;
 
-	/// Get the balance of the dynamic tree.
+	/// Get the balance of the least balanced broad-phase tree.
 	int32 GetTreeBalance() const;
 
-	/// Get the quality metric of the dynamic tree. The smaller the better.
-	/// The minimum is 1.
+	/// Get the quality metric of the worst broad-phase tree. The smaller the
+	/// better. The minimum is 1.
 	float32 GetTreeQuality() const;
 
 	/// Change the global gravity vector.
@@ -216,18 +377,79 @@ private:
 
 	friend class b2Body;
 	friend class b2Fixture;
+	friend class b2Contact;
 	friend class b2ContactManager;
 	friend class b2Controller;
+	friend struct b2StepTask;
+	friend struct b2PublishTransformsTask;
+
+	// The transform of a body before and after a time step.
+	struct b2PublishedTransform
+	{
+		b2Transform xf0;
+		b2Transform xf;
+	};
 
 	void Solve(const b2TimeStep& step);
 	void SolveTOI(const b2TimeStep& step);
 
+	// Persistent islands. Every active dynamic or kinematic body is in an island
+	// together with the bodies it is connected to by joints and by touching
+	// contacts that aren't sensors. A constraint links the islands of its bodies.
+	b2PersistentIsland* CreateIsland(bool awake);
+	void DestroyIsland(b2PersistentIsland* island);
+	void WakeIsland(b2PersistentIsland* island);
+	void SleepIsland(b2PersistentIsland* island);
+	b2PersistentIsland* MergeIslands(b2PersistentIsland* islandA, b2PersistentIsland* islandB);
+	void SplitIsland(b2PersistentIsland* island);
+
+	void AddToIsland(b2Body* body);
+	void RemoveFromIsland(b2Body* body);
+	void LinkContact(b2Contact* contact);
+	void UnlinkContact(b2Contact* contact);
+	void LinkJoint(b2Joint* joint);
+	void UnlinkJoint(b2Joint* joint);
+
+	// Add the body to the awake bodies or remove it, and update the awake set of
+	// its contacts. A body is awake if it is awake and not static.
+	void UpdateAwakeSet(b2Body* body);
+	void RemoveAwake(b2Body* body);
+
+	// Reallocate the body array and the body states.
+	void ResizeBodyArrays(int32 capacity);
+
+	// Write the transforms of the step that just finished to the back buffer.
+	void PublishTransforms();
+
+	// Sort the next window of body states along a Morton curve of the body
+	// positions. This must not run while a step or a callback is running.
+	void Reorder();
+
+	// Use the custom scheduler or else the thread pool, and give each of its
+	// threads a stack allocator.
+	void UpdateTaskScheduler();
+
+	// Start the default thread pool unless a custom scheduler is set, or stop it.
+	void StartThreads();
+	void StopThreads();
+
 	void DrawJoint(b2Joint* joint);
 	void DrawShape(b2Fixture* shape, const b2Transform& xf, const b2Color& color);
 
 	b2BlockAllocator m_blockAllocator;
 	b2StackAllocator m_stackAllocator;
 
+	// The parallel phases run on m_taskScheduler, which is the custom scheduler
+	// or the thread pool, or NULL for a single thread. Thread 0 is the caller of
+	// Step and uses m_stackAllocator, the other threads use their own. The pool
+	// of m_threadCount threads is started by Step.
+	b2ThreadPool* m_threadPool;
+	int32 m_threadCount;
+	b2TaskScheduler* m_customScheduler;
+	b2TaskScheduler* m_taskScheduler;
+	b2StackAllocator* m_threadStackAllocators;
+	int32 m_threadStackAllocatorCount;
+
 	int32 m_flags;
 
 	b2ContactManager m_contactManager;
@@ -238,6 +460,32 @@ private:
 	int32 m_bodyCount;
 	int32 m_jointCount;
 
+	// Every body and its hot state, indexed by b2Body::m_worldIndex. The state
+	// arrays have the capacity of the body array.
+	b2Body** m_bodies;
+	b2BodyStates m_bodyStates;
+	int32 m_bodyCapacity;
+
+	// The game reads the front transforms while StepAsync writes the back
+	// transforms. Wait swaps them. Both use the body indices.
+	b2PublishedTransform* m_frontTransforms;
+	int32 m_frontCapacity;
+	b2PublishedTransform* m_backTransforms;
+	int32 m_backCapacity;
+
+	b2WorkerThread* m_stepThread;
+	b2StepTask* m_stepTask;
+	bool m_stepping;
+
+	// Only the awake islands are visited by the solver.
+	b2PersistentIsland* m_awakeIslandList;
+	b2PersistentIsland* m_sleepingIslandList;
+
+	// The awake bodies in no particular order.
+	b2Body** m_awakeBodies;
+	int32 m_awakeBodyCount;
+	int32 m_awakeBodyCapacity;
+
 	b2Vec2 m_gravity;
 	bool m_allowSleep;
 
@@ -252,10 +500,26 @@ private:
 	bool m_warmStarting;
 	bool m_continuousPhysics;
 	bool m_subStepping;
+	bool m_speculativeContacts;
+
+	bool m_graphColoring;
+	bool m_simdContactSolver;
+	int32 m_softStepCount;
+	float32 m_velocityTolerance;
+	bool m_treeJointSolver;
+	float32 m_islandSubStepRatio;
+	int32 m_reorderInterval;
+	int32 m_reorderCursor;
+	bool m_reorderPending;
+	b2Vec2 m_reorderLower, m_reorderUpper;
 
 	bool m_stepComplete;
 
 	b2Profile m_profile;
+
+	// The iterations of each awake island, see b2Profile::islandIterations.
+	int32* m_islandIterations;
+	int32 m_islandIterationCapacity;
 };
 
 inline b2Body* b2World::GetBodyList()
@@ -0,0 +1,145 @@
+/*
+* Copyright (c) 2012 Nusantara Software
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Dynamics/b2WorldGroup.h>
+#include <Box2D/Dynamics/b2World.h>
+#include <Box2D/Common/b2ThreadPool.h>
+#include <Box2D/Common/b2Math.h>
+#include <new>
+#include <cstring>
+
+b2WorldGroup::b2WorldGroup()
+{
+	m_worldCapacity = 16;
+	m_worldCount = 0;
+	m_worlds = (b2World**)b2Alloc(m_worldCapacity * sizeof(b2World*));
+
+	m_threadPool = NULL;
+	m_customScheduler = NULL;
+	m_taskScheduler = NULL;
+}
+
+b2WorldGroup::~b2WorldGroup()
+{
+	SetTaskScheduler(NULL);
+	SetThreadCount(1);
+
+	b2Free(m_worlds);
+}
+
+void b2WorldGroup::AddWorld(b2World* world)
+{
+	if (m_worldCount == m_worldCapacity)
+	{
+		b2World** oldWorlds = m_worlds;
+		m_worldCapacity *= 2;
+		m_worlds = (b2World**)b2Alloc(m_worldCapacity * sizeof(b2World*));
+		memcpy(m_worlds, oldWorlds, m_worldCount * sizeof(b2World*));
+		b2Free(oldWorlds);
+	}
+
+	m_worlds[m_worldCount] = world;
+	++m_worldCount;
+}
+
+void b2WorldGroup::RemoveWorld(b2World* world)
+{
+	for (int32 i = 0; i < m_worldCount; ++i)
+	{
+		if (m_worlds[i] == world)
+		{
+			--m_worldCount;
+			m_worlds[i] = m_worlds[m_worldCount];
+			return;
+		}
+	}
+
+	b2Assert(false);
+}
+
+void b2WorldGroup::SetThreadCount(int32 count)
+{
+	count = b2Clamp(count, 1, b2_maxThreads);
+	int32 poolCount = m_threadPool ? m_threadPool->GetThreadCount() : 1;
+	if (count == poolCount)
+	{
+		return;
+	}
+
+	if (m_threadPool)
+	{
+		m_threadPool->~b2ThreadPool();
+		b2Free(m_threadPool);
+		m_threadPool = NULL;
+	}
+
+	if (count > 1)
+	{
+		void* mem = b2Alloc(sizeof(b2ThreadPool));
+		m_threadPool = new (mem) b2ThreadPool(count);
+	}
+
+	m_taskScheduler = m_customScheduler ? m_customScheduler : m_threadPool;
+}
+
+int32 b2WorldGroup::GetThreadCount() const
+{
+	return m_taskScheduler ? m_taskScheduler->GetThreadCount() : 1;
+}
+
+void b2WorldGroup::SetTaskScheduler(b2TaskScheduler* scheduler)
+{
+	m_customScheduler = scheduler;
+	m_taskScheduler = m_customScheduler ? m_customScheduler : m_threadPool;
+}
+
+struct b2StepWorldsTask : public b2ParallelTask
+{
+	void Execute(int32 begin, int32 end, int32 threadIndex)
+	{
+		B2_NOT_USED(threadIndex);
+		for (int32 i = begin; i < end; ++i)
+		{
+			worlds[i]->Step(dt, velocityIterations, positionIterations);
+		}
+	}
+
+	b2World** worlds;
+	float32 dt;
+	int32 velocityIterations;
+	int32 positionIterations;
+};
+
+void b2WorldGroup::Step(float32 dt, int32 velocityIterations, int32 positionIterations)
+{
+	b2StepWorldsTask task;
+	task.worlds = m_worlds;
+	task.dt = dt;
+	task.velocityIterations = velocityIterations;
+	task.positionIterations = positionIterations;
+
+	// Worlds differ in cost, so they are handed out one at a time.
+	if (m_taskScheduler)
+	{
+		m_taskScheduler->ParallelFor(&task, m_worldCount, 1);
+	}
+	else
+	{
+		task.Execute(0, m_worldCount, 0);
+	}
+}
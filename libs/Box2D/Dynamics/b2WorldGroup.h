@@ -0,0 +1,96 @@
+/*
+* Copyright (c) 2012 Nusantara Software
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_WORLD_GROUP_H
+#define B2_WORLD_GROUP_H
+
+#include <Box2D/Common/b2Settings.h>
+
+class b2TaskScheduler;
+class b2ThreadPool;
+class b2World;
+
+/// A set of independent worlds that are stepped together. Each world is stepped
+/// by a single thread, and the worlds are spread over the threads of the group.
+/// The worlds are owned by you and must remain in scope while they are in the group.
+class b2WorldGroup
+{
+public:
+	/// Construct an empty group that steps on one thread.
+	b2WorldGroup();
+
+	/// Destruct the group. This doesn't destroy the worlds.
+	~b2WorldGroup();
+
+	/// Add a world to the group. A world can only be in one group.
+	void AddWorld(b2World* world);
+
+	/// Remove a world from the group. This changes the order of the worlds.
+	void RemoveWorld(b2World* world);
+
+	/// Get the number of worlds.
+	int32 GetWorldCount() const;
+
+	/// Get a world by index.
+	b2World* GetWorld(int32 index);
+
+	/// Set the number of threads used by Step, including the thread that calls Step.
+	/// The worlds should use a single thread of their own, see b2World::SetThreadCount,
+	/// otherwise the threads of the worlds compete with the threads of the group.
+	/// The default is one. This has no effect while a task scheduler is set.
+	void SetThreadCount(int32 count);
+	int32 GetThreadCount() const;
+
+	/// Register a task scheduler that steps the worlds on your own threads instead
+	/// of the threads created by SetThreadCount. The scheduler is owned by you and
+	/// must remain in scope. The worlds must not use the same scheduler, because it
+	/// only runs one job at a time. Pass NULL to go back to the built-in threads.
+	void SetTaskScheduler(b2TaskScheduler* scheduler);
+
+	/// Take a time step in every world. This returns when all worlds are stepped.
+	/// Callbacks of a world are invoked on the thread that steps it.
+	/// @see b2World::Step
+	void Step(	float32 timeStep,
+				int32 velocityIterations,
+				int32 positionIterations);
+
+private:
+
+	b2World** m_worlds;
+	int32 m_worldCount;
+	int32 m_worldCapacity;
+
+	// Step runs on m_taskScheduler, which is the custom scheduler or the thread
+	// pool, or NULL for a single thread.
+	b2ThreadPool* m_threadPool;
+	b2TaskScheduler* m_customScheduler;
+	b2TaskScheduler* m_taskScheduler;
+};
+
+inline int32 b2WorldGroup::GetWorldCount() const
+{
+	return m_worldCount;
+}
+
+inline b2World* b2WorldGroup::GetWorld(int32 index)
+{
+	b2Assert(0 <= index && index < m_worldCount);
+	return m_worlds[index];
+}
+
+#endif